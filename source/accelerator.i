@@ -3,28 +3,191 @@
 %{
 #define SWIG_FILE_WITH_INIT
 #include "filter.h"
+#include "noise.h"
 #include "cavity.h"
 #include "rf_station.h"
 #include "cryomodule.h"
 #include "linac.h"
 #include "doublecompress.h"
+#include "sim_psd.h"
+#include "sim_stats.h"
 #include "simulation_top.h"
 %}
 
 %include "complex.i"
+%include "stdint.i"
 %include "carrays.i"
 %array_class(int, intArray);
 %array_class(double complex, complexdouble_Array);
 %array_class(double, double_Array);
+%array_class(uint32_t, uint32_Array);
 
 %include "cpointer.i"
 %pointer_class(int, intp);
 %pointer_class(double complex, compp);
 
+// NumPy arrays as input/output waveforms of the block step functions
+%include "numpy.i"
+%init %{
+import_array();
+%}
+%numpy_typemaps(double complex, NPY_CDOUBLE, int)
+
+%apply (double* IN_ARRAY1, int DIM1) {(double *delta_tz, int n_delta_tz)};
+%apply (double complex* IN_ARRAY1, int DIM1) {
+  (double complex *Kg, int n_Kg),
+  (double complex *beam_current, int n_beam_current),
+  (double complex *feed_forward, int n_feed_forward),
+  (double complex *sat_in, int n_sat_in)};
+%apply (double complex* INPLACE_ARRAY1, int DIM1) {
+  (double complex *V, int n_V),
+  (double complex *E_probe, int n_E_probe),
+  (double complex *E_reverse, int n_E_reverse),
+  (double complex *E_fwd, int n_E_fwd),
+  (double complex *Kg_out, int n_Kg_out),
+  (double complex *sat_out, int n_sat_out)};
+%apply (double* INPLACE_ARRAY1, int DIM1) {(double *delta_omega, int n_delta_omega)};
+
+// NumPy arrays as Simulation output records (rows of Sim_Output_Columns values)
+%apply (double* INPLACE_ARRAY2, int DIM1, int DIM2) {(double *rows, int n_rows, int n_cols)};
+%apply (double** ARGOUTVIEWM_ARRAY2, int* DIM1, int* DIM2) {(double **rows_out, int *n_rows_out, int *n_cols_out)};
+%apply (int* IN_ARRAY1, int DIM1) {(int *psd_cols, int n_psd_cols)};
+
+// Python sees the NumPy versions of the block step functions below
+%ignore Cavity_Step_Block;
+%ignore RF_Station_Step_Block;
+%rename(Cavity_Step_Block) Cavity_Step_Block_Waveforms;
+%rename(RF_Station_Step_Block) RF_Station_Step_Block_Waveforms;
+%ignore Saturate_Table_Block;
+%rename(Saturate_Table_Block) Saturate_Table_Block_Waveforms;
+%ignore Simulation_Run_Buffer;
+%rename(Simulation_Run_Buffer) Simulation_Run_Buffer_Array;
+
+// Python exception raised by Simulation_Run_Array (e.g. MemoryError) instead of returning an array
+%exception Simulation_Run_Array {
+  $action
+  if(PyErr_Occurred()) SWIG_fail;
+}
+
 %include "filter.h"
+%include "noise.h"
 %include "cavity.h"
 %include "rf_station.h"
 %include "cryomodule.h"
 %include "linac.h"
 %include "doublecompress.h"
+%include "sim_psd.h"
+%include "sim_stats.h"
 %include "simulation_top.h"
+
+%{
+/** Number of steps of a block call given the lengths of its waveforms:
+  * length of the non-empty waveforms, or -1 if they differ in length. */
+static int Waveforms_Length(int *lens, int n_lens)
+{
+  int i, n = 0;
+  for(i=0;i<n_lens;i++) {
+    if(lens[i] == 0) continue;
+    if(n == 0) n = lens[i];
+    else if(lens[i] != n) return -1;
+  }
+  return n;
+}
+%}
+
+%inline %{
+
+/** Cavity_Step_Block on NumPy waveforms: all non-empty arrays must have the same length
+  * (empty arrays are zero inputs or unrecorded outputs); outputs are written in place.
+  * Returns the number of simulation steps, or -1 if waveform lengths do not match. */
+int Cavity_Step_Block_Waveforms(Cavity *cav,
+  double *delta_tz, int n_delta_tz,
+  double complex *Kg, int n_Kg,
+  double complex *beam_current, int n_beam_current,
+  double complex *V, int n_V,
+  double complex *E_probe, int n_E_probe,
+  double complex *E_reverse, int n_E_reverse,
+  double *delta_omega, int n_delta_omega,
+  Cavity_State *cav_state)
+{
+  int lens[7] = {n_delta_tz, n_Kg, n_beam_current, n_V, n_E_probe, n_E_reverse, n_delta_omega};
+  int n = Waveforms_Length(lens, 7);
+  if(n < 0) return -1;
+
+  Cavity_Step_Block(cav, n,
+    n_delta_tz ? delta_tz : NULL, n_Kg ? Kg : NULL, n_beam_current ? beam_current : NULL,
+    n_V ? V : NULL, n_E_probe ? E_probe : NULL, n_E_reverse ? E_reverse : NULL,
+    n_delta_omega ? delta_omega : NULL, cav_state);
+  return n;
+}
+
+/** RF_Station_Step_Block on NumPy waveforms (same conventions as Cavity_Step_Block_Waveforms). */
+int RF_Station_Step_Block_Waveforms(RF_Station *rf_station,
+  double *delta_tz, int n_delta_tz,
+  double complex *beam_current, int n_beam_current,
+  double complex *feed_forward, int n_feed_forward,
+  double complex *V, int n_V,
+  double complex *E_probe, int n_E_probe,
+  double complex *E_reverse, int n_E_reverse,
+  double complex *E_fwd, int n_E_fwd,
+  double complex *Kg_out, int n_Kg_out,
+  double *delta_omega, int n_delta_omega,
+  RF_State *rf_state)
+{
+  int lens[9] = {n_delta_tz, n_beam_current, n_feed_forward, n_V, n_E_probe, n_E_reverse, n_E_fwd, n_Kg_out, n_delta_omega};
+  int n = Waveforms_Length(lens, 9);
+  if(n < 0) return -1;
+
+  RF_Station_Step_Block(rf_station, n,
+    n_delta_tz ? delta_tz : NULL, n_beam_current ? beam_current : NULL, n_feed_forward ? feed_forward : NULL,
+    n_V ? V : NULL, n_E_probe ? E_probe : NULL, n_E_reverse ? E_reverse : NULL,
+    n_E_fwd ? E_fwd : NULL, n_Kg_out ? Kg_out : NULL,
+    n_delta_omega ? delta_omega : NULL, rf_state);
+  return n;
+}
+
+/** Saturate_Table_Block on distinct NumPy arrays of the same length (output written in place).
+  * Returns the number of signals, or -1 if the array lengths do not match. */
+int Saturate_Table_Block_Waveforms(Sat_Table *tab,
+  double complex *sat_in, int n_sat_in,
+  double complex *sat_out, int n_sat_out)
+{
+  if(n_sat_in != n_sat_out) return -1;
+  Saturate_Table_Block(tab, sat_in, sat_out, n_sat_in);
+  return n_sat_in;
+}
+
+/** Simulation_Run_Buffer into a caller-provided (C-contiguous) NumPy array of Sim_Output_Columns columns.
+  * Returns the number of rows recorded, or -1 if the number of columns does not match. */
+int Simulation_Run_Buffer_Array(Simulation *sim, Simulation_State *sim_state,
+  double *rows, int n_rows, int n_cols,
+  int OUTPUTFREQ)
+{
+  if(n_cols != Sim_Output_Columns(sim)) return -1;
+  return Simulation_Run_Buffer(sim, sim_state, rows, n_rows, OUTPUTFREQ);
+}
+
+/** Simulation_Run_Buffer into a buffer allocated for the complete record (see Sim_Output_Rows),
+  * returned to Python as a NumPy array which owns it (no copy).
+  * Raises MemoryError (without running) if the buffer can not be allocated. */
+void Simulation_Run_Array(Simulation *sim, Simulation_State *sim_state, int OUTPUTFREQ,
+  double **rows_out, int *n_rows_out, int *n_cols_out)
+{
+  int n_rows = Sim_Output_Rows(sim, OUTPUTFREQ), n_cols = Sim_Output_Columns(sim);
+  size_t n_values = (n_rows > 0) ? (size_t)n_rows*(size_t)n_cols : 1;
+  double *rows = NULL;
+
+  if(n_values <= SIZE_MAX/sizeof(double)) rows = malloc(n_values*sizeof(double));
+  if(rows == NULL) {
+    *rows_out = NULL;
+    *n_rows_out = 0;
+    *n_cols_out = 0;
+    PyErr_NoMemory();
+    return;
+  }
+
+  *n_rows_out = Simulation_Run_Buffer(sim, sim_state, rows, n_rows, OUTPUTFREQ);
+  *n_cols_out = n_cols;
+  *rows_out = rows;
+}
+%}
@@ -139,14 +139,27 @@ void ElecMode_Deallocate(ElecMode * elecMode)
 void ElecMode_State_Allocate(ElecMode_State *elecMode_state, ElecMode *elecMode)
 {
   elecMode_state -> delta_omega = 0.0;
+  elecMode_state -> d_phase = 0.0;
+
+  // Phase rotator starts at zero phase, with the increment for the baseline frequency offset
+  elecMode_state -> rotator = 1.0;
+  elecMode_state -> rot_omega = elecMode->omega_d_0;
+  elecMode_state -> rot_step = cexp(-I*elecMode->omega_d_0*elecMode->Tstep);
+  elecMode_state -> rot_count = 0;
+
+  // No timing jitter
+  elecMode_state -> beam_phasor = 1.0;
+  elecMode_state -> beam_delta_tz = 0.0;
+
   Filter_State_Allocate(&elecMode_state->fil_state, &elecMode->fil);
+  elecMode_state -> packed_fil = 0;
 }
 
-/** Frees memory of Electrical Eigenmode state struct. */
+/** Frees memory of Electrical Eigenmode state struct. The struct itself is not freed
+  * (mode States of a Cavity belong to its Cavity State), nor are packed filter states (see Cavity_State_Deallocate). */
 void ElecMode_State_Deallocate(ElecMode_State *elecMode_state)
 {
-  Filter_State_Deallocate(&elecMode_state->fil_state);
-  free(elecMode_state);
+  if(!elecMode_state->packed_fil) Filter_State_Deallocate(&elecMode_state->fil_state);
 }
 
 /** Helper routine to get a reference to a given Electrical mode given the Cavity struct. */
@@ -156,30 +169,134 @@ ElecMode_State *ElecMode_State_Get(Cavity_State *cav_state, int idx)
 }
 
 /** Takes a previously configured Cavity and allocates its State struct accordingly.
-  * It allocates states for the Cavity's Electrical modes recursively. */
+  * It allocates states for the Cavity's Electrical modes recursively
+  * (in one contiguous block), and the packed filter states and work arrays for packed Cavities. */
 void Cavity_State_Allocate(Cavity_State *cav_state, Cavity *cav)
 {
+  int i, n = cav->n_modes;
 
   cav_state -> E_probe = (double complex) 0.0;
   cav_state -> E_reverse = (double complex) 0.0;
   cav_state -> Kg = (double complex) 0.0;
-  cav_state -> elecMode_state_net = (ElecMode_State**)calloc(cav->n_modes,sizeof(ElecMode_State*));
+  cav_state -> elecMode_state_net = (ElecMode_State**)State_Calloc(n,sizeof(ElecMode_State*));
+  cav_state -> elecMode_state_block = (ElecMode_State*)State_Calloc(n,sizeof(ElecMode_State));
 
-  int i;
-  for(i=0;i<cav->n_modes;i++) {
-      cav_state -> elecMode_state_net[i] = (ElecMode_State*)calloc(1,sizeof(ElecMode_State));
+  for(i=0;i<n;i++) {
+      cav_state -> elecMode_state_net[i] = &cav_state -> elecMode_state_block[i];
       ElecMode_State_Allocate(cav_state -> elecMode_state_net[i], cav->elecMode_net[i]);
   }
+
+  if(cav->packed) {
+    // Packed filter states: point the modes' Filter_States into them
+    cav_state -> fil_state = (double complex *)State_Calloc(n,sizeof(double complex));
+    cav_state -> fil_input = (double complex *)State_Calloc(n,sizeof(double complex));
+    for(i=0;i<n;i++) {
+      cav_state -> elecMode_state_block[i].fil_state.state = &cav_state -> fil_state[i];
+      cav_state -> elecMode_state_block[i].fil_state.input = &cav_state -> fil_input[i];
+      cav_state -> elecMode_state_block[i].packed_fil = 1;
+    }
+
+    // Work arrays of the packed kernel (single allocation)
+    double *work = (double *)State_Calloc(10*n,sizeof(double));
+    cav_state -> rot_re = work;
+    cav_state -> rot_im = work + n;
+    cav_state -> bph_re = work + 2*n;
+    cav_state -> bph_im = work + 3*n;
+    cav_state -> v_re = work + 4*n;
+    cav_state -> v_im = work + 5*n;
+    cav_state -> p_re = work + 6*n;
+    cav_state -> p_im = work + 7*n;
+    cav_state -> e_re = work + 8*n;
+    cav_state -> e_im = work + 9*n;
+  } else {
+    cav_state -> fil_state = NULL;
+    cav_state -> fil_input = NULL;
+    cav_state -> rot_re = cav_state -> rot_im = NULL;
+    cav_state -> bph_re = cav_state -> bph_im = NULL;
+    cav_state -> v_re = cav_state -> v_im = NULL;
+    cav_state -> p_re = cav_state -> p_im = NULL;
+    cav_state -> e_re = cav_state -> e_im = NULL;
+  }
 }
 
 /** Frees memory of Cavity state struct. */
 void Cavity_State_Deallocate(Cavity_State *cav_state, Cavity *cav)
 {
+  // Packed filter states are released below
   for(int i=0;i<cav->n_modes;i++) {
-      ElecMode_State_Deallocate(cav_state -> elecMode_state_net[i]);
+    ElecMode_State_Deallocate(&cav_state -> elecMode_state_block[i]);
   }
+  free(cav_state -> fil_state);
+  free(cav_state -> fil_input);
+  free(cav_state -> rot_re);  // Base of the work arrays
+  free(cav_state -> elecMode_state_block);
   free(cav_state -> elecMode_state_net);
-  free(cav_state);
+}
+
+/** Helper routine for the unit phasor exp(-j*theta) of a small angle theta:
+  * Taylor series (error below 1e-16 for |theta| < ELECMODE_SMALL_ANGLE), cexp otherwise. */
+static inline double complex Small_Angle_Phasor(double theta)
+{
+  if(fabs(theta) >= ELECMODE_SMALL_ANGLE) return cexp(-I*theta);
+
+  double theta_2 = theta*theta;
+  double c = 1.0 - theta_2*(1.0/2.0 - theta_2*(1.0/24.0 - theta_2/720.0));
+  double s = theta*(1.0 - theta_2*(1.0/6.0 - theta_2*(1.0/120.0 - theta_2/5040.0)));
+  return c - I*s;
+}
+
+/** Helper routine to re-anchor the mode's phasors to their exact values
+  * (rotator, per-step increment and beam timing phasor), removing the drift of their incremental updates. */
+static void ElecMode_Anchor_Phasors(
+  ElecMode *elecMode,             ///< Pointer to ElecMode struct
+  ElecMode_State *elecMode_state  ///< Pointer to ElecMode State
+  )
+{
+  elecMode_state->rotator = cexp(-I*elecMode_state->d_phase);
+  elecMode_state->rot_step = cexp(-I*elecMode_state->rot_omega*elecMode->Tstep);
+  elecMode_state->beam_phasor = cexp(-I*elecMode->LO_w0*elecMode_state->beam_delta_tz);
+  elecMode_state->rot_count = 0;
+}
+
+/** Helper routine to advance the mode's phase (and phase rotator) by one step
+  * and update the beam timing phasor for the current timing jitter.
+  * Changes of the frequency offset and of the timing jitter are applied to the phasors
+  * incrementally (see Small_Angle_Phasor); phasors are re-anchored every ELECMODE_ROT_ANCHOR steps. */
+static void ElecMode_Update_Phasors(
+  ElecMode *elecMode,             ///< Pointer to ElecMode struct
+  double delta_tz,                ///< Timing jitter in seconds (RF reference noise)
+  ElecMode_State *elecMode_state  ///< Pointer to ElecMode State
+  )
+{
+  double omega_now=0.0, d_phase_now=0.0;
+
+  // Timing noise phasor: rotate by the change of the timing jitter
+  if(delta_tz != elecMode_state->beam_delta_tz) {
+    elecMode_state->beam_phasor *= Small_Angle_Phasor(elecMode->LO_w0*(delta_tz - elecMode_state->beam_delta_tz));
+    elecMode_state->beam_delta_tz = delta_tz;
+  }
+
+  // Integrate mode's offset frequency to obtain phase
+  // Add baseline frequency offset to perturbation (delta_omega) to obtain total frequency offset
+  omega_now = elecMode->omega_d_0 + elecMode_state->delta_omega;
+  d_phase_now = elecMode_state-> d_phase + omega_now * elecMode->Tstep;
+  // Wrap phase to keep its precision over long runs
+  if(fabs(d_phase_now) > M_PI) d_phase_now = remainder(d_phase_now, 2*M_PI);
+  elecMode_state-> d_phase = d_phase_now; // Store phase state
+
+  // Per-step increment (rot_step = exp(-j*omega_now*Tstep)): rotate by the change of the frequency offset
+  if(omega_now != elecMode_state->rot_omega) {
+    elecMode_state->rot_step *= Small_Angle_Phasor((omega_now - elecMode_state->rot_omega)*elecMode->Tstep);
+    elecMode_state->rot_omega = omega_now;
+  }
+
+  // Advance phase rotator (rotator = exp(-j*d_phase_now))
+  if(++elecMode_state->rot_count >= ELECMODE_ROT_ANCHOR) {
+    // Re-anchor to the accumulated phase (removes magnitude and phase drift)
+    ElecMode_Anchor_Phasors(elecMode, elecMode_state);
+  } else {
+    elecMode_state->rotator *= elecMode_state->rot_step;
+  }
 }
 
 /** Step function for Electrical Eigenmode:
@@ -203,27 +320,23 @@ double complex ElecMode_Step(
 {
   // Intermediate signals
   double complex v_beam=0.0, v_drive=0.0, v_in=0.0, v_out=0.0;
-  double omega_now=0.0, d_phase_now=0.0;
+
+  // Advance mode's phase and update timing noise phasor
+  ElecMode_Update_Phasors(elecMode, delta_tz, elecMode_state);
 
   // Beam-induced voltage (convert current to voltage and add timing noise)
-  v_beam = beam_current * elecMode -> k_beam * cexp(-I*elecMode->LO_w0*delta_tz);  // k_beam = (R/Q) * Q_L
+  v_beam = beam_current * elecMode -> k_beam * elecMode_state->beam_phasor;  // k_beam = (R/Q) * Q_L
 
   // RF drive term
   v_drive = Kg_fwd * elecMode -> k_drive; // Drive term (k_drive = 2*sqrt(Q_drive*(R/Q))
 
-  // Integrate mode's offset frequency to obtain phase
-  // Add baseline frequency offset to perturbation (delta_omega) to obtain total frequency offset
-  omega_now = elecMode->omega_d_0 + elecMode_state->delta_omega;
-  d_phase_now = elecMode_state-> d_phase + omega_now * elecMode->Tstep;
-  elecMode_state-> d_phase = d_phase_now; // Store phase state
-
   // Calculate mode's driving term (drive + beam)
   // Note the absence of omega_f on this term with respect to the governing equations
   // That term implies the unity gain at DC: normalization takes place in Filter_Step.
-  v_in = (v_drive + v_beam)*cexp(-I*d_phase_now);
+  v_in = (v_drive + v_beam)*elecMode_state->rotator;
 
-  // Apply first-order low-pass filter
-  v_out = Filter_Step(&(elecMode->fil), v_in, &(elecMode_state->fil_state))*cexp(I*d_phase_now);
+  // Apply first-order low-pass filter (rotate back: conj(rotator) = exp(j*d_phase_now))
+  v_out = Filter_Step(&(elecMode->fil), v_in, &(elecMode_state->fil_state))*conj(elecMode_state->rotator);
 
   // Calculate outputs based on v_vout
   elecMode_state->V_2 = pow(cabs(v_out), 2.0);  // Voltage squared
@@ -256,6 +369,101 @@ void Cavity_Allocate_In(
   cav -> nom_grad = nom_grad;
   cav -> n_modes = n_modes;
   cav-> elecMode_net = elecMode_net;
+
+  // Packed copy of the Electrical modes
+  cav -> packed = 0;
+  Cavity_Pack(cav);
+
+  // Step every sample of Cavity_Step_Block
+  cav -> fast_forward = 0;
+}
+
+/** Enable the quiescent fast-forward of Cavity_Step_Block: intervals of at least min_steps steps
+  * with constant inputs (timing jitter, drive and beam current) are advanced in closed form
+  * (see Cavity_Fast_Forward) instead of one step at a time. Disabled if min_steps < 1.
+  * Also applies to the RF Station driving the Cavity in open loop (see RF_Station_Step_Block).
+  * Results match regular stepping to within rounding errors (~1e-12 relative). */
+void Cavity_Set_Fast_Forward(
+  Cavity *cav,    ///< Pointer to Cavity struct
+  int min_steps   ///< Shortest constant-input interval advanced in closed form
+  )
+{
+  cav -> fast_forward = min_steps > 0 ? min_steps : 0;
+}
+
+/** Select the discretization method (FILTER_TUSTIN or FILTER_ZOH) of the filters of all
+  * the Cavity's Electrical modes (see Filter_Set_Discretization), and refresh the packed copy of the modes. */
+void Cavity_Set_Discretization(
+  Cavity *cav,    ///< Pointer to Cavity struct
+  int method      ///< Discretization method
+  )
+{
+  for(int i=0;i<cav->n_modes;i++) {
+    ElecMode *elecMode = cav->elecMode_net[i];
+    Filter_Set_Discretization(&elecMode->fil, method, elecMode->Tstep);
+  }
+  Cavity_Pack(cav);
+}
+
+/** Helper routine to release the packed copy of the Electrical modes. */
+static void Cavity_Unpack(Cavity *cav)
+{
+  if(!cav->packed) return;
+  free(cav->k_drive_re);
+  free(cav->k_drive_im);
+  free(cav->k_beam_re);
+  free(cav->k_beam_im);
+  free(cav->k_probe_re);
+  free(cav->k_probe_im);
+  free(cav->k_em_re);
+  free(cav->k_em_im);
+  free(cav->fil_version);
+  Filter_Bank_Deallocate(&cav->fil_bank);
+  cav->packed = 0;
+}
+
+/** (Re-)build the packed copy of the Cavity's Electrical modes used by Cavity_Step:
+  * couplings and filter coefficients in contiguous per-field arrays.
+  * Called by Cavity_Allocate_In; call again (before allocating Cavity States)
+  * if the Electrical modes are modified afterwards. Changes of the modes' filter
+  * coefficients alone are picked up by Cavity_Step (see Filter.version).
+  * Cavities with modes whose Filter is not single-pole are left unpacked. */
+void Cavity_Pack(Cavity *cav)
+{
+  int i, n = cav->n_modes;
+  ElecMode *elecMode;
+
+  Cavity_Unpack(cav);
+  for(i=0;i<n;i++) {
+    if(!cav->elecMode_net[i]->fil.single_pole) return;
+  }
+
+  cav->k_drive_re = (double *)calloc(n,sizeof(double));
+  cav->k_drive_im = (double *)calloc(n,sizeof(double));
+  cav->k_beam_re = (double *)calloc(n,sizeof(double));
+  cav->k_beam_im = (double *)calloc(n,sizeof(double));
+  cav->k_probe_re = (double *)calloc(n,sizeof(double));
+  cav->k_probe_im = (double *)calloc(n,sizeof(double));
+  cav->k_em_re = (double *)calloc(n,sizeof(double));
+  cav->k_em_im = (double *)calloc(n,sizeof(double));
+  cav->fil_version = (int *)calloc(n,sizeof(int));
+  Filter_Bank_Allocate_In(&cav->fil_bank, n);
+
+  for(i=0;i<n;i++) {
+    elecMode = cav->elecMode_net[i];
+    cav->k_drive_re[i] = creal(elecMode->k_drive);
+    cav->k_drive_im[i] = cimag(elecMode->k_drive);
+    cav->k_beam_re[i] = creal(elecMode->k_beam);
+    cav->k_beam_im[i] = cimag(elecMode->k_beam);
+    cav->k_probe_re[i] = creal(elecMode->k_probe);
+    cav->k_probe_im[i] = cimag(elecMode->k_probe);
+    cav->k_em_re[i] = creal(elecMode->k_em);
+    cav->k_em_im[i] = cimag(elecMode->k_em);
+    Filter_Bank_Append_Filter(&cav->fil_bank, &elecMode->fil);
+    cav->fil_version[i] = elecMode->fil.version;
+  }
+
+  cav->packed = 1;
 }
 /** Allocates memory for a Cavity struct and fills it in with the values passed as arguments.
   * Returns a pointer to the newly allocated struct. It assumes that the Electrical Eigenmodes have been previously allocated. */
@@ -285,9 +493,77 @@ void Cavity_Deallocate(Cavity *cav)
   for(int i=0;i<cav->n_modes;i++) {
       ElecMode_Deallocate(cav->elecMode_net[i]);
   }
+  Cavity_Unpack(cav);
   free(cav);
 }
 
+/** Packed Cavity kernel: steps all the Electrical modes of a packed Cavity at once.
+  * Same operations as ElecMode_Step (with a single-pole Filter), with complex products
+  * written out in real arithmetic in the same order, so that results are identical.
+  * Arrays are passed as restrict-qualified arguments so that the compiler can vectorize the loop over modes;
+  * filter states and inputs are interleaved (real, imaginary) pairs. */
+static void Cavity_Modes_Kernel(
+  int n, double Kg_re, double Kg_im, double beam_current,
+  const double * restrict k_drive_re, const double * restrict k_drive_im,
+  const double * restrict k_beam_re, const double * restrict k_beam_im,
+  const double * restrict k_probe_re, const double * restrict k_probe_im,
+  const double * restrict k_em_re, const double * restrict k_em_im,
+  const double * restrict a_re, const double * restrict a_im,
+  const double * restrict b_re, const double * restrict b_im,
+  const double * restrict scale,
+  const double * restrict w_now, const double * restrict w_prev,
+  const double * restrict rot_re, const double * restrict rot_im,
+  const double * restrict bph_re, const double * restrict bph_im,
+  double * restrict s, double * restrict u,
+  double * restrict v_re, double * restrict v_im,
+  double * restrict p_re, double * restrict p_im,
+  double * restrict e_re, double * restrict e_im
+  )
+{
+  int k;
+  for(k=0;k<n;k++) {
+    // Beam-induced voltage: beam_current * k_beam * beam_phasor
+    double kb_re = beam_current*k_beam_re[k];
+    double kb_im = beam_current*k_beam_im[k];
+    double vb_re = kb_re*bph_re[k] - kb_im*bph_im[k];
+    double vb_im = kb_re*bph_im[k] + kb_im*bph_re[k];
+
+    // RF drive term: Kg * k_drive
+    double vd_re = Kg_re*k_drive_re[k] - Kg_im*k_drive_im[k];
+    double vd_im = Kg_re*k_drive_im[k] + Kg_im*k_drive_re[k];
+
+    // Mode's driving term, rotated by exp(-j*d_phase)
+    double sum_re = vd_re + vb_re;
+    double sum_im = vd_im + vb_im;
+    double x_re = sum_re*rot_re[k] - sum_im*rot_im[k];
+    double x_im = sum_re*rot_im[k] + sum_im*rot_re[k];
+
+    // Single-pole filter (see Filter_Step_Single_Pole)
+    double vi_re = w_now[k]*x_re + w_prev[k]*u[2*k];
+    double vi_im = w_now[k]*x_im + w_prev[k]*u[2*k+1];
+    u[2*k] = x_re;
+    u[2*k+1] = x_im;
+    double st_re = (a_re[k]*s[2*k] - a_im[k]*s[2*k+1]) + (b_re[k]*vi_re - b_im[k]*vi_im);
+    double st_im = (a_re[k]*s[2*k+1] + a_im[k]*s[2*k]) + (b_re[k]*vi_im + b_im[k]*vi_re);
+    s[2*k] = st_re;
+    s[2*k+1] = st_im;
+    double o_re = st_re*scale[k];
+    double o_im = st_im*scale[k];
+
+    // Rotate back: output * conj(rotator)
+    double vo_re = o_re*rot_re[k] + o_im*rot_im[k];
+    double vo_im = o_im*rot_re[k] - o_re*rot_im[k];
+    v_re[k] = vo_re;
+    v_im[k] = vo_im;
+
+    // Probe and emitted signals
+    p_re[k] = vo_re*k_probe_re[k] - vo_im*k_probe_im[k];
+    p_im[k] = vo_re*k_probe_im[k] + vo_im*k_probe_re[k];
+    e_re[k] = vo_re*k_em_re[k] - vo_im*k_em_im[k];
+    e_im[k] = vo_re*k_em_im[k] + vo_im*k_em_re[k];
+  }
+}
+
 /** Step function for Cavity model:
   * Calculates the state for the next simulation step.
   * Returns the overall cavity accelerating voltage (as seen by the beam) and stores current state in State struct. */
@@ -310,20 +586,57 @@ double complex Cavity_Step(
   cav_state->Kg = Kg; // Instantaneous propagation through perfect waveguide for now
 
   int i;
-  // Iterate over Electrical Modes and add up
-  // mode contributions to probe and reflected signals
-  for(i=0;i<cav->n_modes;i++){
-
-    // Sum of mode's accelerating voltages (Seen by the beam, no port couplings)
-    v_out += ElecMode_Step(cav->elecMode_net[i], Kg_fwd, beam_current, delta_tz, cav_state->elecMode_state_net[i], &v_probe_now, &v_em_now);
-
-    // Sum of cavity probe signals (including probe coupling and phase shift between cavity port and probe ADC)
-    v_probe_sum += v_probe_now;
-
-    // Sum of emitted voltages (including emitted coupling and phase shift between cavity port and reverse ADC)
-    v_em_sum += v_em_now;
-
-  } // End of Electrical mode iteration
+  if(cav->packed && cav_state->fil_state) {
+    // Packed Cavity: advance the modes' phasors, then step all modes at once
+    for(i=0;i<cav->n_modes;i++){
+      ElecMode_State *elecMode_state = cav_state->elecMode_state_net[i];
+      // Refresh the packed coefficients of a Filter changed since it was packed
+      if(cav->elecMode_net[i]->fil.version != cav->fil_version[i]) {
+        Filter_Bank_Set_Filter(&cav->fil_bank, i, &cav->elecMode_net[i]->fil);
+        cav->fil_version[i] = cav->elecMode_net[i]->fil.version;
+      }
+      ElecMode_Update_Phasors(cav->elecMode_net[i], delta_tz, elecMode_state);
+      cav_state->rot_re[i] = creal(elecMode_state->rotator);
+      cav_state->rot_im[i] = cimag(elecMode_state->rotator);
+      cav_state->bph_re[i] = creal(elecMode_state->beam_phasor);
+      cav_state->bph_im[i] = cimag(elecMode_state->beam_phasor);
+    }
+
+    // (beam current is taken as real, as in ElecMode_Step)
+    Cavity_Modes_Kernel(cav->n_modes, creal(Kg_fwd), cimag(Kg_fwd), creal(beam_current),
+      cav->k_drive_re, cav->k_drive_im, cav->k_beam_re, cav->k_beam_im,
+      cav->k_probe_re, cav->k_probe_im, cav->k_em_re, cav->k_em_im,
+      cav->fil_bank.a_re, cav->fil_bank.a_im, cav->fil_bank.b_re, cav->fil_bank.b_im,
+      cav->fil_bank.scale, cav->fil_bank.w_now, cav->fil_bank.w_prev,
+      cav_state->rot_re, cav_state->rot_im, cav_state->bph_re, cav_state->bph_im,
+      (double *) cav_state->fil_state, (double *) cav_state->fil_input,
+      cav_state->v_re, cav_state->v_im, cav_state->p_re, cav_state->p_im,
+      cav_state->e_re, cav_state->e_im);
+
+    // Add up mode contributions (in mode order) and store voltage squared
+    for(i=0;i<cav->n_modes;i++){
+      double complex v_mode = cav_state->v_re[i] + I*cav_state->v_im[i];
+      cav_state->elecMode_state_net[i]->V_2 = pow(cabs(v_mode), 2.0);
+      v_out += v_mode;
+      v_probe_sum += cav_state->p_re[i] + I*cav_state->p_im[i];
+      v_em_sum += cav_state->e_re[i] + I*cav_state->e_im[i];
+    }
+  } else {
+    // Iterate over Electrical Modes and add up
+    // mode contributions to probe and reflected signals
+    for(i=0;i<cav->n_modes;i++){
+
+      // Sum of mode's accelerating voltages (Seen by the beam, no port couplings)
+      v_out += ElecMode_Step(cav->elecMode_net[i], Kg_fwd, beam_current, delta_tz, cav_state->elecMode_state_net[i], &v_probe_now, &v_em_now);
+
+      // Sum of cavity probe signals (including probe coupling and phase shift between cavity port and probe ADC)
+      v_probe_sum += v_probe_now;
+
+      // Sum of emitted voltages (including emitted coupling and phase shift between cavity port and reverse ADC)
+      v_em_sum += v_em_now;
+
+    } // End of Electrical mode iteration
+  }
 
   // Re-apply propagation through waveguide between cavity port and directional coupler on the reverse path
   double complex Kg_rfl = Kg; // Instantaneous propagation through perfect waveguide for now
@@ -337,6 +650,216 @@ double complex Cavity_Step(
   return v_out;
 }
 
+/** Advance a Cavity by n steps of constant inputs in closed form:
+  * after one regular step, every Electrical mode's voltage is its steady state plus a transient
+  * scaled by g = a*conj(rot_step) every step, and the mode's Filter State jumps to the last step
+  * (see Filter_Fast_Forward). Recorded signals (any of V, E_probe, E_reverse may be NULL)
+  * are evaluated from these geometric sequences.
+  * Returns 0, or -1 (Cavity State untouched) if a mode's Filter is not single-pole. */
+int Cavity_Fast_Forward(Cavity *cav, int n,
+  double delta_tz, double complex Kg, double complex beam_current,
+  double complex *V, double complex *E_probe, double complex *E_reverse,
+  Cavity_State *cav_state)
+{
+  int i, k, n_modes = cav->n_modes;
+  double complex v_in[n_modes], v_ss[n_modes], v_tr[n_modes], g[n_modes];
+  double complex v_out, v_probe_sum, v_em_sum, v_mode, fil_out;
+
+  for(i=0;i<n_modes;i++) {
+    if(!cav->elecMode_net[i]->fil.single_pole) return -1;
+  }
+
+  // First step (previous filter inputs as stored, phasors updated for the inputs)
+  v_out = Cavity_Step(cav, delta_tz, Kg, beam_current, cav_state);
+  if(V) V[0] = v_out;
+  if(E_probe) E_probe[0] = cav_state->E_probe;
+  if(E_reverse) E_reverse[0] = cav_state->E_reverse;
+  if(n <= 1) return 0;
+
+  // Steady-state voltage and transient of every mode
+  for(i=0;i<n_modes;i++) {
+    ElecMode *elecMode = cav->elecMode_net[i];
+    ElecMode_State *elecMode_state = cav_state->elecMode_state_net[i];
+    double complex rot = elecMode_state->rot_step;
+
+    v_in[i] = Kg*elecMode->k_drive + creal(beam_current)*elecMode->k_beam*elecMode_state->beam_phasor;
+    v_ss[i] = Filter_Phasor_Gain(&elecMode->fil, rot)*v_in[i];
+    v_tr[i] = elecMode_state->fil_state.state[0]*elecMode->fil.sp_scale*conj(elecMode_state->rotator) - v_ss[i];
+    g[i] = elecMode->fil.coeffs[0]*conj(rot);
+  }
+
+  // Recorded signals of the intermediate steps
+  if(V || E_probe || E_reverse) {
+    for(k=1;k<n-1;k++) {
+      v_out = 0.0; v_probe_sum = 0.0; v_em_sum = 0.0;
+      for(i=0;i<n_modes;i++) {
+        v_tr[i] *= g[i];
+        v_mode = v_ss[i] + v_tr[i];
+        v_out += v_mode;
+        v_probe_sum += v_mode*cav->elecMode_net[i]->k_probe;
+        v_em_sum += v_mode*cav->elecMode_net[i]->k_em;
+      }
+      if(V) V[k] = v_out;
+      if(E_probe) E_probe[k] = v_probe_sum;
+      if(E_reverse) E_reverse[k] = v_em_sum-Kg;
+    }
+  }
+
+  // Jump to the last step: filter states, accumulated phases (rotators re-anchored) and outputs
+  v_out = 0.0; v_probe_sum = 0.0; v_em_sum = 0.0;
+  for(i=0;i<n_modes;i++) {
+    ElecMode *elecMode = cav->elecMode_net[i];
+    ElecMode_State *elecMode_state = cav_state->elecMode_state_net[i];
+    double complex rot = elecMode_state->rot_step;
+
+    Filter_Fast_Forward(&elecMode->fil, &elecMode_state->fil_state, v_in[i]*elecMode_state->rotator*rot, rot, n-1, &fil_out);
+
+    elecMode_state->d_phase += (n-1)*elecMode_state->rot_omega*elecMode->Tstep;
+    if(fabs(elecMode_state->d_phase) > M_PI) elecMode_state->d_phase = remainder(elecMode_state->d_phase, 2*M_PI);
+    ElecMode_Anchor_Phasors(elecMode, elecMode_state);
+
+    v_mode = fil_out*conj(elecMode_state->rotator);
+    elecMode_state->V_2 = pow(cabs(v_mode), 2.0);
+    v_out += v_mode;
+    v_probe_sum += v_mode*elecMode->k_probe;
+    v_em_sum += v_mode*elecMode->k_em;
+  }
+
+  cav_state -> E_probe = v_probe_sum;
+  cav_state -> E_reverse = v_em_sum-Kg;
+  cav_state -> V = v_out;
+  if(V) V[n-1] = v_out;
+  if(E_probe) E_probe[n-1] = v_probe_sum;
+  if(E_reverse) E_reverse[n-1] = cav_state->E_reverse;
+
+  return 0;
+}
+
+/** Block step function for Cavity model (open loop):
+  * Calls Cavity_Step once per sample over n samples of input waveforms,
+  * and records the chosen Cavity signals after every step.
+  * Any input waveform may be NULL (zero input), and any output waveform may be NULL (not recorded).
+  * With fast-forward enabled (see Cavity_Set_Fast_Forward), long enough intervals of constant inputs
+  * are advanced in closed form; the Cavity is stepped as usual whenever an input changes. */
+void Cavity_Step_Block(
+  Cavity *cav,                  ///< Pointer to Cavity struct
+  int n,                        ///< Number of simulation steps
+  // Input waveforms (length n)
+  double *delta_tz,             ///< Timing jitter in seconds (RF reference noise)
+  double complex *Kg,           ///< Drive input in sqrt(W)
+  double complex *beam_current, ///< Beam current in Amps
+  // Output waveforms (length n)
+  double complex *V,            ///< Overall cavity accelerating voltage
+  double complex *E_probe,      ///< Cavity field probe signal
+  double complex *E_reverse,    ///< Reverse (emitted minus reflected) signal
+  double *delta_omega,          ///< Fundamental mode's frequency perturbation in rad/s
+  Cavity_State *cav_state       ///< Pointer to the Cavity State
+  )
+{
+  int i, j, run;
+  double complex V_now;
+
+  for(i=0;i<n;i++) {
+    // Constant-input interval starting at step i (packed Cavities have single-pole modes only)
+    if(cav->fast_forward > 0 && cav->packed) {
+      for(j=i+1;j<n;j++) {
+        if(delta_tz && delta_tz[j] != delta_tz[i]) break;
+        if(Kg && Kg[j] != Kg[i]) break;
+        if(beam_current && beam_current[j] != beam_current[i]) break;
+      }
+      run = j-i;
+      if(run >= cav->fast_forward && Cavity_Fast_Forward(cav, run,
+        delta_tz ? delta_tz[i] : 0.0, Kg ? Kg[i] : 0.0, beam_current ? beam_current[i] : 0.0,
+        V ? V+i : NULL, E_probe ? E_probe+i : NULL, E_reverse ? E_reverse+i : NULL, cav_state) == 0) {
+        if(delta_omega) for(j=i;j<i+run;j++) delta_omega[j] = cav_state->elecMode_state_net[cav->fund_index]->delta_omega;
+        i += run-1;
+        continue;
+      }
+    }
+
+    V_now = Cavity_Step(cav,
+      delta_tz ? delta_tz[i] : 0.0,
+      Kg ? Kg[i] : 0.0,
+      beam_current ? beam_current[i] : 0.0,
+      cav_state);
+
+    if(V) V[i] = V_now;
+    if(E_probe) E_probe[i] = cav_state->E_probe;
+    if(E_reverse) E_reverse[i] = cav_state->E_reverse;
+    if(delta_omega) delta_omega[i] = cav_state->elecMode_state_net[cav->fund_index]->delta_omega;
+  }
+}
+
+/** Helper routine for the steady state of a Cavity driven by constant drive and beam current:
+  * every Electrical mode settles to a constant voltage (its filter state rotating with the mode's
+  * phase rotator, at the mode's current frequency offset, including Lorentz-force detuning).
+  * Returns the probe signal and, if set is non-zero, writes the steady state into the Cavity State. */
+static double complex Cavity_Steady_Modes(Cavity *cav, double delta_tz, double complex Kg,
+  double complex beam_current, Cavity_State *cav_state, int set)
+{
+  double complex v_out=0.0, v_probe_sum=0.0, v_em_sum=0.0;
+
+  for(int i=0;i<cav->n_modes;i++) {
+    ElecMode *elecMode = cav->elecMode_net[i];
+    ElecMode_State *elecMode_state = cav_state->elecMode_state_net[i];
+    double complex rot = cexp(-I*(elecMode->omega_d_0 + elecMode_state->delta_omega)*elecMode->Tstep);
+    double complex beam_phasor = cexp(-I*elecMode->LO_w0*delta_tz);
+
+    // Mode's driving term (as in ElecMode_Step) and steady-state voltage
+    double complex v_in = Kg*elecMode->k_drive + creal(beam_current)*elecMode->k_beam*beam_phasor;
+    double complex v_mode = Filter_Phasor_Gain(&elecMode->fil, rot)*v_in;
+
+    if(set) {
+      // Filter state for the driving term rotated by the current rotator, advancing by rot every step
+      Filter_Set_Steady_State(&elecMode->fil, &elecMode_state->fil_state, v_in*elecMode_state->rotator, rot);
+      elecMode_state->V_2 = pow(cabs(v_mode), 2.0);
+      elecMode_state->beam_phasor = beam_phasor;
+      elecMode_state->beam_delta_tz = delta_tz;
+    }
+
+    v_out += v_mode;
+    v_probe_sum += v_mode*elecMode->k_probe;
+    v_em_sum += v_mode*elecMode->k_em;
+  }
+
+  if(set) {
+    cav_state -> Kg = Kg;
+    cav_state -> E_probe = v_probe_sum;
+    cav_state -> E_reverse = v_em_sum-Kg;
+    cav_state -> V = v_out;
+  }
+
+  return v_probe_sum;
+}
+
+/** Steady-state field probe signal of a Cavity for constant drive and beam current
+  * (at the current frequency offsets of its Electrical modes). The Cavity State is not modified. */
+double complex Cavity_Steady_Probe(
+  Cavity *cav,                ///< Pointer to Cavity struct
+  double delta_tz,            ///< Timing jitter in seconds (RF reference noise)
+  double complex Kg,          ///< Drive input in sqrt(W)
+  double complex beam_current, ///< Beam current in Amps
+  Cavity_State *cav_state     ///< Pointer to the Cavity State
+  )
+{
+  return Cavity_Steady_Modes(cav, delta_tz, Kg, beam_current, cav_state, 0);
+}
+
+/** Set a Cavity State to its steady state for constant drive and beam current
+  * (at the current frequency offsets of its Electrical modes), so that stepping the Cavity
+  * with the same inputs leaves its signals unchanged. Returns the overall cavity accelerating voltage. */
+double complex Cavity_Set_Steady_State(
+  Cavity *cav,                ///< Pointer to Cavity struct
+  double delta_tz,            ///< Timing jitter in seconds (RF reference noise)
+  double complex Kg,          ///< Drive input in sqrt(W)
+  double complex beam_current, ///< Beam current in Amps
+  Cavity_State *cav_state     ///< Pointer to the Cavity State
+  )
+{
+  Cavity_Steady_Modes(cav, delta_tz, Kg, beam_current, cav_state, 1);
+  return cav_state->V;
+}
+
 /** Helper routine to zero out Cavity state. Useful to restore initial state in unit tests. */
 void Cavity_Clear(Cavity *cav, Cavity_State *cav_state)
 {
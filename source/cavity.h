@@ -23,16 +23,49 @@ typedef struct str_elecmode{
 	double *C;  ///< Matrix coefficients: Convert displacement to frequency shift
 } ElecMode;
 
+/** Number of steps after which the mode's phase rotator is re-anchored
+  * to the exact phasor of the (wrapped) accumulated phase */
+#define ELECMODE_ROT_ANCHOR 256
+
+/** Largest phase change (in radians) applied to the mode's phasors with a small-angle series instead of cexp */
+#define ELECMODE_SMALL_ANGLE 1e-2
+
 typedef ElecMode * ElecMode_p;
 typedef ElecMode ** ElecMode_dp;
 
+/**
+ * The mode's phase is tracked with a unit phasor (rotator = exp(-j*d_phase)),
+ * advanced every step by multiplying it by rot_step = exp(-j*omega*Tstep). When the
+ * total frequency offset (or the timing jitter) changes, rot_step (or beam_phasor) is
+ * rotated by the change with a small-angle series rather than re-evaluated with cexp.
+ * d_phase is wrapped to [-pi, pi] and all three phasors are re-anchored to their exact
+ * values every ELECMODE_ROT_ANCHOR steps. The phasors match direct evaluation
+ * (exp(-j*d_phase), exp(-j*LO_w0*delta_tz)) to ~1e-12, and the error stays
+ * bounded over arbitrarily long runs.
+ */
 typedef struct str_elecmode_state{
 	Filter_State fil_state;
 	double delta_omega;
 	double d_phase;
 	double V_2;
+
+	double complex rotator;     ///< exp(-j*d_phase)
+	double complex rot_step;    ///< Per-step rotator increment exp(-j*rot_omega*Tstep)
+	double rot_omega;           ///< Frequency offset rot_step has been computed for
+	int rot_count;              ///< Steps since the rotator was last re-anchored
+	double complex beam_phasor; ///< Beam timing phasor exp(-j*LO_w0*beam_delta_tz)
+	double beam_delta_tz;       ///< Timing jitter beam_phasor has been computed for
+	int packed_fil;             ///< Set when fil_state points into the packed arrays of a Cavity State
 } ElecMode_State;
 
+/**
+ * Besides the array of Electrical modes, a Cavity keeps a packed copy of the modes'
+ * couplings and filter coefficients in contiguous per-field arrays (see Cavity_Pack),
+ * which Cavity_Step sweeps in a single loop over modes. The modes' Filters remain the
+ * reference: Cavity_Step refreshes the packed coefficients of a mode whose Filter has
+ * changed since it was packed (e.g. by Filter_Set_Discretization). Packing requires every
+ * mode's Filter to be single-pole; otherwise Cavity_Step steps the modes one by one.
+ */
 typedef struct str_cavity{
 	double rf_phase, design_voltage;
 	int fund_index;
@@ -40,12 +73,36 @@ typedef struct str_cavity{
 	double nom_grad;
 	int n_modes;
 	ElecMode_dp elecMode_net;
+
+	int packed;                       ///< Set when the modes have been packed
+	double *k_drive_re, *k_drive_im;  ///< Packed drive port couplings
+	double *k_beam_re, *k_beam_im;    ///< Packed beam couplings
+	double *k_probe_re, *k_probe_im;  ///< Packed probe port couplings
+	double *k_em_re, *k_em_im;        ///< Packed emitted port couplings
+	Filter_Bank fil_bank;             ///< Packed filter coefficients of the modes
+	int *fil_version;                 ///< Versions of the modes' Filters the packed coefficients were copied from
+
+	int fast_forward;                 ///< Shortest constant-input interval Cavity_Step_Block jumps over (0: disabled)
 } Cavity;
 
+/**
+ * Electrical mode states are stored in one contiguous block (elecMode_state_net
+ * points into it). For packed Cavities the modes' Filter_States point into the
+ * packed fil_state and fil_input arrays, so that either view can be used.
+ */
 typedef struct str_cavity_state{
 	double complex E_probe, E_reverse, E_fwd, V;
   double complex Kg;
 	ElecMode_State **elecMode_state_net;
+
+	ElecMode_State *elecMode_state_block;    ///< Contiguous storage of the Electrical mode states
+	double complex *fil_state, *fil_input;  ///< Packed filter states and previous inputs (packed Cavities)
+	// Per-step work arrays of the packed kernel (of length n_modes)
+	double *rot_re, *rot_im;  ///< Mode phase rotators
+	double *bph_re, *bph_im;  ///< Beam timing phasors
+	double *v_re, *v_im;      ///< Mode accelerating voltages
+	double *p_re, *p_im;      ///< Mode probe signals
+	double *e_re, *e_im;      ///< Mode emitted signals
 } Cavity_State;
 
 void Cavity_Allocate_In(Cavity *cav,
@@ -60,9 +117,20 @@ Cavity * Cavity_Allocate_New(ElecMode_dp elec_mode_net, int n_modes,
   int fund_index);
 
 void Cavity_Deallocate(Cavity *cav);
+void Cavity_Pack(Cavity *cav);
+void Cavity_Set_Fast_Forward(Cavity *cav, int min_steps);
+int Cavity_Fast_Forward(Cavity *cav, int n, double delta_tz, double complex Kg, double complex beam_current,
+  double complex *V, double complex *E_probe, double complex *E_reverse, Cavity_State *cav_state);
+void Cavity_Set_Discretization(Cavity *cav, int method);
 
 double complex Cavity_Step(Cavity *cav, double delta_tz, double complex drive_in, double complex beam_current, Cavity_State *cav_state);
+void Cavity_Step_Block(Cavity *cav, int n,
+  double *delta_tz, double complex *Kg, double complex *beam_current,
+  double complex *V, double complex *E_probe, double complex *E_reverse, double *delta_omega,
+  Cavity_State *cav_state);
 void Cavity_Clear(Cavity *cav, Cavity_State *cav_state);
+double complex Cavity_Steady_Probe(Cavity *cav, double delta_tz, double complex Kg, double complex beam_current, Cavity_State *cav_state);
+double complex Cavity_Set_Steady_State(Cavity *cav, double delta_tz, double complex Kg, double complex beam_current, Cavity_State *cav_state);
 
 void Cavity_State_Allocate(Cavity_State *cav_state, Cavity *cav);
 void Cavity_State_Deallocate(Cavity_State *cav_state, Cavity *cav);
@@ -71,6 +71,189 @@ def unit_filter(dt=0.002):
     # Return PASS boolean to escalate diagnostics
     return filter_pass
 
+def unit_filter_block(dt=0.002):
+    """
+    Unit test for Filter_Step_Block (filter.c/h)
+    Run the same input waveform through Filter_Step (one call per sample) and
+    Filter_Step_Block (split in two blocks) and return PASS/FAIL boolean.
+    """
+
+    tmax = 5.0
+    nt = int(tmax/dt)
+    nblock = nt/3
+
+    # Two identical filters with two cascaded poles, the second one with two modes in parallel
+    fils = []
+    for k in xrange(2):
+        fil = acc.Filter()
+        acc.Filter_Allocate_In(fil, 2, 3)
+        poles = acc.complexdouble_Array(2)
+        poles[0] = -1.0+1.0j
+        acc.Filter_Append_Modes(fil, poles, 1, dt)
+        poles[0] = -2.0+5.0j
+        poles[1] = -2.0-5.0j
+        acc.Filter_Append_Modes(fil, poles, 2, dt)
+        fils.append(fil)
+
+    filnow = acc.Filter_State()
+    acc.Filter_State_Allocate(filnow, fils[0])
+    filnow_block = acc.Filter_State()
+    acc.Filter_State_Allocate(filnow_block, fils[1])
+
+    # Input waveform
+    trang = np.arange(0, nt)*dt
+    wave = np.exp(1j*trang)*np.sin(3.0*trang)
+
+    st = np.zeros(nt, dtype=np.complex)
+    st_block = np.zeros(nt, dtype=np.complex)
+
+    for i in xrange(nt):
+        st[i] = acc.Filter_Step(fils[0], wave[i], filnow)
+
+    # Process waveform in two blocks (state must carry over between blocks)
+    for start, stop in [(0, nblock), (nblock, nt)]:
+        block_in = acc.complexdouble_Array(stop-start)
+        block_out = acc.complexdouble_Array(stop-start)
+        for i in xrange(start, stop):
+            block_in[i-start] = wave[i]
+        acc.Filter_Step_Block(fils[1], block_in, block_out, stop-start, filnow_block)
+        for i in xrange(start, stop):
+            st_block[i] = block_out[i-start]
+
+    # Maximum error between per-sample and block stepping
+    error = np.max(np.abs(st-st_block))
+    print '  Filter_Step vs. Filter_Step_Block max error is {:.2e}'.format(error)
+
+    # Both implementations perform the same operations
+    return error < 1e-12
+
+def unit_filter_bank(dt=1e-6):
+    """
+    Unit test for Filter_Bank (filter.c/h)
+    Step a bank of single-pole filters in lockstep and compare against
+    stepping each one of them individually with Filter_Step. Return PASS/FAIL boolean.
+    """
+
+    nt = 2000
+    # Filter bandwidths [Hz] (SSA, noise-shaping and cavity-like poles)
+    bws = [16.0, 20.0, 1e3, 5e5, 1e6]
+    K = len(bws)
+
+    bank = acc.Filter_Bank()
+    acc.Filter_Bank_Allocate_In(bank, K)
+
+    fils = []
+    fil_states = []
+    for bw in bws:
+        fil = acc.Filter()
+        acc.Filter_Allocate_In(fil, 1, 1)
+        pole = acc.complexdouble_Array(1)
+        pole[0] = -2.0*np.pi*bw
+        acc.Filter_Append_Modes(fil, pole, 1, dt)
+        acc.Filter_Bank_Append_Filter(bank, fil)
+        fil_state = acc.Filter_State()
+        acc.Filter_State_Allocate(fil_state, fil)
+        fils.append(fil)
+        fil_states.append(fil_state)
+
+    bank_state = acc.Filter_Bank_State()
+    acc.Filter_Bank_State_Allocate(bank_state, bank)
+
+    # Inputs and outputs are split into real and imaginary arrays
+    in_re = acc.double_Array(K)
+    in_im = acc.double_Array(K)
+    out_re = acc.double_Array(K)
+    out_im = acc.double_Array(K)
+
+    error = 0.0
+    for i in xrange(nt):
+        for k in xrange(K):
+            x = np.exp(1j*k*i*dt*1e4)
+            in_re[k] = x.real
+            in_im[k] = x.imag
+        acc.Filter_Bank_Step(bank, in_re, in_im, out_re, out_im, bank_state)
+        for k in xrange(K):
+            out = acc.Filter_Step(fils[k], in_re[k] + 1j*in_im[k], fil_states[k])
+            error = max(error, np.abs(out-(out_re[k] + 1j*out_im[k])))
+
+    print '  Filter_Bank vs. Filter_Step max error is {:.2e}'.format(error)
+
+    return error < 1e-12
+
+def unit_filter_zoh(dt=0.5e-6):
+    """
+    Unit test for the exact (zero-order-hold) Filter discretization (filter.c/h)
+    Compare the step response of a single-pole filter discretized with
+    Filter_Set_Discretization(FILTER_ZOH) with the analytical solution at a time step
+    close to the pole's time constant, and report the Tustin pole-mapping error. Return PASS/FAIL boolean.
+    """
+
+    nt = 100
+    bw = 3e5    # Filter bandwidth [Hz]
+    pole = acc.complexdouble_Array(1)
+    pole[0] = -2.0*np.pi*bw
+
+    fil = acc.Filter()
+    acc.Filter_Allocate_In(fil, 1, 1)
+    acc.Filter_Set_Discretization(fil, acc.FILTER_ZOH, dt)
+    acc.Filter_Append_Modes(fil, pole, 1, dt)
+    fil_state = acc.Filter_State()
+    acc.Filter_State_Allocate(fil_state, fil)
+
+    # Step response: sample i corresponds to t = i*dt
+    error = 0.0
+    for i in xrange(1, nt):
+        out = acc.Filter_Step(fil, 1.0, fil_state)
+        error = max(error, np.abs(out - (1.0-np.exp(-2.0*np.pi*bw*i*dt))))
+
+    mag_error = acc.double_Array(1)
+    phase_error = acc.double_Array(1)
+    acc.Filter_Discretization_Error(fil, dt, mag_error, phase_error)
+
+    print '  ZOH step response max error is {:.2e}'.format(error)
+    print '  Tustin pole error at dt = {:.1e} s: magnitude {:.2e}, phase {:.2e} rad/step'.format(dt, mag_error[0], phase_error[0])
+
+    return error < 1e-12
+
+def unit_filter_fast_forward(dt=1e-6):
+    """
+    Unit test for Filter_Fast_Forward (filter.c/h)
+    Advance single-pole filters (both discretization methods) over a rotating input phasor
+    in closed form and compare against stepping them with Filter_Step. Return PASS/FAIL boolean.
+    """
+
+    nt = 5000
+    rot = np.exp(-1j*2.0*np.pi*3e3*dt)
+
+    error = 0.0
+    for method in [acc.FILTER_TUSTIN, acc.FILTER_ZOH]:
+        fils = []
+        fil_states = []
+        for k in xrange(2):
+            fil = acc.Filter()
+            acc.Filter_Allocate_In(fil, 1, 1)
+            pole = acc.complexdouble_Array(1)
+            pole[0] = -2.0*np.pi*1e3 + 1j*2.0*np.pi*200.0
+            acc.Filter_Append_Modes(fil, pole, 1, dt)
+            acc.Filter_Set_Discretization(fil, method, dt)
+            fil_state = acc.Filter_State()
+            acc.Filter_State_Allocate(fil_state, fil)
+            # Same non-zero initial condition (previous input differs from the phasor)
+            acc.Filter_Step(fil, 0.3-0.2j, fil_state)
+            fils.append(fil)
+            fil_states.append(fil_state)
+
+        for i in xrange(nt):
+            out = acc.Filter_Step(fils[0], 2.0*rot**i, fil_states[0])
+
+        out_ff = acc.compp()
+        ret = acc.Filter_Fast_Forward(fils[1], fil_states[1], 2.0, rot, nt, out_ff)
+        error = max(error, np.abs(out-out_ff.value()) + abs(ret))
+
+    print '  Filter_Fast_Forward vs. Filter_Step max error is {:.2e}'.format(error)
+
+    return error < 1e-12
+
 def cavity_curve_fit(Tstep, drive_in, cav_v, beam_current):
     """
     Fit cavity field signal to 1st-order exponential response.
@@ -251,6 +434,203 @@ def run_cavity_detune_test(Tmax, test_file, delta_omega_step=0.0):
     return trang, cav_v, drive_in, beam_current, mode_dict, w_offset
 
 
+def unit_cavity_fast_forward(Tmax=0.05):
+    """
+    Unit test for the quiescent fast-forward of Cavity_Step_Block (Cavity_Set_Fast_Forward):
+    run the same piecewise-constant drive and beam current (step, level change, beam turned on)
+    through Cavity_Step_Block with and without fast-forward. Return PASS/FAIL boolean.
+    """
+
+    from get_configuration import Get_SWIG_Cavity
+
+    test_file = "source/configfiles/unit_tests/cavity_test_step1.json"
+
+    records = []
+    for min_steps in [0, 16]:
+        cav, Tstep, modes_config = Get_SWIG_Cavity(test_file, Verbose=False)
+        acc.Cavity_Set_Fast_Forward(cav.C_Pointer, min_steps)
+
+        nt = int(Tmax/Tstep)
+        drive_in = np.zeros(nt, dtype=np.complex)
+        drive_in[nt//10:] = 1.0
+        drive_in[nt//2:] = 0.5+0.5j
+        beam_current = np.zeros(nt, dtype=np.complex)
+        beam_current[int(nt*0.7):] = 1e-12/Tstep
+        delta_tz = np.zeros(nt, dtype=np.double)
+        no_detuning = np.zeros(0, dtype=np.double)
+
+        cav_v = np.zeros(nt, dtype=np.complex)
+        E_probe = np.zeros(nt, dtype=np.complex)
+        E_reverse = np.zeros(nt, dtype=np.complex)
+        acc.Cavity_Step_Block(cav.C_Pointer, delta_tz, drive_in, beam_current,
+            cav_v, E_probe, E_reverse, no_detuning, cav.State)
+        records.append([cav_v, E_probe, E_reverse])
+
+    error = max([np.abs(ff-ref).max()/np.abs(ref).max() for ref, ff in zip(records[0], records[1])])
+    print '  Cavity fast-forward vs. stepping max relative error is {:.2e}'.format(error)
+
+    return error < 1e-10
+
+def unit_cavity_step_block(nt=5000, seed=3):
+    """
+    Unit test for Cavity_Step_Block: run the same time-varying drive, beam current and timing jitter
+    through Cavity_Step (one call per step) and Cavity_Step_Block, on two instances of the 3-mode
+    LCLS-II cavity with a detuned fundamental mode.
+    Empty arrays stand for zero inputs (timing jitter and beam current) and unrecorded outputs.
+    PASS if the recorded waveforms are identical and the block call returns the number of steps,
+    or -1 (without stepping) when the waveform lengths do not match.
+    """
+
+    from get_configuration import Get_SWIG_Cavity
+
+    def new_cavity():
+        cav, Tstep, modes_config = Get_SWIG_Cavity("{}", Verbose=False)
+        fund_state = acc.ElecMode_State_Get(cav.State, cav.C_Pointer.fund_index)
+        fund_state.delta_omega = 2*np.pi*20.0
+        return cav, fund_state, Tstep
+
+    def outputs():
+        return [np.zeros(nt, dtype=t) for t in [np.complex, np.complex, np.complex, np.double]]
+
+    def step_loop(delta_tz, beam_current):
+        cav, fund_state, Tstep = new_cavity()
+        V, E_probe, E_reverse, delta_omega = outputs()
+        for i in xrange(nt):
+            V[i] = acc.Cavity_Step(cav.C_Pointer, delta_tz[i], drive_in[i], beam_current[i], cav.State)
+            E_probe[i] = cav.State.E_probe
+            E_reverse[i] = cav.State.E_reverse
+            delta_omega[i] = fund_state.delta_omega
+        return V, E_probe, E_reverse, delta_omega
+
+    cav, fund_state, Tstep = new_cavity()
+    rng = np.random.RandomState(seed)
+    delta_tz = 1e-13*rng.randn(nt)
+    drive_in = np.exp(1j*1e-3*np.arange(nt))
+    drive_in[:nt//20] = 0.0
+    beam_current = np.where(np.arange(nt) % 1000 < 300, 1e-12/Tstep, 0.0).astype(np.complex)
+    no_input = np.zeros(0, dtype=np.complex)
+    no_output = np.zeros(0, dtype=np.complex)
+    no_delta_tz = np.zeros(0, dtype=np.double)
+    no_detuning = np.zeros(0, dtype=np.double)
+
+    # All inputs and outputs
+    V, E_probe, E_reverse, delta_omega = step_loop(delta_tz, beam_current)
+    V_b, E_probe_b, E_reverse_b, delta_omega_b = outputs()
+    n = acc.Cavity_Step_Block(cav.C_Pointer, delta_tz, drive_in, beam_current,
+        V_b, E_probe_b, E_reverse_b, delta_omega_b, cav.State)
+    full_pass = (n == nt) & np.array_equal(V, V_b) & np.array_equal(E_probe, E_probe_b) & \
+        np.array_equal(E_reverse, E_reverse_b) & np.array_equal(delta_omega, delta_omega_b)
+
+    # Zero timing jitter and beam current, voltage and detuning not recorded
+    zeros = np.zeros(nt)
+    V, E_probe, E_reverse, delta_omega = step_loop(zeros, zeros.astype(np.complex))
+    cav, fund_state, Tstep = new_cavity()
+    V_b, E_probe_b, E_reverse_b, delta_omega_b = outputs()
+    n = acc.Cavity_Step_Block(cav.C_Pointer, no_delta_tz, drive_in, no_input,
+        no_output, E_probe_b, E_reverse_b, no_detuning, cav.State)
+    empty_pass = (n == nt) & np.array_equal(E_probe, E_probe_b) & np.array_equal(E_reverse, E_reverse_b)
+
+    # Mismatched lengths
+    E_probe_last = cav.State.E_probe
+    n = acc.Cavity_Step_Block(cav.C_Pointer, delta_tz, drive_in[:-1], beam_current,
+        no_output, E_probe_b, no_output, no_detuning, cav.State)
+    length_pass = (n == -1) & (cav.State.E_probe == E_probe_last)
+
+    print '  Cavity_Step vs. Cavity_Step_Block: all signals {0}, empty arrays {1}, mismatched lengths {2}'.format(
+        'identical' if full_pass else 'differ', 'identical' if empty_pass else 'differ', 'rejected' if length_pass else 'accepted')
+
+    return full_pass & empty_pass & length_pass
+
+def unit_cavity_packed(nt=20000, seed=2):
+    """
+    Unit test for the packed Cavity kernel (Cavity_Pack, Cavity_Step):
+    step the 3-mode LCLS-II cavity with time-varying drive, beam current, detuning and timing jitter,
+    and step the same Electrical modes one by one with ElecMode_Step on separate mode States.
+    Half-way through, one mode's Filter is re-discretized (Filter_Set_Discretization),
+    which the packed coefficients must follow.
+    PASS if both paths produce bit-identical voltages, probe and reverse signals.
+    """
+
+    from get_configuration import Get_SWIG_Cavity
+
+    cav, Tstep, modes_config = Get_SWIG_Cavity("{}", Verbose=False)
+    modes = [mode.C_Pointer for mode in cav.elec_modes]
+    packed_states = [acc.ElecMode_State_Get(cav.State, idx) for idx in xrange(len(modes))]
+    mode_states = []
+    for mode in modes:
+        mode_state = acc.ElecMode_State()
+        acc.ElecMode_State_Allocate(mode_state, mode)
+        mode_states.append(mode_state)
+
+    rng = np.random.RandomState(seed)
+    delta_tz = 1e-13*rng.randn(nt)
+    drive_in = np.exp(1j*1e-3*np.arange(nt))
+    drive_in[:nt//20] = 0.0
+    beam_current = np.where(np.arange(nt) % 1000 < 300, 1e-12/Tstep, 0.0)
+    delta_omega = 2*np.pi*30.0*np.sin(2*np.pi*150.0*Tstep*np.arange(nt))
+
+    v_probe = acc.compp()
+    v_em = acc.compp()
+    packed_pass = cav.C_Pointer.packed == 1
+    error = 0.0
+    for i in xrange(nt):
+        if i == nt//2:
+            acc.Filter_Set_Discretization(modes[1].fil, acc.FILTER_ZOH, Tstep)
+        for idx in xrange(len(modes)):
+            packed_states[idx].delta_omega = (idx+1)*delta_omega[i]
+            mode_states[idx].delta_omega = (idx+1)*delta_omega[i]
+
+        V = acc.Cavity_Step(cav.C_Pointer, delta_tz[i], drive_in[i], beam_current[i], cav.State)
+
+        V_ref, E_probe_ref, E_reverse_ref = 0.0, 0.0, -drive_in[i]
+        for mode, mode_state in zip(modes, mode_states):
+            V_ref += acc.ElecMode_Step(mode, drive_in[i], beam_current[i], delta_tz[i], mode_state, v_probe, v_em)
+            E_probe_ref += v_probe.value()
+            E_reverse_ref += v_em.value()
+
+        error = max(error, np.abs(V-V_ref), np.abs(cav.State.E_probe-E_probe_ref), np.abs(cav.State.E_reverse-E_reverse_ref))
+
+    for mode_state in mode_states:
+        acc.ElecMode_State_Deallocate(mode_state)
+
+    print '  Packed Cavity_Step vs. ElecMode_Step max difference is {:.2e}'.format(error)
+
+    return packed_pass & (error == 0.0)
+
+def unit_cavity_rotator(nt=100000, seed=1):
+    """
+    Unit test for the incremental phase rotator of the Electrical modes (ElecMode_Update_Phasors):
+    step a Cavity with a detuning (Lorentz-force like oscillation plus random walk) and timing jitter
+    changing every step, and compare the modes' phasors with their direct evaluation
+    (exp(-j*d_phase) and exp(-j*LO_w0*delta_tz)) after every step.
+    PASS if the drift stays below the documented 1e-12 over nt steps.
+    """
+
+    from get_configuration import Get_SWIG_Cavity
+
+    test_file = "source/configfiles/unit_tests/cavity_test_step1.json"
+    cav, Tstep, modes_config = Get_SWIG_Cavity(test_file, Verbose=False)
+    n_modes = cav.C_Pointer.n_modes
+    modes = [acc.ElecMode_State_Get(cav.State, idx) for idx in xrange(n_modes)]
+    LO_w0 = [mode.C_Pointer.LO_w0 for mode in cav.elec_modes]
+
+    rng = np.random.RandomState(seed)
+    delta_tz = 1e-13*rng.randn(nt)
+    delta_omega = 2*np.pi*(30.0*np.sin(2*np.pi*150.0*Tstep*np.arange(nt)) + np.cumsum(rng.randn(nt)))
+
+    error = 0.0
+    for i in xrange(nt):
+        for state in modes:
+            state.delta_omega = delta_omega[i]
+        acc.Cavity_Step(cav.C_Pointer, delta_tz[i], 1.0, 0.0, cav.State)
+        for state, w0 in zip(modes, LO_w0):
+            error = max(error, np.abs(state.rotator - np.exp(-1j*state.d_phase)),
+                np.abs(state.beam_phasor - np.exp(-1j*w0*delta_tz[i])))
+
+    print '  Phase rotator vs. direct evaluation max error is {:.2e}'.format(error)
+
+    return error < 1e-12
+
 def show_cavity_step(title):
     plt.title(title, fontsize=40, y=1.02)
     plt.xlabel('Time [s]', fontsize=30)
@@ -604,8 +984,12 @@ def unit_cavity():
     test_step_pass = cavity_test_step()
     test_freqs_pass = cavity_test_freqs()
     test_detune_pass = cavity_test_detune()
+    test_block_pass = unit_cavity_step_block()
+    test_fast_forward_pass = unit_cavity_fast_forward()
+    test_packed_pass = unit_cavity_packed()
+    test_rotator_pass = unit_cavity_rotator()
 
-    return test_step_pass & test_freqs_pass & test_detune_pass
+    return test_step_pass & test_freqs_pass & test_detune_pass & test_block_pass & test_fast_forward_pass & test_packed_pass & test_rotator_pass
 
 def perform_tests():
     """
@@ -613,6 +997,10 @@ def perform_tests():
     """
     print "\n****\nTesting Filter..."
     filter_pass = unit_filter()
+    filter_pass = filter_pass & unit_filter_block()
+    filter_pass = filter_pass & unit_filter_bank()
+    filter_pass = filter_pass & unit_filter_zoh()
+    filter_pass = filter_pass & unit_filter_fast_forward()
     if (filter_pass):
         result = 'PASS'
     else:
@@ -142,6 +142,241 @@ void MechMode_Step(MechMode *mechMode,	///< Pointer to MechMode struct
  	mechMode_State->x_nu = Filter_Step(&(mechMode->fil), mechMode->c_nu*F_nu, &(mechMode_State->fil_state));
 }
 
+/** Takes a pointer to a MechMode_Bank struct and fills it in with the Mechanical modes in mechMode_net,
+  * previously allocated and filled, stepped every decimation time steps (at decimation*Tstep).
+  * The two conjugate poles of each mode are discretized at that step (with the method of its Filter,
+  * which is left unchanged) and their cascade is expanded into partial fractions:
+  * H(z) = D + R/(1-a/z) + conj(R)/(1-conj(a)/z). */
+void MechMode_Bank_Allocate_Decimated(MechMode_Bank *bank,	///< Pointer to MechMode_Bank struct
+	MechMode_dp mechMode_net,																	///< Array of Mechanical modes
+	int n,																										///< Number of Mechanical modes
+	int decimation																						///< Time steps per bank step (>= 1)
+	)
+{
+	int nu;
+
+	bank->n = n;
+	// Single block for all coefficient arrays
+	bank->a_re = calloc(6*(n > 0 ? n : 1), sizeof(double));
+	bank->a_im = bank->a_re + n;
+	bank->r_re = bank->a_im + n;
+	bank->r_im = bank->r_re + n;
+	bank->d = bank->r_im + n;
+	bank->c = bank->d + n;
+
+	for(nu=0;nu<n;nu++) {
+		Filter *fil = &mechMode_net[nu]->fil;
+		double complex a, b;
+		double scale = creal(fil->coeffs[2]);
+		Filter_Discretize(fil->poles[0], decimation*mechMode_net[nu]->Tstep, fil->method, &a, &b);
+		// Gain of the two cascaded sections
+		double k = scale*scale*creal(b*conj(b));
+		double complex r;
+
+		if(fil->method == FILTER_ZOH) {
+			// H(z) = k/((1-a/z)(1-conj(a)/z))
+			bank->d[nu] = 0.0;
+			r = k/(1.0-conj(a)/a);
+		} else {
+			// Tustin: H(z) = k/4*(1+1/z)^2/((1-a/z)(1-conj(a)/z))
+			bank->d[nu] = 0.25*k/creal(a*conj(a));
+			r = 0.25*k*(1.0+1.0/a)*(1.0+1.0/a)/(1.0-conj(a)/a);
+		}
+
+		bank->a_re[nu] = creal(a);
+		bank->a_im[nu] = cimag(a);
+		bank->r_re[nu] = creal(r);
+		bank->r_im[nu] = cimag(r);
+		bank->c[nu] = mechMode_net[nu]->c_nu;
+	}
+}
+
+/** Takes a pointer to a MechMode_Bank struct and fills it in with the Mechanical modes in mechMode_net,
+  * stepped at their time step (see MechMode_Bank_Allocate_Decimated). */
+void MechMode_Bank_Allocate_In(MechMode_Bank *bank,	///< Pointer to MechMode_Bank struct
+	MechMode_dp mechMode_net,														///< Array of Mechanical modes
+	int n																								///< Number of Mechanical modes
+	)
+{
+	MechMode_Bank_Allocate_Decimated(bank, mechMode_net, n, 1);
+}
+
+/** Frees memory of a MechMode_Bank struct. */
+void MechMode_Bank_Deallocate(MechMode_Bank *bank)
+{
+	free(bank->a_re);
+	bank->a_re = bank->a_im = bank->r_re = bank->r_im = bank->d = bank->c = NULL;
+	bank->n = 0;
+}
+
+/** Takes a previously configured MechMode_Bank and allocates its (zeroed) State struct accordingly. */
+void MechMode_Bank_State_Allocate(MechMode_Bank_State *bank_state, MechMode_Bank *bank)
+{
+	bank_state->s_re = State_Calloc(2*(bank->n > 0 ? bank->n : 1), sizeof(double));
+	bank_state->s_im = bank_state->s_re + bank->n;
+}
+
+/** Frees memory of a MechMode_Bank State struct. */
+void MechMode_Bank_State_Deallocate(MechMode_Bank_State *bank_state)
+{
+	free(bank_state->s_re);
+	bank_state->s_re = bank_state->s_im = NULL;
+}
+
+/** Step all modes of a MechMode_Bank (SoA arrays of length n). */
+static void MechMode_Bank_Kernel(int n,
+	const double * restrict a_re, const double * restrict a_im,
+	const double * restrict r_re, const double * restrict r_im,
+	const double * restrict d, const double * restrict c,
+	const double * restrict F_nu, double * restrict x_nu,
+	double * restrict s_re, double * restrict s_im)
+{
+	int nu;
+
+	for(nu=0;nu<n;nu++) {
+		double u = c[nu]*F_nu[nu];
+		double sr = a_re[nu]*s_re[nu] - a_im[nu]*s_im[nu] + u;
+		double si = a_re[nu]*s_im[nu] + a_im[nu]*s_re[nu];
+		s_re[nu] = sr;
+		s_im[nu] = si;
+		x_nu[nu] = d[nu]*u + 2.0*(r_re[nu]*sr - r_im[nu]*si);
+	}
+}
+
+/** Step function for a MechMode_Bank: same as MechMode_Step applied to every mode in the bank,
+  * given the Lorentz forces F_nu. Stores the displacements in x_nu (both arrays of length n). */
+void MechMode_Bank_Step(MechMode_Bank *bank,	///< Pointer to MechMode_Bank struct
+	double *F_nu,																///< Lorentz forces in Newtons
+	double *x_nu,																///< Displacements (output)
+	MechMode_Bank_State *bank_state							///< Pointer to MechMode_Bank State
+	)
+{
+	MechMode_Bank_Kernel(bank->n, bank->a_re, bank->a_im, bank->r_re, bank->r_im, bank->d, bank->c,
+		F_nu, x_nu, bank_state->s_re, bank_state->s_im);
+}
+
+/** Takes a pointer to a Coupling_Matrix struct and allocates a (zeroed) dense matrix of the given size.
+  * Coefficients are filled in the dense array and Coupling_Matrix_Compress is called once done. */
+void Coupling_Matrix_Allocate_In(Coupling_Matrix *mat,	///< Pointer to Coupling_Matrix struct
+	int n_rows,																						///< Number of rows
+	int n_cols																						///< Number of columns
+	)
+{
+	mat->n_rows = n_rows;
+	mat->n_cols = n_cols;
+	mat->dense = calloc(n_rows*n_cols > 0 ? n_rows*n_cols : 1, sizeof(double));
+	mat->sparse = 0;
+	mat->nnz = 0;
+	mat->row_start = NULL;
+	mat->col = NULL;
+	mat->val = NULL;
+}
+
+/** Frees memory of a Coupling_Matrix struct. */
+void Coupling_Matrix_Deallocate(Coupling_Matrix *mat)
+{
+	free(mat->dense);
+	free(mat->row_start);
+	free(mat->col);
+	free(mat->val);
+	mat->dense = NULL;
+	mat->row_start = NULL;
+	mat->col = NULL;
+	mat->val = NULL;
+	mat->n_rows = 0;
+	mat->n_cols = 0;
+	mat->nnz = 0;
+	mat->sparse = 0;
+}
+
+/** Counts the non-zero coefficients of a filled-in Coupling_Matrix and, if their fraction is
+  * below COUPLING_CSR_DENSITY, builds its CSR form and selects it for Coupling_Matrix_Apply. */
+void Coupling_Matrix_Compress(Coupling_Matrix *mat)
+{
+	int r, c, k = 0;
+
+	free(mat->row_start);
+	free(mat->col);
+	free(mat->val);
+	mat->row_start = NULL;
+	mat->col = NULL;
+	mat->val = NULL;
+
+	mat->nnz = 0;
+	for(r=0;r<mat->n_rows*mat->n_cols;r++) if(mat->dense[r] != 0.0) mat->nnz++;
+
+	mat->sparse = (mat->nnz <= COUPLING_CSR_DENSITY*mat->n_rows*mat->n_cols);
+	if(!mat->sparse) return;
+
+	mat->row_start = calloc(mat->n_rows+1, sizeof(int));
+	mat->col = calloc(mat->nnz > 0 ? mat->nnz : 1, sizeof(int));
+	mat->val = calloc(mat->nnz > 0 ? mat->nnz : 1, sizeof(double));
+
+	for(r=0;r<mat->n_rows;r++) {
+		mat->row_start[r] = k;
+		for(c=0;c<mat->n_cols;c++) {
+			if(mat->dense[r*mat->n_cols+c] != 0.0) {
+				mat->col[k] = c;
+				mat->val[k] = mat->dense[r*mat->n_cols+c];
+				k++;
+			}
+		}
+	}
+	mat->row_start[mat->n_rows] = k;
+}
+
+/** Dense matrix-vector product y = M*x, M row-major (n_rows x n_cols).
+  * Rows are processed in blocks of four so that each element of x is loaded once per block. */
+static void Coupling_GEMV_Kernel(int n_rows, int n_cols,
+	const double * restrict M, const double * restrict x, double * restrict y)
+{
+	int r, c;
+
+	for(r=0;r+4<=n_rows;r+=4) {
+		const double *m0 = M + r*n_cols, *m1 = m0 + n_cols, *m2 = m1 + n_cols, *m3 = m2 + n_cols;
+		double y0 = 0.0, y1 = 0.0, y2 = 0.0, y3 = 0.0;
+		for(c=0;c<n_cols;c++) {
+			y0 += m0[c]*x[c];
+			y1 += m1[c]*x[c];
+			y2 += m2[c]*x[c];
+			y3 += m3[c]*x[c];
+		}
+		y[r] = y0; y[r+1] = y1; y[r+2] = y2; y[r+3] = y3;
+	}
+	// Remaining rows
+	for(;r<n_rows;r++) {
+		const double *m = M + r*n_cols;
+		double y0 = 0.0;
+		for(c=0;c<n_cols;c++) y0 += m[c]*x[c];
+		y[r] = y0;
+	}
+}
+
+/** Sparse (CSR) matrix-vector product y = M*x. */
+static void Coupling_CSR_Kernel(int n_rows,
+	const int * restrict row_start, const int * restrict col, const double * restrict val,
+	const double * restrict x, double * restrict y)
+{
+	int r, k;
+
+	for(r=0;r<n_rows;r++) {
+		double y0 = 0.0;
+		for(k=row_start[r];k<row_start[r+1];k++) y0 += val[k]*x[col[k]];
+		y[r] = y0;
+	}
+}
+
+/** Apply Coupling_Matrix to vector x (of length n_cols) and store the result in y (of length n_rows).
+  * Terms are summed in column order in both forms (dense and CSR). */
+void Coupling_Matrix_Apply(Coupling_Matrix *mat,	///< Pointer to Coupling_Matrix struct
+	double *x,																			///< Input vector
+	double *y																				///< Output vector
+	)
+{
+	if(mat->sparse) Coupling_CSR_Kernel(mat->n_rows, mat->row_start, mat->col, mat->val, x, y);
+	else Coupling_GEMV_Kernel(mat->n_rows, mat->n_cols, mat->dense, x, y);
+}
+
 /** Allocates memory for an array of Cryomodules.
   * Cryomodules themselves need to be allocated and filled individually,
   * and appended to this array using Cryomodule_Append.*/
@@ -171,6 +406,55 @@ void Cryomodule_Allocate_In(Cryomodule *cryo,		///< Pointer to Cryomodule struct
 	cryo -> mechMode_net = mechMode_net;
 	cryo -> n_rf_stations = n_rf_stations;
 	cryo -> n_mechModes = n_mechModes;
+
+	// Gather electro-mechanical couplings into contiguous matrices,
+	// with Electrical modes numbered consecutively over RF Stations
+	int i, mu, nu, k = 0;
+	cryo -> n_elecModes = 0;
+	for(i=0;i<n_rf_stations;i++) cryo -> n_elecModes += rf_station_net[i]->cav->n_modes;
+
+	Coupling_Matrix_Allocate_In(&cryo->A, n_mechModes, cryo->n_elecModes);
+	Coupling_Matrix_Allocate_In(&cryo->C, cryo->n_elecModes, n_mechModes);
+
+	for(i=0;i<n_rf_stations;i++) {
+		for(mu=0;mu<rf_station_net[i]->cav->n_modes;mu++) {
+			ElecMode *elecMode = rf_station_net[i]->cav->elecMode_net[mu];
+			for(nu=0;nu<n_mechModes;nu++) {
+				cryo->A.dense[nu*cryo->n_elecModes + k] = elecMode->A[nu];
+				cryo->C.dense[k*n_mechModes + nu] = elecMode->C[nu];
+			}
+			k++;
+		}
+	}
+
+	Coupling_Matrix_Compress(&cryo->A);
+	Coupling_Matrix_Compress(&cryo->C);
+
+	// Pack Mechanical modes
+	MechMode_Bank_Allocate_In(&cryo->mechMode_bank, mechMode_net, n_mechModes);
+
+	// Mechanical modes stepped at the RF rate by default
+	cryo -> mech_decimation = 1;
+	cryo -> mech_interpolate = 0;
+}
+
+/** Step the Mechanical modes of a Cryomodule once every mech_decimation RF steps.
+  * The Mechanical mode bank is re-built with the poles discretized at the Mechanical time step
+  * (mech_decimation*Tstep, the Mechanical modes' Filters are left unchanged), and driven by the average of V_2 over the Mechanical step (anti-aliasing).
+  * Detune frequencies are held between Mechanical steps, or linearly interpolated
+  * from the previous to the latest value if mech_interpolate is set. */
+void Cryomodule_Set_Mech_Decimation(Cryomodule *cryo,	///< Pointer to Cryomodule struct
+	int mech_decimation,																///< Number of RF steps per Mechanical step (>= 1)
+	int mech_interpolate																///< Interpolate (1) or hold (0) detune frequencies
+	)
+{
+	if(mech_decimation < 1) mech_decimation = 1;
+	cryo -> mech_decimation = mech_decimation;
+	cryo -> mech_interpolate = mech_interpolate;
+
+	// Re-pack Mechanical modes at the Mechanical time step
+	MechMode_Bank_Deallocate(&cryo->mechMode_bank);
+	MechMode_Bank_Allocate_Decimated(&cryo->mechMode_bank, cryo->mechMode_net, cryo->n_mechModes, mech_decimation);
 }
 
 /** Allocates memory for a Cryomodule struct and fills it in with the values passed as arguments.
@@ -200,8 +484,13 @@ void Cryomodule_Deallocate(Cryomodule* cryo)
 	free(cryo->rf_station_net);
 	free(cryo->mechMode_net);
 
+	Coupling_Matrix_Deallocate(&cryo->A);
+	Coupling_Matrix_Deallocate(&cryo->C);
+	MechMode_Bank_Deallocate(&cryo->mechMode_bank);
+
 	cryo->n_rf_stations = 0.0;
 	cryo->n_mechModes = 0.0;
+	cryo->n_elecModes = 0;
 }
 
 /** Helper routine to get a reference to a given RF Station given the Cryomodule struct. */
@@ -217,25 +506,35 @@ void Cryomodule_State_Allocate(Cryomodule_State *cryo_state, Cryomodule *cryo)
 {
 
 	// Allocate memory for the array of states (RF Stations and MechModes)
-	cryo_state->rf_state_net = calloc(cryo->n_rf_stations, sizeof(RF_State *));
-	cryo_state->mechMode_state_net = calloc(cryo->n_mechModes, sizeof(MechMode_State *));
+	cryo_state->rf_state_net = State_Calloc(cryo->n_rf_stations, sizeof(RF_State *));
+	cryo_state->mechMode_state_net = State_Calloc(cryo->n_mechModes, sizeof(MechMode_State *));
 
 	// Then allocate memory for the States themselves
 	// Allocate RF Station States
 	int i;
  	for(i=0;i<cryo->n_rf_stations;i++) {
- 		cryo_state->rf_state_net[i] = (RF_State*)calloc(1,sizeof(RF_State));
+ 		cryo_state->rf_state_net[i] = (RF_State*)State_Calloc(1,sizeof(RF_State));
  		RF_State_Allocate(cryo_state->rf_state_net[i], cryo->rf_station_net[i]);
  	}
 
-	// Allocate Mechanical Mode States
+	// Allocate Mechanical Mode States: the modes are stepped as a bank (mechMode_bank_state),
+	// so their States only hold the displacements (no Filter State, see MechMode_State)
  	for(i=0;i<cryo->n_mechModes;i++) {
- 		cryo_state->mechMode_state_net[i] = (MechMode_State*)calloc(1,sizeof(MechMode_State));
- 		MechMode_State_Allocate(cryo_state->mechMode_state_net[i], cryo->mechMode_net[i]);
+ 		cryo_state->mechMode_state_net[i] = (MechMode_State*)State_Calloc(1,sizeof(MechMode_State));
  	}
 
+ 	MechMode_Bank_State_Allocate(&cryo_state->mechMode_bank_state, &cryo->mechMode_bank);
+
  	// Allocate vectors to store Lorentz forces
- 	cryo_state->F_nu = calloc(cryo->n_mechModes,sizeof(double));
+ 	cryo_state->F_nu = State_Calloc(cryo->n_mechModes,sizeof(double));
+
+ 	// Allocate packed vectors for the electro-mechanical coupling matrices
+ 	cryo_state->V_2 = State_Calloc(cryo->n_elecModes,sizeof(double));
+ 	cryo_state->x_nu = State_Calloc(cryo->n_mechModes,sizeof(double));
+ 	cryo_state->delta_omega = State_Calloc(cryo->n_elecModes,sizeof(double));
+ 	cryo_state->V_2_sum = State_Calloc(cryo->n_elecModes,sizeof(double));
+ 	cryo_state->delta_omega_prev = State_Calloc(cryo->n_elecModes,sizeof(double));
+ 	cryo_state->mech_count = 0;
 
 }
 
@@ -251,7 +550,13 @@ void Cryomodule_State_Deallocate(Cryomodule_State *cryo_state, Cryomodule *cryo)
 
 	free(cryo_state->rf_state_net);
 	free(cryo_state->mechMode_state_net);
+	MechMode_Bank_State_Deallocate(&cryo_state->mechMode_bank_state);
 	free(cryo_state->F_nu);
+	free(cryo_state->V_2);
+	free(cryo_state->x_nu);
+	free(cryo_state->delta_omega);
+	free(cryo_state->V_2_sum);
+	free(cryo_state->delta_omega_prev);
 }
 
 /** Step function for Cryomodule:
@@ -285,57 +590,58 @@ double complex Cryomodule_Step(
 
 	// Indexes (as used in equations in the documentation)
 		// nu: Mechanical Eigenmodes index,
-		// mu: Electrical Eigenmode index,
-	int nu, mu;
-	int n_Emodes;
-	// Temporary variables for summation components
-	double V_2_mu=0.0, A_nu_mu=0.0, x_nu=0.0, C_mu_nu=0.0, delta_omega_now=0.0, F_nu_now=0.0;
-
-	// Calculate Electrical to Mechanical couplings
-	// and calculate displacements for each Mechanical Eigenmode
-	// Iterate over nu
-	for(nu=0;nu<cryo->n_mechModes;nu++) {
-		// Iterate over RF Stations in a Cryomodule
-		for(i=0;i<cryo->n_rf_stations;i++) {
-			// Iterate over Electrical Eigenmodes (mu index) in a RF Station's Cavity
-			n_Emodes = cryo->rf_station_net[i]->cav->n_modes;
-			for(mu=0;mu<n_Emodes;mu++) {
-				// Grab square of accelerating voltage of Electrical Mode (mu)
-				V_2_mu = cryo_state->rf_state_net[i]->cav_state.elecMode_state_net[mu]->V_2;
-				// Grab its coupling to Mechanical Mode (nu,mu)
-				A_nu_mu = cryo->rf_station_net[i]->cav->elecMode_net[mu]->A[nu];
-				// Calculate contribution of Electrical Eigenmode to Lorentz force
-				F_nu_now += A_nu_mu*V_2_mu;
-			} // End iterate over mu
-		} // End iterate over i
-		cryo_state->F_nu[nu] = F_nu_now;
-
-		// Once F_nu is known for a Mechanical Eigenmode,
-		// apply state-space simulation step to Mechanical Mode (2nd-order LPF)
-		MechMode_Step(cryo->mechMode_net[nu], cryo_state->mechMode_state_net[nu], cryo_state->F_nu[nu]);
-
-	} // End iterate over nu
-
-	// Displacements are now available for each Mechanical Mode
-	// Apply matrix to translate into Lorentz-force detuning
+		// mu: Electrical Eigenmode index (numbered consecutively over RF Stations, k)
+	int nu, mu, k;
 
-	// Iterate over RF Stations in a Cryomodule
+	int n_decim = cryo->mech_decimation;
+	int update, interpolate;
+
+	// Accumulate squares of accelerating voltages of Electrical Modes over the Mechanical step
+	k = 0;
 	for(i=0;i<cryo->n_rf_stations;i++) {
-		// Iterate over Electrical Eigenmodes (mu index) in a RF Station's Cavity
-		n_Emodes = cryo->rf_station_net[i]->cav->n_modes;
-		for(mu=0;mu<n_Emodes;mu++) {
-			// Iterate over nu
-			for(nu=0;nu<cryo->n_mechModes;nu++) {
-				// Grab displacement for Mechanical Eigenmode (nu)
-				x_nu = cryo_state->mechMode_state_net[nu]->x_nu;
-				// Grab Mechanical to Electrical coupling coefficient (mu,nu)
-				C_mu_nu = cryo->rf_station_net[i]->cav->elecMode_net[mu]->C[nu];
-				// Calculate contribution of mechanical displacement to Lorentz-force detune frequency
-				delta_omega_now += C_mu_nu*x_nu;
-			} // End iterate over nu
-			cryo_state->rf_state_net[i]->cav_state.elecMode_state_net[mu]->delta_omega = delta_omega_now;
-		} // End iterate over mu
-	} // End iterate over i
+		Cavity_State *cav_state = &cryo_state->rf_state_net[i]->cav_state;
+		for(mu=0;mu<cryo->rf_station_net[i]->cav->n_modes;mu++) cryo_state->V_2_sum[k++] += cav_state->elecMode_state_net[mu]->V_2;
+	}
+
+	update = (++cryo_state->mech_count >= n_decim);
+	if(update) {
+		// Average (anti-aliasing) and restart accumulation
+		for(k=0;k<cryo->n_elecModes;k++) {
+			cryo_state->V_2[k] = cryo_state->V_2_sum[k]*(1.0/n_decim);
+			cryo_state->V_2_sum[k] = 0.0;
+			cryo_state->delta_omega_prev[k] = cryo_state->delta_omega[k];
+		}
+		cryo_state->mech_count = 0;
+
+		// Calculate Electrical to Mechanical couplings (Lorentz forces): F = A*V_2
+		Coupling_Matrix_Apply(&cryo->A, cryo_state->V_2, cryo_state->F_nu);
+
+		// Once F_nu is known for each Mechanical Eigenmode,
+		// apply state-space simulation step to Mechanical Modes (2nd-order LPF, see MechMode_Bank)
+		MechMode_Bank_Step(&cryo->mechMode_bank, cryo_state->F_nu, cryo_state->x_nu, &cryo_state->mechMode_bank_state);
+		for(nu=0;nu<cryo->n_mechModes;nu++) cryo_state->mechMode_state_net[nu]->x_nu = cryo_state->x_nu[nu];
+
+		// Displacements are now available for each Mechanical Mode
+		// Apply matrix to translate into Lorentz-force detuning: delta_omega = C*x
+		Coupling_Matrix_Apply(&cryo->C, cryo_state->x_nu, cryo_state->delta_omega);
+	}
+
+	// Scatter detune frequencies back to Electrical Modes:
+	// held (written on Mechanical steps only) or ramped from the previous to the latest value
+	// over the Mechanical step, reaching it just before the next update
+	interpolate = (cryo->mech_interpolate && n_decim > 1);
+	if(update || interpolate) {
+		double w_new = (double)(cryo_state->mech_count+1)/n_decim;
+		k = 0;
+		for(i=0;i<cryo->n_rf_stations;i++) {
+			Cavity_State *cav_state = &cryo_state->rf_state_net[i]->cav_state;
+			for(mu=0;mu<cryo->rf_station_net[i]->cav->n_modes;mu++,k++) {
+				if(interpolate) cav_state->elecMode_state_net[mu]->delta_omega = cryo_state->delta_omega_prev[k]
+					+ w_new*(cryo_state->delta_omega[k] - cryo_state->delta_omega_prev[k]);
+				else cav_state->elecMode_state_net[mu]->delta_omega = cryo_state->delta_omega[k];
+			}
+		}
+	}
 
 	// Store total Cryomodule drive signal (vector sum of all RF Station drive signals)
 	 cryo_state->cryo_Kg = cryo_Kg;
@@ -345,3 +651,81 @@ double complex Cryomodule_Step(
 	return cryo_V;
 
 }
+
+/** Set a Cryomodule State to its steady state (operating point) for constant timing jitter and beam charge:
+  * every RF Station at the steady state of its feedback loop (see RF_Station_Set_Steady_State),
+  * and the Mechanical modes at the static displacements of the Lorentz forces of the settled cavity voltages.
+  * As Lorentz-force detuning in turn shifts the cavity voltages, both are iterated to a fixed point
+  * (at most CRYOMODULE_STEADY_ITER times, to a relative tolerance of CRYOMODULE_STEADY_TOL).
+  * Returns 0 on success, or -1 if an RF Station is beyond its limits or detuning has not converged. */
+int Cryomodule_Set_Steady_State(
+	Cryomodule *cryo,								///< Pointer to Cryomodule
+	Cryomodule_State * cryo_state,	///< Pointer to Cryomodule State
+	double delta_tz,								///< Timing jitter in seconds (RF reference noise)
+	double beam_charge,							///< Beam charge in Coulombs
+	double complex *cryo_V					///< Vector sum of all cavity accelerating voltages (output)
+	)
+{
+	MechMode_Bank *bank = &cryo->mechMode_bank;
+	int i, mu, nu, k, iter, ret = -1;
+
+	for(iter=0;iter<CRYOMODULE_STEADY_ITER;iter++) {
+		int rf_ret = 0;
+
+		// RF Stations at the current detune frequencies
+		for(i=0;i<cryo->n_rf_stations;i++) {
+			rf_ret |= RF_Station_Set_Steady_State(cryo->rf_station_net[i], delta_tz, beam_charge, 0.0, cryo_state->rf_state_net[i]);
+		}
+
+		// Lorentz forces and static Mechanical mode displacements (steady state of MechMode_Bank_Step)
+		k = 0;
+		for(i=0;i<cryo->n_rf_stations;i++) {
+			Cavity_State *cav_state = &cryo_state->rf_state_net[i]->cav_state;
+			for(mu=0;mu<cryo->rf_station_net[i]->cav->n_modes;mu++) cryo_state->V_2[k++] = cav_state->elecMode_state_net[mu]->V_2;
+		}
+		Coupling_Matrix_Apply(&cryo->A, cryo_state->V_2, cryo_state->F_nu);
+		for(nu=0;nu<cryo->n_mechModes;nu++) {
+			double u = bank->c[nu]*cryo_state->F_nu[nu];
+			double complex a = bank->a_re[nu] + I*bank->a_im[nu], r = bank->r_re[nu] + I*bank->r_im[nu];
+			double complex s = u/(1.0 - a);
+			cryo_state->mechMode_bank_state.s_re[nu] = creal(s);
+			cryo_state->mechMode_bank_state.s_im[nu] = cimag(s);
+			cryo_state->x_nu[nu] = bank->d[nu]*u + 2.0*creal(r*s);
+			cryo_state->mechMode_state_net[nu]->x_nu = cryo_state->x_nu[nu];
+		}
+		Coupling_Matrix_Apply(&cryo->C, cryo_state->x_nu, cryo_state->delta_omega);
+
+		// Compare with the detune frequencies the RF Stations have settled at, and update them
+		double change = 0.0, scale = 0.0;
+		k = 0;
+		for(i=0;i<cryo->n_rf_stations;i++) {
+			Cavity_State *cav_state = &cryo_state->rf_state_net[i]->cav_state;
+			for(mu=0;mu<cryo->rf_station_net[i]->cav->n_modes;mu++,k++) {
+				ElecMode_State *elecMode_state = cav_state->elecMode_state_net[mu];
+				double delta_omega = cryo_state->delta_omega[k];
+				if(fabs(delta_omega - elecMode_state->delta_omega) > change) change = fabs(delta_omega - elecMode_state->delta_omega);
+				if(fabs(delta_omega) > scale) scale = fabs(delta_omega);
+				elecMode_state->delta_omega = delta_omega;
+				cryo_state->delta_omega_prev[k] = delta_omega;
+			}
+		}
+
+		if(change <= CRYOMODULE_STEADY_TOL*scale) {
+			ret = rf_ret;
+			break;
+		}
+	}
+
+	// Settled RF Stations (at the final detune frequencies) and Mechanical step accumulators
+	*cryo_V = 0.0;
+	cryo_state->cryo_Kg = 0.0;
+	for(i=0;i<cryo->n_rf_stations;i++) {
+		if(ret != 0) RF_Station_Set_Steady_State(cryo->rf_station_net[i], delta_tz, beam_charge, 0.0, cryo_state->rf_state_net[i]);
+		*cryo_V += cryo_state->rf_state_net[i]->cav_state.V;
+		cryo_state->cryo_Kg += cryo_state->rf_state_net[i]->cav_state.Kg;
+	}
+	for(k=0;k<cryo->n_elecModes;k++) cryo_state->V_2_sum[k] = 0.0;
+	cryo_state->mech_count = 0;
+
+	return ret;
+}
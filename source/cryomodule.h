@@ -21,19 +21,73 @@
 typedef MechMode* MechMode_p;
 typedef MechMode** MechMode_dp;
 
+/**
+ * State of a Mechanical mode. The Filter State is only allocated for modes stepped
+ * on their own (MechMode_State_Allocate, MechMode_Step): the Mechanical modes of a Cryomodule
+ * are stepped as a MechMode_Bank, whose State replaces it, and their States only hold x_nu.
+ */
 typedef struct str_MechMode_State {
-	Filter_State fil_state;
-	double x_nu;
+	Filter_State fil_state;	///< Filter State (stand-alone modes only)
+	double x_nu;						///< Displacement
 
 } MechMode_State;
 
 typedef MechMode_State* MechMode_State_p;
 typedef MechMode_State** MechMode_State_dp;
 
+/**
+ * Bank of Mechanical modes stepped in lockstep.
+ * Each mode's pair of conjugate poles (2nd-order low-pass filter with real input)
+ * is stepped in modal form with a single complex state s per mode:
+ * s = a*s + u, x = D*u + 2*Re(R*s), with u = c_nu*F_nu.
+ * Coefficients are stored in structure-of-arrays form so that MechMode_Bank_Step
+ * reduces to a single loop the compiler can vectorize.
+ */
+typedef struct str_MechMode_Bank {
+	int n;                  ///< Number of Mechanical modes in the bank
+	double *a_re, *a_im;    ///< Discrete-time pole (one per conjugate pair)
+	double *r_re, *r_im;    ///< Residue of the pole
+	double *d;              ///< Direct input to output coefficient
+	double *c;              ///< Force to input coefficient (c_nu)
+
+} MechMode_Bank;
+
+typedef struct str_MechMode_Bank_State {
+	double *s_re, *s_im;    ///< Modal states (of length n)
+
+} MechMode_Bank_State;
+
+#define CRYOMODULE_STEADY_ITER 100  ///< Maximum number of Lorentz-force detuning iterations (see Cryomodule_Set_Steady_State)
+#define CRYOMODULE_STEADY_TOL 1e-12  ///< Relative tolerance of the detune frequencies at steady state
+
+/** Fraction of non-zero couplings below which a Coupling_Matrix is applied in CSR form */
+#define COUPLING_CSR_DENSITY 0.25
+
+/**
+ * Electro-mechanical coupling matrix (n_rows x n_cols), stored dense (row-major)
+ * and, when most couplings are zero, also in Compressed-Sparse-Row form.
+ */
+typedef struct str_Coupling_Matrix {
+	int n_rows, n_cols;
+	double *dense;    ///< Dense coefficients (row-major)
+	int sparse;       ///< Set when the matrix is applied in CSR form
+	int nnz;          ///< Number of non-zero coefficients
+	int *row_start;   ///< CSR row pointers (of length n_rows+1)
+	int *col;         ///< CSR column indices (of length nnz)
+	double *val;      ///< CSR coefficients (of length nnz)
+
+} Coupling_Matrix;
+
 typedef struct str_Cryomodule {
 	int n_rf_stations, n_mechModes;
 	RF_Station **rf_station_net;
 	MechMode **mechMode_net;
+	MechMode_Bank mechMode_bank;  ///< Mechanical modes packed for stepping
+	int n_elecModes;      ///< Total number of Electrical modes (over all RF Stations)
+	Coupling_Matrix A;    ///< Electrical to Mechanical couplings (n_mechModes x n_elecModes)
+	Coupling_Matrix C;    ///< Mechanical to Electrical couplings (n_elecModes x n_mechModes)
+	int mech_decimation;  ///< Number of RF steps per Mechanical mode step (see Cryomodule_Set_Mech_Decimation)
+	int mech_interpolate; ///< Interpolate detune frequencies between Mechanical steps (hold if 0)
 
 } Cryomodule;
 
@@ -43,8 +97,15 @@ typedef Cryomodule** Cryomodule_dp;
 typedef struct str_Cryomodule_State {
 	RF_State **rf_state_net;
 	MechMode_State **mechMode_state_net;
+	MechMode_Bank_State mechMode_bank_state;
 	double *F_nu;
 	double complex cryo_Kg;
+	double *V_2;          ///< Packed squares of Electrical mode voltages (of length n_elecModes)
+	double *x_nu;         ///< Packed Mechanical mode displacements (of length n_mechModes)
+	double *delta_omega;  ///< Packed Electrical mode detune frequencies (of length n_elecModes)
+	double *V_2_sum;      ///< Sum of V_2 over the current Mechanical step (of length n_elecModes)
+	double *delta_omega_prev;  ///< Detune frequencies of the previous Mechanical step (of length n_elecModes)
+	int mech_count;       ///< Number of RF steps into the current Mechanical step
 
 } Cryomodule_State;
 
@@ -58,6 +119,18 @@ void MechMode_State_Allocate(MechMode_State *mechMode_State, MechMode *mechMode)
 void MechMode_State_Deallocate(MechMode_State *mechMode_State);
 void MechMode_Step(MechMode *mechMode, MechMode_State *mechMode_State, double complex F_nu);
 
+void MechMode_Bank_Allocate_Decimated(MechMode_Bank *bank, MechMode_dp mechMode_net, int n, int decimation);
+void MechMode_Bank_Allocate_In(MechMode_Bank *bank, MechMode_dp mechMode_net, int n);
+void MechMode_Bank_Deallocate(MechMode_Bank *bank);
+void MechMode_Bank_State_Allocate(MechMode_Bank_State *bank_state, MechMode_Bank *bank);
+void MechMode_Bank_State_Deallocate(MechMode_Bank_State *bank_state);
+void MechMode_Bank_Step(MechMode_Bank *bank, double *F_nu, double *x_nu, MechMode_Bank_State *bank_state);
+
+void Coupling_Matrix_Allocate_In(Coupling_Matrix *mat, int n_rows, int n_cols);
+void Coupling_Matrix_Deallocate(Coupling_Matrix *mat);
+void Coupling_Matrix_Compress(Coupling_Matrix *mat);
+void Coupling_Matrix_Apply(Coupling_Matrix *mat, double *x, double *y);
+
 RF_Station *Get_RF_Station(Cryomodule *cryo, int index);
 RF_State *Get_RF_State(Cryomodule_State *cryo_state, int index);
 MechMode_State *Get_MechMode_State(Cryomodule_State *cryo_state, int index);
@@ -67,8 +140,10 @@ void Cryomodule_Append(Cryomodule** cryo_arr, Cryomodule* cryo, int index);
 void Cryomodule_Allocate_In(Cryomodule *cryo, RF_Station_dp rf_station_net, int n_rf_stations, MechMode_dp mechMode_net, int n_mechModes);
 Cryomodule * Cryomodule_Allocate_New(RF_Station **rf_station_net, int n_rf_stations, MechMode **mechMode_net, int n_mechModes);
 void Cryomodule_Deallocate(Cryomodule* cryo);
+void Cryomodule_Set_Mech_Decimation(Cryomodule *cryo, int mech_decimation, int mech_interpolate);
 void Cryomodule_State_Allocate(Cryomodule_State *cryo_state, Cryomodule *cryo);
 void Cryomodule_State_Deallocate(Cryomodule_State *cryo_state, Cryomodule *cryo);
 double complex Cryomodule_Step(Cryomodule *cryo, Cryomodule_State * cryo_state, double delta_tz, double beam_charge);
+int Cryomodule_Set_Steady_State(Cryomodule *cryo, Cryomodule_State * cryo_state, double delta_tz, double beam_charge, double complex *cryo_V);
 
 #endif
@@ -120,11 +120,289 @@ def unit_Cryomodule():
 
     run_Cryomodule_test(Tmax, test_file)
 
+def run_coupling_matrices(test_file, Tmax):
+    """
+    Run a Cryomodule configuration for Tmax (cavity fill-up with Lorentz-force detuning, every RF Station in open loop)
+    on three instances: Cryomodule_Step with the coupling matrices as built (CSR form when sparse enough),
+    Cryomodule_Step with the dense form selected, and the loops Cryomodule_Step used before the coupling matrices,
+    with their accumulators restarted for every Mechanical and Electrical mode: RF_Station_Step, Lorentz forces summed
+    over RF Stations and Electrical modes, MechMode_Step and detune frequencies summed over Mechanical modes.
+    Returns the Cryomodule, the Lorentz forces (steps x Mechanical modes) and detune frequencies (steps x Electrical modes)
+    of the three runs, and the Lorentz forces of the reference loop with the accumulator carried over between
+    Mechanical modes (the bug the coupling matrices fixed).
+    """
+
+    # Import JSON parser module
+    from get_configuration import Get_SWIG_Cryomodule
+
+    cryo_object, Tstep, fund_mode_dicts = Get_SWIG_Cryomodule(test_file, Verbose=False)
+    dense_object, Tstep, fund_mode_dicts = Get_SWIG_Cryomodule(test_file, Verbose=False)
+    ref_object, Tstep, fund_mode_dicts = Get_SWIG_Cryomodule(test_file, Verbose=False)
+
+    for cryo in [cryo_object, dense_object, ref_object]:
+        for station in cryo.station_list:
+            station.C_Pointer.fpga.set_point = 30.0
+            station.State.fpga_state.openloop = 1
+
+    # The dense coefficients are kept in both forms
+    dense_object.C_Pointer.A.sparse = 0
+    dense_object.C_Pointer.C.sparse = 0
+
+    mechModes = ref_object.mechanical_mode_list
+    n_mech = len(mechModes)
+    n_elec = cryo_object.C_Pointer.n_elecModes
+
+    # Mechanical modes of the reference stepped on their own (MechMode_Step), with their own States
+    mechMode_states = []
+    for mechMode in mechModes:
+        state = acc.MechMode_State()
+        acc.MechMode_State_Allocate(state, mechMode.C_Pointer)
+        mechMode_states.append(state)
+
+    def elec_states(cryo):
+        return [acc.ElecMode_State_Get(station.State.cav_state, mu)
+            for station in cryo.station_list for mu in xrange(len(station.cavity.elec_modes))]
+
+    nt = int(Tmax/Tstep)
+    runs = []
+    for cryo in [cryo_object, dense_object]:
+        F_nu = acc.double_Array.frompointer(cryo.State.F_nu)
+        states = elec_states(cryo)
+        F = np.zeros((nt, n_mech), dtype=np.double)
+        delta_omega = np.zeros((nt, n_elec), dtype=np.double)
+        for i in xrange(nt):
+            acc.Cryomodule_Step(cryo.C_Pointer, cryo.State, 0.0, 0.0)
+            F[i] = [F_nu[nu] for nu in xrange(n_mech)]
+            delta_omega[i] = [state.delta_omega for state in states]
+        runs.append((F, delta_omega))
+
+    # Reference loops
+    ref_states = elec_states(ref_object)
+    A = [acc.double_Array.frompointer(mode.C_Pointer.A) for station in ref_object.station_list for mode in station.cavity.elec_modes]
+    C = [acc.double_Array.frompointer(mode.C_Pointer.C) for station in ref_object.station_list for mode in station.cavity.elec_modes]
+    F_ref = np.zeros((nt, n_mech), dtype=np.double)
+    F_carry = np.zeros((nt, n_mech), dtype=np.double)
+    delta_omega_ref = np.zeros((nt, n_elec), dtype=np.double)
+
+    for i in xrange(nt):
+        for station in ref_object.station_list:
+            acc.RF_Station_Step(station.C_Pointer, 0.0, 0.0, 0.0, station.State)
+
+        # Lorentz forces: F_nu = sum over mu (over RF Stations) of A(nu,mu)*V_2(mu)
+        F_now = 0.0
+        for nu in xrange(n_mech):
+            for mu, state in enumerate(ref_states):
+                F_ref[i, nu] += A[mu][nu]*state.V_2
+                F_now += A[mu][nu]*state.V_2
+            F_carry[i, nu] = F_now
+            acc.MechMode_Step(mechModes[nu].C_Pointer, mechMode_states[nu], F_ref[i, nu])
+
+        # Detune frequencies: delta_omega(mu) = sum over nu of C(mu,nu)*x_nu
+        for mu, state in enumerate(ref_states):
+            delta_omega_now = 0.0
+            for nu in xrange(n_mech):
+                delta_omega_now += C[mu][nu]*mechMode_states[nu].x_nu
+            state.delta_omega = delta_omega_now
+            delta_omega_ref[i, mu] = delta_omega_now
+
+    return cryo_object, runs[0], runs[1], (F_ref, delta_omega_ref), F_carry
+
+def check_coupling_matrices(test_file, Tmax, TOL, min_detuning):
+    """
+    Compare the Lorentz forces and detune frequencies of the CSR (or dense, as built), dense and reference runs
+    of run_coupling_matrices. Returns the Cryomodule, the reference Lorentz forces and the PASS/FAIL result:
+    the detune frequency moves by more than min_detuning [Hz], the dense and CSR forms agree exactly
+    (both sum in column order) and the reference loops within TOL (relative to the peak values) at every step.
+    """
+
+    cryo_object, (F, delta_omega), (F_dense, delta_omega_dense), (F_ref, delta_omega_ref), F_carry = run_coupling_matrices(test_file, Tmax)
+
+    peak = np.max(np.abs(delta_omega_ref))
+    F_err = np.max(np.abs(F - F_ref))/np.max(np.abs(F_ref))
+    dw_err = np.max(np.abs(delta_omega - delta_omega_ref))/peak
+    exact = np.array_equal(F, F_dense) & np.array_equal(delta_omega, delta_omega_dense)
+
+    print '   %d RF Stations, %d Electrical and %d Mechanical modes (%d and %d non-zero couplings, %s form)' % (
+        cryo_object.C_Pointer.n_rf_stations, cryo_object.C_Pointer.n_elecModes, cryo_object.C_Pointer.n_mechModes,
+        cryo_object.C_Pointer.A.nnz, cryo_object.C_Pointer.C.nnz, 'CSR' if cryo_object.C_Pointer.A.sparse else 'dense')
+    print '   peak detuning %.1f Hz, max relative difference to the reference: Lorentz forces %.2e, detuning %.2e; dense form %s' % (
+        peak/2.0/np.pi, F_err, dw_err, 'identical' if exact else 'differs')
+
+    return cryo_object, F_ref, F_carry, (peak/2.0/np.pi > min_detuning) & (F_err < TOL) & (dw_err < TOL) & exact
+
+def unit_coupling_matrices(Tmax=80e-6, TOL=1.0e-10, min_detuning=1e3):
+    """
+    Unit test for the electro-mechanical coupling matrices in Cryomodule_Step, on the Cryomodule unit test
+    configuration (one Electrical and one Mechanical mode, several thousand steps over two periods of the Mechanical mode).
+    The dense 1x1 matrices are checked against the reference loops (see run_coupling_matrices).
+    PASS if the matrices are applied in dense form and the conditions of check_coupling_matrices hold.
+    """
+
+    test_file = "source/configfiles/unit_tests/cryomodule_test.json"
+    cryo_object, F_ref, F_carry, passed = check_coupling_matrices(test_file, Tmax, TOL, min_detuning)
+
+    return passed & (cryo_object.C_Pointer.A.sparse == 0) & (cryo_object.C_Pointer.C.sparse == 0)
+
+def unit_coupling_matrices_sparse(Tmax=80e-6, TOL=1.0e-10, min_detuning=1e3):
+    """
+    Unit test for the sparse (CSR) electro-mechanical coupling matrices in Cryomodule_Step:
+    three RF Stations (seven Electrical modes) and six Mechanical modes with mostly zero couplings
+    (density below COUPLING_CSR_DENSITY), so that Lorentz forces and detune frequencies are sums over
+    several RF Stations and modes, and the dense form is applied in blocks of four rows plus remaining rows.
+    The CSR, dense and reference loops are compared (see check_coupling_matrices), and the reference loop without
+    the accumulator restarted between Mechanical modes is checked to differ (so that the test would catch it).
+    PASS if both matrices are applied in CSR form and all conditions hold.
+    """
+
+    test_file = "source/configfiles/unit_tests/cryomodule_coupling_test.json"
+    cryo_object, F_ref, F_carry, passed = check_coupling_matrices(test_file, Tmax, TOL, min_detuning)
+
+    A, C = cryo_object.C_Pointer.A, cryo_object.C_Pointer.C
+    sparse_pass = (A.sparse == 1) & (C.sparse == 1) & (A.n_rows >= 5) & (A.n_cols > 4) & (C.n_rows > 4) & \
+        (A.nnz <= acc.COUPLING_CSR_DENSITY*A.n_rows*A.n_cols) & (C.nnz == A.nnz)
+
+    carry_err = np.max(np.abs(F_carry - F_ref))/np.max(np.abs(F_ref))
+    print '   accumulator carried over between Mechanical modes: max relative difference %.2e' % carry_err
+
+    return passed & sparse_pass & (carry_err > TOL)
+
+def unit_mechMode_bank(n=5, Tstep=1e-6, nt=20000, TOL=1.0e-10):
+    """
+    Unit test for MechMode_Bank: step a bank of Mechanical modes and the same modes individually
+    (MechMode_Step) with the same Lorentz forces, and compare the displacements.
+    PASS if the maximum difference relative to the largest displacement is below TOL.
+    """
+
+    mechMode_net = acc.MechMode_Allocate_Array(n)
+    states = []
+    for nu in xrange(n):
+        mechMode = acc.MechMode_Allocate_New(100.0 + 50.0*nu, 20.0 + 10.0*nu, 1.0 + 0.5*nu, Tstep)
+        acc.MechMode_Append(mechMode_net, mechMode, nu)
+        state = acc.MechMode_State()
+        acc.MechMode_State_Allocate(state, mechMode)
+        states.append((mechMode, state))
+
+    bank = acc.MechMode_Bank()
+    acc.MechMode_Bank_Allocate_In(bank, mechMode_net, n)
+    bank_state = acc.MechMode_Bank_State()
+    acc.MechMode_Bank_State_Allocate(bank_state, bank)
+
+    F_nu = acc.double_Array(n)
+    x_nu = acc.double_Array(n)
+
+    max_err = 0.0
+    max_x = 0.0
+    for i in xrange(nt):
+        # Step forces of different amplitude for each mode
+        for nu in xrange(n):
+            F_nu[nu] = (1.0 + nu) if (i/(1000 + 100*nu)) % 2 else 0.0
+        acc.MechMode_Bank_Step(bank, F_nu, x_nu, bank_state)
+        for nu, (mechMode, state) in enumerate(states):
+            acc.MechMode_Step(mechMode, state, F_nu[nu])
+            max_err = max(max_err, abs(x_nu[nu] - state.x_nu))
+            max_x = max(max_x, abs(state.x_nu))
+
+    print '   max relative difference = %.2e' % (max_err/max_x)
+
+    return max_err/max_x < TOL
+
+def run_mech_decimation(Tmax, mech_decimation, mech_interpolate):
+    """
+    Run the Cryomodule unit test configuration with the Mechanical modes stepped
+    every mech_decimation RF steps and return the pi-mode's detune frequency waveform,
+    and whether the Mechanical mode Filters were left unchanged and the bank poles discretized
+    at mech_decimation*Tstep (the decimation is set twice, which must not compound).
+    """
+
+    # Import JSON parser module
+    from get_configuration import Get_SWIG_Cryomodule
+
+    test_file = "source/configfiles/unit_tests/cryomodule_test.json"
+    cryo_object, Tstep, fund_mode_dicts = Get_SWIG_Cryomodule(test_file, Verbose=False)
+
+    fils = [mechMode.C_Pointer.fil for mechMode in cryo_object.mechanical_mode_list]
+    coeffs = [acc.complexdouble_Array.frompointer(fil.coeffs)[0] for fil in fils]
+
+    acc.Cryomodule_Set_Mech_Decimation(cryo_object.C_Pointer, mech_decimation, mech_interpolate)
+    acc.Cryomodule_Set_Mech_Decimation(cryo_object.C_Pointer, mech_decimation, mech_interpolate)
+
+    bank = cryo_object.C_Pointer.mechMode_bank
+    a_re = acc.double_Array.frompointer(bank.a_re)
+    a_im = acc.double_Array.frompointer(bank.a_im)
+    a = acc.complexdouble_Array(1)
+    b = acc.complexdouble_Array(1)
+    fil_pass = True
+    for nu, fil in enumerate(fils):
+        fil_pass = fil_pass & (acc.complexdouble_Array.frompointer(fil.coeffs)[0] == coeffs[nu])
+        pole = acc.complexdouble_Array.frompointer(fil.poles)[0]
+        acc.Filter_Discretize(pole, mech_decimation*Tstep, fil.method, a, b)
+        fil_pass = fil_pass & (a_re[nu] + 1j*a_im[nu] == a[0])
+
+    cryo_object.station_list[0].C_Pointer.fpga.set_point = 30.0
+    cryo_object.station_list[0].State.fpga_state.openloop = 1
+
+    elecMode_state = acc.ElecMode_State_Get(cryo_object.station_list[0].State.cav_state, 0)
+
+    nt = int(Tmax/Tstep)
+    delta_omega = np.zeros(nt, dtype=np.double)
+    for i in xrange(nt):
+        acc.Cryomodule_Step(cryo_object.C_Pointer, cryo_object.State, 0.0, 0.0)
+        delta_omega[i] = elecMode_state.delta_omega
+
+    return delta_omega, fil_pass
+
+def unit_mech_decimation(Tmax=200e-6, mech_decimation=10, TOL=0.01):
+    """
+    Unit test for the Mechanical mode decimation in Cryomodule_Step:
+    compare the detune frequency with decimated Mechanical modes (held and interpolated)
+    against the one with Mechanical modes stepped at the RF rate, over Tmax
+    (six periods of the 30 kHz Mechanical mode, through the Lorentz-force detuning transient).
+    PASS if the maximum difference relative to the peak detune frequency is below TOL (1%,
+    measured 0.7% at a decimation of 10) and the Mechanical mode Filters are left unchanged.
+    """
+
+    delta_omega_ref, fil_pass = run_mech_decimation(Tmax, 1, 0)
+    peak = np.max(np.abs(delta_omega_ref))
+
+    passed = fil_pass
+    for mech_interpolate in [0, 1]:
+        delta_omega, fil_pass = run_mech_decimation(Tmax, mech_decimation, mech_interpolate)
+        err = np.max(np.abs(delta_omega - delta_omega_ref))/peak
+        print '   decimation %d (%s): max relative difference = %.2e (peak detuning %.1f Hz)' % (
+            mech_decimation, 'interpolated' if mech_interpolate else 'held', err, peak/2.0/np.pi)
+        passed = passed & fil_pass & (err < TOL)
+
+    return passed
+
 def perform_tests():
     """
-    Perform all unit tests for cryomodule.c/h and return PASS boolean (qualitative test).
+    Perform all unit tests for cryomodule.c/h and return PASS/FAIL boolean.
     """
 
+    print "\n****\nTesting Mechanical mode bank..."
+    bank_pass = unit_mechMode_bank()
+    if (bank_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Mechanical mode decimation..."
+    decimation_pass = unit_mech_decimation()
+    if (decimation_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting electro-mechanical coupling matrices..."
+    coupling_pass = unit_coupling_matrices() & unit_coupling_matrices_sparse()
+    if (coupling_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
     # This is not a PASS/FAIL test
     print "\n****\nTesting Cryomodule..."
     unit_Cryomodule()
@@ -132,7 +410,7 @@ def perform_tests():
 
     plt.figure()
 
-    return True
+    return bank_pass & decimation_pass & coupling_pass
 
 if __name__ == "__main__":
     plt.close('all')
@@ -18,17 +18,17 @@ void Doublecompress_State_Allocate(
   int Nlinac                   ///< Number of Linac Sections
   )
 {
-  dcs->Ipk =    (double*)calloc(Nlinac,sizeof(double));
-  dcs->sz =     (double*)calloc(Nlinac,sizeof(double));
-  dcs->dE_E =   (double*)calloc(Nlinac,sizeof(double));
-  dcs->sd =     (double*)calloc(Nlinac,sizeof(double));
-  dcs->dt =     (double*)calloc(Nlinac,sizeof(double));
-  dcs->sdsgn =  (double*)calloc(Nlinac,sizeof(double));
-  dcs->k =      (double*)calloc(Nlinac,sizeof(double));
-  dcs->Eloss =  (double*)calloc(Nlinac,sizeof(double));
-  dcs->dE_Ei =  (double*)calloc(Nlinac,sizeof(double));
-  dcs->dE_Ei2 = (double*)calloc(Nlinac,sizeof(double));
-  dcs->cor =    (double*)calloc(Nlinac,sizeof(double));
+  dcs->Ipk =    (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->sz =     (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->dE_E =   (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->sd =     (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->dt =     (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->sdsgn =  (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->k =      (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->Eloss =  (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->dE_Ei =  (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->dE_Ei2 = (double*)State_Calloc(Nlinac,sizeof(double));
+  dcs->cor =    (double*)State_Calloc(Nlinac,sizeof(double));
 }
 
 /** Frees memory of Doublecompress State struct. */
@@ -37,6 +37,8 @@ typedef struct str_noise_srcs {
   int type[N_NOISE_SRCS];
   double settings[N_NOISE_SRCS*N_NOISE_SETTINGS];
 
+  Noise_RNG rng;  ///< Random number stream of the noise sources (keyed in Sim_State_Allocate)
+
 } Noise_Srcs;
 
 void Doublecompress_State_Allocate(Doublecompress_State * dcs, int Nlinac);
@@ -6,8 +6,12 @@
 
 #include "filter.h"
 #include "stdlib.h"
+#include "string.h"
+#include "math.h"
 
 
+/** Allocates memory for a Filter struct of the depth indicated by the argument list.
+  * Returns a pointer to the newly allocated struct. */
 Filter * Filter_Allocate_New(
   int alloc_order,  ///< Number of modes
   int alloc_coeffs  ///< Number of coefficients per mode
@@ -16,20 +20,13 @@ Filter * Filter_Allocate_New(
   Filter * fil;
   fil = calloc(1,sizeof(Filter));
 
-  fil->alloc_order = alloc_order;
-  fil->alloc_coeffs = alloc_coeffs;
-
-  fil->n_coeffs=0;
-  fil->order = 0;
+  Filter_Allocate_In(fil, alloc_order, alloc_coeffs);
 
-  fil->modes = (int*)calloc(alloc_order,sizeof(int));
-  fil->coeff_start = (int*)calloc(alloc_order,sizeof(int));
-  fil->coeffs = (double complex *)calloc(3*alloc_coeffs,sizeof(double complex));
-  fil->poles = (double complex *)calloc(alloc_coeffs,sizeof(double complex));
   return fil;
 }
 
-/** Takes a pointer to a Filter struct and fills allocates a filter of the depth indicated by the argument list. */
+/** Takes a pointer to a Filter struct and fills allocates a filter of the depth indicated by the argument list.
+  * Single-pole, single-mode Filters use the inline storage in the Filter struct (no heap allocation). */
 void Filter_Allocate_In(
   Filter * fil,     ///< Pointer to Filter struct
   int alloc_order,  ///< Number of modes
@@ -42,25 +39,74 @@ void Filter_Allocate_In(
 
   fil->n_coeffs=0;
   fil->order = 0;
+  fil->method = FILTER_TUSTIN;
+  fil->version = 0;
+  fil->single_pole = 0;
+  fil->sp_scale = 0.0;
+
+  if(alloc_order == 1 && alloc_coeffs == 1) {
+    fil->modes = fil->inline_modes;
+    fil->coeff_start = fil->inline_coeff_start;
+    fil->coeffs = fil->inline_coeffs;
+    fil->poles = fil->inline_poles;
 
-  fil->modes = (int*)calloc(alloc_order,sizeof(int));
-  fil->coeff_start = (int*)calloc(alloc_order,sizeof(int));
+    fil->modes[0] = 0;
+    fil->coeff_start[0] = 0;
+    fil->coeffs[0] = fil->coeffs[1] = fil->coeffs[2] = 0.0;
+    fil->poles[0] = 0.0;
+  } else {
+    fil->modes = (int*)calloc(alloc_order,sizeof(int));
+    fil->coeff_start = (int*)calloc(alloc_order,sizeof(int));
 
-  fil->coeffs = (double complex *)calloc(3*alloc_coeffs,sizeof(double complex));
-  fil->poles = (double complex *)calloc(alloc_coeffs,sizeof(double complex));
+    fil->coeffs = (double complex *)calloc(3*alloc_coeffs,sizeof(double complex));
+    fil->poles = (double complex *)calloc(alloc_coeffs,sizeof(double complex));
+  }
 }
 
 /** Frees memory of a Filter struct */
 void Filter_Deallocate(Filter * fil)
 {
-  free(fil->poles);
-  free(fil->coeffs);
-  free(fil->coeff_start);
-  free(fil->modes);
+  // Inline storage is part of the Filter struct
+  if(fil->poles != fil->inline_poles) free(fil->poles);
+  if(fil->coeffs != fil->inline_coeffs) free(fil->coeffs);
+  if(fil->coeff_start != fil->inline_coeff_start) free(fil->coeff_start);
+  if(fil->modes != fil->inline_modes) free(fil->modes);
   fil->order = 0;
   fil->n_coeffs = 0;
   fil->alloc_order = 0;
   fil->alloc_coeffs = 0;
+  fil->single_pole = 0;
+}
+
+/** Helper routine to resize a Filter array which may be using inline storage:
+  * inline arrays are moved to the heap, heap arrays are reallocated. */
+static void * Filter_Resize(void * ptr, void * inline_ptr, size_t old_size, size_t new_size)
+{
+  void * new_ptr;
+  if(ptr == inline_ptr) {
+    new_ptr = malloc(new_size);
+    memcpy(new_ptr, ptr, old_size);
+  } else {
+    new_ptr = realloc(ptr, new_size);
+  }
+  return new_ptr;
+}
+
+/** Helper routine to compute the ODE coefficients (a: applied to the state, b: applied to the input)
+  * of a complex pole for the given discretization method. */
+void Filter_Discretize(double complex pole, double dt, int method, double complex * a, double complex * b)
+{
+  if(method == FILTER_ZOH) {
+    // Exact solution of the ODE with the input held constant over the step
+    *a = cexp(pole*dt);
+    *b = (pole != 0.0) ? (*a - 1.0)/pole : dt;
+  } else {
+    // Bilinear (Tustin) rule
+    *a = (1.0 + 0.5*dt*pole)
+        /(1.0 - 0.5*dt*pole);
+    *b =     dt
+        /(1.0-0.5*dt*pole);
+  }
 }
 
 /** Append one or more Filter modes to a Filter previously allocated.
@@ -78,10 +124,12 @@ void Filter_Append_Modes(
    */
   // Increment order of the filter and reallocate needed arrays
   fil->order++;
-  if(fil->order >= fil->alloc_order) {
-    fil->modes = realloc(fil->modes,fil->order*sizeof(int));
+  if(fil->order > fil->alloc_order) {
+    fil->modes = Filter_Resize(fil->modes, fil->inline_modes,
+      fil->alloc_order*sizeof(int), fil->order*sizeof(int));
+    fil->coeff_start = Filter_Resize(fil->coeff_start, fil->inline_coeff_start,
+      fil->alloc_order*sizeof(int), fil->order*sizeof(int));
     fil->alloc_order = fil->order;
-    fil->coeff_start = realloc(fil->coeff_start,fil->order*sizeof(int));
   }
   // Update the indexing arrays for the new entry
   fil->modes[fil->order-1] = mod;
@@ -91,9 +139,11 @@ void Filter_Append_Modes(
   }
   // Allocate more coefficients
   fil->n_coeffs += mod;
-  if(fil->n_coeffs >= fil->alloc_coeffs) {
-    fil->coeffs = realloc(fil->coeffs, fil->n_coeffs* 3*sizeof(double complex));
-    fil->poles = realloc(fil->poles, fil->n_coeffs *sizeof(double complex));
+  if(fil->n_coeffs > fil->alloc_coeffs) {
+    fil->coeffs = Filter_Resize(fil->coeffs, fil->inline_coeffs,
+      fil->alloc_coeffs*3*sizeof(double complex), fil->n_coeffs*3*sizeof(double complex));
+    fil->poles = Filter_Resize(fil->poles, fil->inline_poles,
+      fil->alloc_coeffs*sizeof(double complex), fil->n_coeffs*sizeof(double complex));
 
     fil->alloc_coeffs = fil->n_coeffs;
   }
@@ -104,25 +154,79 @@ void Filter_Append_Modes(
   for(i=0; i<mod; i++) {
     int cs = fil->coeff_start[fil->order-1]+i;
     fil->poles[cs]=poles[i];
-    fil->coeffs[3*cs+0] = (1.0 + 0.5*dt*poles[i])
-                        /(1.0 - 0.5*dt*poles[i]);
-    fil->coeffs[3*cs+1] =     dt
-                        /(1.0-0.5*dt*poles[i]);
+    Filter_Discretize(poles[i], dt, fil->method, &fil->coeffs[3*cs+0], &fil->coeffs[3*cs+1]);
     fil->coeffs[3*cs+2] = cabs(poles[i]);
   }
 
+  // Single pole with a single mode: use dedicated step routine
+  fil->single_pole = (fil->order == 1 && fil->n_coeffs == 1);
+  fil->sp_scale = creal(fil->coeffs[2]);
+  fil->version++;
+}
+
+/** Select the discretization method of a Filter (FILTER_TUSTIN or FILTER_ZOH)
+  * and recompute the coefficients of all its modes from the stored poles.
+  * Modes appended afterwards use the same method.
+  * FILTER_ZOH maps every pole exactly (exp(p*dt)), which keeps the phase of
+  * high-bandwidth poles accurate at larger time steps. */
+void Filter_Set_Discretization(
+  Filter * fil,   ///< Pointer to Filter struct
+  int method,     ///< Discretization method
+  double dt       ///< Simulation time step in seconds
+  )
+{
+  int cs;
+
+  fil->method = method;
+  for(cs=0; cs<fil->n_coeffs; cs++) {
+    Filter_Discretize(fil->poles[cs], dt, method, &fil->coeffs[3*cs+0], &fil->coeffs[3*cs+1]);
+  }
+  fil->version++;
+}
+
+/** Accuracy report of the Tustin discretization of a Filter at time step dt:
+  * compares the Tustin pole mapping with the exact one (exp(p*dt)) for every mode,
+  * and returns the worst relative magnitude error and the worst phase error
+  * (in radians per step) of the discrete poles. */
+void Filter_Discretization_Error(
+  Filter * fil,           ///< Pointer to Filter struct
+  double dt,              ///< Simulation time step in seconds
+  double * mag_error,     ///< Worst relative magnitude error
+  double * phase_error    ///< Worst phase error in radians per step
+  )
+{
+  int cs;
+  double complex a_tustin, a_exact, b, ratio;
+
+  *mag_error = 0.0;
+  *phase_error = 0.0;
+  for(cs=0; cs<fil->n_coeffs; cs++) {
+    Filter_Discretize(fil->poles[cs], dt, FILTER_TUSTIN, &a_tustin, &b);
+    Filter_Discretize(fil->poles[cs], dt, FILTER_ZOH, &a_exact, &b);
+    ratio = a_tustin/a_exact;
+    if(fabs(cabs(ratio)-1.0) > *mag_error) *mag_error = fabs(cabs(ratio)-1.0);
+    if(fabs(carg(ratio)) > *phase_error) *phase_error = fabs(carg(ratio));
+  }
 }
 
-/** Takes a previously configured Filter and allocates its State struct accordingly. */
+/** Takes a previously configured Filter and allocates its State struct accordingly.
+  * Single-pole Filters use the inline storage in the State struct. */
 void Filter_State_Allocate(Filter_State * sf, Filter * fil) {
-  sf->state = calloc(fil->n_coeffs,sizeof(double complex));
-  sf->input = calloc(fil->order,sizeof(double complex));
+  if(fil->single_pole) {
+    sf->state = sf->inline_state;
+    sf->input = sf->inline_input;
+    sf->state[0] = 0.0;
+    sf->input[0] = 0.0;
+  } else {
+    sf->state = State_Calloc(fil->n_coeffs,sizeof(double complex));
+    sf->input = State_Calloc(fil->order,sizeof(double complex));
+  }
 }
 
 /** Frees memory of Filter State struct. */
 void Filter_State_Deallocate(Filter_State * sf) {
-  free(sf->state);
-  free(sf->input);
+  if(sf->state != sf->inline_state) free(sf->state);
+  if(sf->input != sf->inline_input) free(sf->input);
 }
 
 /** Helper routine to zero out Filter state. Useful to restore initial state in unit tests. */
@@ -157,13 +261,18 @@ double complex Filter_Step(
   // Signal connecting cascading poles (start with current input)
   double complex output = innow;
 
+  // Dedicated routine for single-pole Filters
+  if(fil->single_pole) return Filter_Step_Single_Pole(fil, innow, fil_state);
+
   // Iterate over poles
   for(o=0;o<fil->order;o++) {
     // Previous input
     prev_in = fil_state->input[o];
     // Store input for next step
     fil_state->input[o] = output;
-    voltage_in = 0.5*(fil_state->input[o] + prev_in);
+    // Hold current input (ZOH) or average it with the previous one (Tustin)
+    if(fil->method == FILTER_ZOH) voltage_in = output;
+    else voltage_in = 0.5*(fil_state->input[o] + prev_in);
 
     // Clear output of current pole
     output = 0.0;
@@ -193,7 +302,477 @@ double complex Filter_Step(
   return output;
 }
 
+/** Step function for single-pole, single-mode Filters
+  * (Electrical modes, SSA and noise-shaping filters):
+  * same as Filter_Step without the iterations over poles and modes. */
+double complex Filter_Step_Single_Pole(
+  Filter * fil,               ///< Pointer to Filter struct
+  double complex innow,       ///< Complex input
+  Filter_State * fil_state    ///< Pointer to Filter State
+  )
+{
+  // Hold current input (ZOH) or average it with the previous one (Tustin)
+  double complex voltage_in = (fil->method == FILTER_ZOH) ? innow : 0.5*(innow + fil_state->input[0]);
+  // Store input for next step
+  fil_state->input[0] = innow;
+
+  // Update state (a and b coefficients)
+  fil_state->state[0] = fil->coeffs[0]*fil_state->state[0]+fil->coeffs[1]*voltage_in;
+
+  // Scale to keep unity gain at DC
+  return fil_state->state[0]*fil->sp_scale;
+}
+
+/** Block step function for Filter model:
+  * Equivalent to calling Filter_Step once per sample over a block of n input samples,
+  * but the block is swept one cascaded pole at a time, so that the pole's coefficients,
+  * state and previous input are kept in local variables across the whole block.
+  * Stores the Filter output for every input sample in out (in and out may be the same array). */
+void Filter_Step_Block(
+  Filter * fil,               ///< Pointer to Filter struct
+  double complex * in,        ///< Array of n complex inputs
+  double complex * out,       ///< Array of n complex outputs
+  int n,                      ///< Number of samples in the block
+  Filter_State * fil_state    ///< Pointer to Filter State
+  )
+{
+  // Indeces
+  int i,o,m,cs;
+  // Intermediate input signals
+  double complex x, voltage_in, prev_in;
+  // ODE coefficients and state for single-mode poles
+  double complex a,b,scale,state;
+  // Signal connecting cascading poles (start with current input)
+  double complex output;
+  // Input to the current pole (block input for the first pole, previous pole's output otherwise)
+  double complex * pole_in = in;
+  // Hold current input (ZOH) or average it with the previous one (Tustin)
+  int zoh = (fil->method == FILTER_ZOH);
+
+  // Pass input through if the Filter has no poles
+  if(fil->order == 0) {
+    for(i=0;i<n;i++) out[i] = in[i];
+    return;
+  }
+
+  // Iterate over poles
+  for(o=0;o<fil->order;o++) {
+    // Previous input (last sample of previous block)
+    prev_in = fil_state->input[o];
+
+    if(fil->modes[o] == 1) {
+      // Single mode: keep coefficients and state local across the block
+      cs = fil->coeff_start[o];
+      a = fil->coeffs[3*cs+0];
+      b = fil->coeffs[3*cs+1];
+      scale = fil->coeffs[3*cs+2];
+      state = fil_state->state[cs];
+
+      for(i=0;i<n;i++) {
+        x = pole_in[i];
+        voltage_in = zoh ? x : 0.5*(x + prev_in);
+        prev_in = x;
+        state = a*state+b*voltage_in;
+        output = 0.0;
+        output += state*scale;
+        out[i] = output;
+      }
+      fil_state->state[cs] = state;
+    } else {
+      // Several modes in parallel
+      for(i=0;i<n;i++) {
+        x = pole_in[i];
+        voltage_in = zoh ? x : 0.5*(x + prev_in);
+        prev_in = x;
+        output = 0.0;
+        for(m=0;m<fil->modes[o];m++) {
+          cs = fil->coeff_start[o]+m;
+          fil_state->state[cs] = fil->coeffs[3*cs+0]*fil_state->state[cs]+fil->coeffs[3*cs+1]*voltage_in;
+          output += fil_state->state[cs]*fil->coeffs[3*cs+2];
+        }
+        out[i] = output;
+      }
+    }
+
+    // Store last input for next block
+    fil_state->input[o] = prev_in;
+    // Output of this pole is the input to the next one
+    pole_in = out;
+
+  } // End pole iteration
+}
+
 void Filter_Set_State(Filter * fil, Filter_State * fil_state, double complex state)
 {
   fil_state->state[0] = state/fil->coeffs[2];
 }
+
+/** Helper routine for the steady state of a Filter mode driven by an input phasor x*rot^n:
+  * returns the ratio of the mode's state to the input at the same step. */
+static double complex Filter_Mode_Phasor_Ratio(Filter * fil, int cs, double complex rot)
+{
+  double complex a = fil->coeffs[3*cs+0], b = fil->coeffs[3*cs+1];
+
+  // s = a*s/rot + b*(x, or the average of x and x/rot for Tustin)
+  if(fil->method == FILTER_ZOH) return b*rot/(rot - a);
+  return 0.5*b*(rot + 1.0)/(rot - a);
+}
+
+/** Steady-state gain of a Filter for an input phasor rotating by rot every step
+  * (x[n] = x*rot^n, rot = 1 for a constant input): ratio of the output to the input at the same step.
+  * Unity for a constant input (see the output scaling in Filter_Step). */
+double complex Filter_Phasor_Gain(
+  Filter * fil,         ///< Pointer to Filter struct
+  double complex rot    ///< Rotation of the input phasor per step
+  )
+{
+  int o, m, cs;
+  double complex gain = 1.0, pole_gain;
+
+  for(o=0;o<fil->order;o++) {
+    pole_gain = 0.0;
+    for(m=0;m<fil->modes[o];m++) {
+      cs = fil->coeff_start[o]+m;
+      pole_gain += Filter_Mode_Phasor_Ratio(fil, cs, rot)*fil->coeffs[3*cs+2];
+    }
+    gain *= pole_gain;
+  }
+  return gain;
+}
+
+/** Set the State of a Filter to its steady state (forced response) for an input phasor
+  * rotating by rot every step (rot = 1 for a constant input), in has been the input of the last step:
+  * stepping the Filter with in*rot, in*rot^2... continues the steady state without transient.
+  * Returns the Filter output of the last step (in*Filter_Phasor_Gain). */
+double complex Filter_Set_Steady_State(
+  Filter * fil,               ///< Pointer to Filter struct
+  Filter_State * fil_state,   ///< Pointer to Filter State
+  double complex in,          ///< Input of the last step
+  double complex rot          ///< Rotation of the input phasor per step
+  )
+{
+  int o, m, cs;
+  double complex output = in, pole_in;
+
+  for(o=0;o<fil->order;o++) {
+    pole_in = output;
+    fil_state->input[o] = pole_in;
+    output = 0.0;
+    for(m=0;m<fil->modes[o];m++) {
+      cs = fil->coeff_start[o]+m;
+      fil_state->state[cs] = Filter_Mode_Phasor_Ratio(fil, cs, rot)*pole_in;
+      output += fil_state->state[cs]*fil->coeffs[3*cs+2];
+    }
+  }
+  return output;
+}
+
+/** Helper routine raising a complex number to a non-negative integer power
+  * (binary exponentiation: rounding errors grow with log2(n) rather than n). */
+static double complex Filter_Power(double complex z, int n)
+{
+  double complex p = 1.0;
+
+  while(n > 0) {
+    if(n & 1) p *= z;
+    z *= z;
+    n >>= 1;
+  }
+  return p;
+}
+
+/** Advance a Filter by n steps of an input phasor rotating by rot every step
+  * (inputs in, in*rot, ..., in*rot^(n-1); rot = 1 for a constant input) in closed form:
+  * after one regular step (the previous input may differ), the state of every mode is its forced
+  * response plus a transient decaying as a^k. Equivalent to n calls to Filter_Step up to rounding errors.
+  * Only single-pole (possibly multi-mode) Filters are supported, cascaded poles being driven by
+  * the transients of the previous ones.
+  * Returns 0 and the output of the last step in *out, or -1 (Filter State untouched) if not supported. */
+int Filter_Fast_Forward(
+  Filter * fil,               ///< Pointer to Filter struct
+  Filter_State * fil_state,   ///< Pointer to Filter State
+  double complex in,          ///< Input of the first step
+  double complex rot,         ///< Rotation of the input phasor per step
+  int n,                      ///< Number of steps (>= 1)
+  double complex * out        ///< Output of the last step (output)
+  )
+{
+  int m, cs;
+  double complex ratio, a_n, in_n, output = 0.0;
+
+  if(fil->order != 1) return -1;
+  for(m=0;m<fil->modes[0];m++) {
+    if(rot == fil->coeffs[3*(fil->coeff_start[0]+m)+0]) return -1;  // Resonant input: no forced response
+  }
+
+  // First step (previous input as stored)
+  *out = Filter_Step(fil, in, fil_state);
+  if(n <= 1) return 0;
+
+  // Remaining n-1 steps: s = a^(n-1)*(s - R*in) + R*in*rot^(n-1)
+  in_n = in*Filter_Power(rot, n-1);
+  for(m=0;m<fil->modes[0];m++) {
+    cs = fil->coeff_start[0]+m;
+    ratio = Filter_Mode_Phasor_Ratio(fil, cs, rot);
+    a_n = Filter_Power(fil->coeffs[3*cs+0], n-1);
+    fil_state->state[cs] = a_n*(fil_state->state[cs] - ratio*in) + ratio*in_n;
+    output += fil_state->state[cs]*fil->coeffs[3*cs+2];
+  }
+  fil_state->input[0] = in_n;
+
+  *out = output;
+  return 0;
+}
+
+/** Number of steps of a constant input after which every mode of a single-pole Filter is within
+  * a relative tolerance tol of its steady state (see Filter_Set_Steady_State): 0 if it already is,
+  * in having been the input of the last step. The decay of each transient is estimated from its pole.
+  * Returns -1 if the Filter is not single-pole, or a transient does not settle (zero steady state, unstable pole). */
+int Filter_Settle_Steps(
+  Filter * fil,               ///< Pointer to Filter struct
+  Filter_State * fil_state,   ///< Pointer to Filter State
+  double complex in,          ///< Constant input
+  double tol                  ///< Relative tolerance
+  )
+{
+  int m, cs, steps;
+  double complex s_ss;
+  double tr, ss, a, k;
+
+  if(fil->order != 1) return -1;
+
+  // A different previous input enters the next step (Tustin)
+  steps = (fil_state->input[0] == in) ? 0 : 1;
+
+  for(m=0;m<fil->modes[0];m++) {
+    cs = fil->coeff_start[0]+m;
+    s_ss = Filter_Mode_Phasor_Ratio(fil, cs, 1.0)*in;
+    tr = cabs(fil_state->state[cs] - s_ss);
+    ss = cabs(s_ss);
+    if(tr <= tol*ss) continue;
+
+    a = cabs(fil->coeffs[3*cs+0]);
+    if(ss == 0.0 || a >= 1.0) return -1;
+    k = ceil(log(tol*ss/tr)/log(a));
+    if(k > 0x7fffffff) return -1;
+    if(k > steps) steps = (int)k;
+  }
+  return steps;
+}
+
+/** Takes a pointer to a Filter_Bank struct and allocates memory for alloc_n single-pole filters. */
+void Filter_Bank_Allocate_In(
+  Filter_Bank * bank,   ///< Pointer to Filter_Bank struct
+  int alloc_n           ///< Number of filters to allocate memory for
+  )
+{
+  bank->n = 0;
+  bank->alloc_n = alloc_n;
+
+  bank->p_re = (double *)calloc(alloc_n,sizeof(double));
+  bank->p_im = (double *)calloc(alloc_n,sizeof(double));
+  bank->a_re = (double *)calloc(alloc_n,sizeof(double));
+  bank->a_im = (double *)calloc(alloc_n,sizeof(double));
+  bank->b_re = (double *)calloc(alloc_n,sizeof(double));
+  bank->b_im = (double *)calloc(alloc_n,sizeof(double));
+  bank->scale = (double *)calloc(alloc_n,sizeof(double));
+  bank->w_now = (double *)calloc(alloc_n,sizeof(double));
+  bank->w_prev = (double *)calloc(alloc_n,sizeof(double));
+}
+
+/** Frees memory of a Filter_Bank struct */
+void Filter_Bank_Deallocate(Filter_Bank * bank)
+{
+  free(bank->p_re);
+  free(bank->p_im);
+  free(bank->a_re);
+  free(bank->a_im);
+  free(bank->b_re);
+  free(bank->b_im);
+  free(bank->scale);
+  free(bank->w_now);
+  free(bank->w_prev);
+  bank->n = 0;
+  bank->alloc_n = 0;
+}
+
+/** Helper routine to grow the Filter_Bank arrays if needed and return the index of a new entry. */
+static int Filter_Bank_New_Entry(Filter_Bank * bank)
+{
+  if(bank->n >= bank->alloc_n) {
+    int alloc_n = (bank->alloc_n > 0) ? 2*bank->alloc_n : 1;
+    bank->p_re = realloc(bank->p_re, alloc_n*sizeof(double));
+    bank->p_im = realloc(bank->p_im, alloc_n*sizeof(double));
+    bank->a_re = realloc(bank->a_re, alloc_n*sizeof(double));
+    bank->a_im = realloc(bank->a_im, alloc_n*sizeof(double));
+    bank->b_re = realloc(bank->b_re, alloc_n*sizeof(double));
+    bank->b_im = realloc(bank->b_im, alloc_n*sizeof(double));
+    bank->scale = realloc(bank->scale, alloc_n*sizeof(double));
+    bank->w_now = realloc(bank->w_now, alloc_n*sizeof(double));
+    bank->w_prev = realloc(bank->w_prev, alloc_n*sizeof(double));
+    bank->alloc_n = alloc_n;
+  }
+  return bank->n++;
+}
+
+/** Helper routine to set the input weights of a Filter_Bank entry for the given discretization method. */
+static void Filter_Bank_Set_Weights(Filter_Bank * bank, int k, int method)
+{
+  if(method == FILTER_ZOH) {
+    bank->w_now[k] = 1.0;
+    bank->w_prev[k] = 0.0;
+  } else {
+    bank->w_now[k] = 0.5;
+    bank->w_prev[k] = 0.5;
+  }
+}
+
+/** Append a single-pole filter to the Filter_Bank given its (complex) pole,
+  * using the same discretization as Filter_Append_Modes.
+  * Returns the position of the new filter in the bank. */
+int Filter_Bank_Append(
+  Filter_Bank * bank,     ///< Pointer to Filter_Bank struct
+  double complex pole,    ///< Complex pole
+  double dt,              ///< Simulation time step in seconds
+  int method              ///< Discretization method (FILTER_TUSTIN or FILTER_ZOH)
+  )
+{
+  int k = Filter_Bank_New_Entry(bank);
+
+  double complex a, b;
+  Filter_Discretize(pole, dt, method, &a, &b);
+
+  bank->p_re[k] = creal(pole);
+  bank->p_im[k] = cimag(pole);
+  bank->a_re[k] = creal(a);
+  bank->a_im[k] = cimag(a);
+  bank->b_re[k] = creal(b);
+  bank->b_im[k] = cimag(b);
+  bank->scale[k] = cabs(pole);
+  Filter_Bank_Set_Weights(bank, k, method);
+
+  return k;
+}
+
+/** Set entry k of the Filter_Bank to a previously configured single-pole, single-mode Filter
+  * (coefficients are copied, so that the bank reproduces Filter_Step).
+  * Call again to refresh the entry after the Filter's coefficients change (see Filter.version).
+  * Returns k, or -1 if the Filter is not single-pole or k is not an entry of the bank. */
+int Filter_Bank_Set_Filter(
+  Filter_Bank * bank,     ///< Pointer to Filter_Bank struct
+  int k,                  ///< Position of the filter in the bank
+  Filter * fil            ///< Pointer to single-pole Filter
+  )
+{
+  if(fil->order != 1 || fil->modes[0] != 1 || k < 0 || k >= bank->n) return -1;
+
+  bank->p_re[k] = creal(fil->poles[0]);
+  bank->p_im[k] = cimag(fil->poles[0]);
+  bank->a_re[k] = creal(fil->coeffs[0]);
+  bank->a_im[k] = cimag(fil->coeffs[0]);
+  bank->b_re[k] = creal(fil->coeffs[1]);
+  bank->b_im[k] = cimag(fil->coeffs[1]);
+  bank->scale[k] = creal(fil->coeffs[2]);
+  Filter_Bank_Set_Weights(bank, k, fil->method);
+
+  return k;
+}
+
+/** Append a previously configured single-pole, single-mode Filter to the Filter_Bank
+  * (see Filter_Bank_Set_Filter).
+  * Returns the position of the new filter in the bank, or -1 if the Filter is not single-pole. */
+int Filter_Bank_Append_Filter(
+  Filter_Bank * bank,     ///< Pointer to Filter_Bank struct
+  Filter * fil            ///< Pointer to single-pole Filter
+  )
+{
+  if(fil->order != 1 || fil->modes[0] != 1) return -1;
+
+  return Filter_Bank_Set_Filter(bank, Filter_Bank_New_Entry(bank), fil);
+}
+
+/** Takes a previously configured Filter_Bank and allocates its State struct accordingly. */
+void Filter_Bank_State_Allocate(Filter_Bank_State * bank_state, Filter_Bank * bank)
+{
+  bank_state->s_re = (double *)State_Calloc(bank->n,sizeof(double));
+  bank_state->s_im = (double *)State_Calloc(bank->n,sizeof(double));
+  bank_state->u_re = (double *)State_Calloc(bank->n,sizeof(double));
+  bank_state->u_im = (double *)State_Calloc(bank->n,sizeof(double));
+}
+
+/** Frees memory of Filter_Bank State struct. */
+void Filter_Bank_State_Deallocate(Filter_Bank_State * bank_state)
+{
+  free(bank_state->s_re);
+  free(bank_state->s_im);
+  free(bank_state->u_re);
+  free(bank_state->u_im);
+}
+
+/** Helper routine to zero out Filter_Bank state. */
+void Filter_Bank_State_Clear(Filter_Bank * bank, Filter_Bank_State * bank_state)
+{
+  for(int k=0;k<bank->n;k++) {
+    bank_state->s_re[k] = 0.0;
+    bank_state->s_im[k] = 0.0;
+    bank_state->u_re[k] = 0.0;
+    bank_state->u_im[k] = 0.0;
+  }
+}
+
+/** Filter_Bank kernel: arrays are passed as restrict-qualified arguments
+  * so that the compiler can vectorize the loop over filters. */
+static void Filter_Bank_Kernel(
+  int n,
+  const double * restrict x_re, const double * restrict x_im,
+  double * restrict y_re, double * restrict y_im,
+  const double * restrict a_re, const double * restrict a_im,
+  const double * restrict b_re, const double * restrict b_im,
+  const double * restrict scale,
+  const double * restrict w_now, const double * restrict w_prev,
+  double * restrict s_re, double * restrict s_im,
+  double * restrict u_re, double * restrict u_im
+  )
+{
+  int k;
+  for(k=0;k<n;k++) {
+    // Weighted current and previous input
+    // (0.5*x + 0.5*u equals 0.5*(x+u) exactly, so Tustin entries reproduce Filter_Step)
+    double v_re = w_now[k]*x_re[k] + w_prev[k]*u_re[k];
+    double v_im = w_now[k]*x_im[k] + w_prev[k]*u_im[k];
+    // Store input for next step
+    u_re[k] = x_re[k];
+    u_im[k] = x_im[k];
+
+    // state = a*state + b*voltage_in
+    double st_re = (a_re[k]*s_re[k] - a_im[k]*s_im[k]) + (b_re[k]*v_re - b_im[k]*v_im);
+    double st_im = (a_re[k]*s_im[k] + a_im[k]*s_re[k]) + (b_re[k]*v_im + b_im[k]*v_re);
+    s_re[k] = st_re;
+    s_im[k] = st_im;
+
+    // Scale output to keep unity gain at DC
+    y_re[k] = st_re*scale[k];
+    y_im[k] = st_im*scale[k];
+  }
+}
+
+/** Step function for Filter_Bank:
+  * Steps all the filters in the bank by one simulation step (in_re[k] + j*in_im[k] is the input to filter k,
+  * out_re[k] + j*out_im[k] its output; inputs and outputs must not overlap).
+  * Inputs and outputs are split into real and imaginary arrays, like the bank's coefficients and states.
+  * Complex products are written out in real arithmetic in the same order as
+  * Filter_Step evaluates them, so each filter reproduces Filter_Step on a
+  * single-pole Filter with the same coefficients. */
+void Filter_Bank_Step(
+  Filter_Bank * bank,             ///< Pointer to Filter_Bank struct
+  double * in_re,                 ///< Array of bank->n input real parts
+  double * in_im,                 ///< Array of bank->n input imaginary parts
+  double * out_re,                ///< Array of bank->n output real parts
+  double * out_im,                ///< Array of bank->n output imaginary parts
+  Filter_Bank_State * bank_state  ///< Pointer to Filter_Bank State
+  )
+{
+  Filter_Bank_Kernel(bank->n, in_re, in_im, out_re, out_im,
+    bank->a_re, bank->a_im, bank->b_re, bank->b_im, bank->scale, bank->w_now, bank->w_prev,
+    bank_state->s_re, bank_state->s_im, bank_state->u_re, bank_state->u_im);
+}
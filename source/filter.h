@@ -10,7 +10,18 @@
 #ifndef FILTER_H
 #define FILTER_H
 #include "complex.h"
+#include "state_arena.h"
 
+/** Filter discretization methods (see Filter_Set_Discretization) */
+#define FILTER_TUSTIN 0   ///< Bilinear (Tustin) rule, input averaged over the step (default)
+#define FILTER_ZOH 1      ///< Exact exponential (exp(p*dt)), zero-order-hold input
+
+/**
+ * Filters allocated for a single pole and a single mode (Filter_Allocate_In(fil,1,1))
+ * point their arrays to inline storage in the struct instead of the heap,
+ * and are stepped by the dedicated Filter_Step_Single_Pole routine.
+ * A Filter (or Filter_State) must therefore not be copied by value once allocated.
+ */
 typedef struct str_filter {
   int alloc_order;
   int alloc_coeffs;
@@ -20,23 +31,79 @@ typedef struct str_filter {
   int *coeff_start;
   double complex * coeffs;
   double complex * poles;
+
+  int method;       ///< Discretization method (FILTER_TUSTIN or FILTER_ZOH)
+  int version;      ///< Incremented whenever the coefficients change (copies such as Filter_Bank entries compare it)
+
+  int single_pole;  ///< Set when the Filter has a single pole with a single mode
+  double sp_scale;  ///< Output scaling of a single-pole Filter (real)
+
+  // Inline storage for single-pole Filters
+  int inline_modes[1];
+  int inline_coeff_start[1];
+  double complex inline_coeffs[3];
+  double complex inline_poles[1];
 } Filter;
 
 typedef struct str_filter_state {
   double complex * state; // of length n_coeffs
   double complex * input; // of length order
+
+  // Inline storage for single-pole Filters
+  double complex inline_state[1];
+  double complex inline_input[1];
 } Filter_State;
 
+/**
+ * Bank of independent single-pole Filters stepped in lockstep.
+ * Coefficients are stored in structure-of-arrays form (real and imaginary
+ * parts in separate contiguous arrays) so that Filter_Bank_Step
+ * reduces to a single loop the compiler can vectorize.
+ */
+typedef struct str_filter_bank {
+  int n;          ///< Number of filters in the bank
+  int alloc_n;    ///< Number of filters memory has been allocated for
+  double *p_re, *p_im;  ///< Poles
+  double *a_re, *a_im;  ///< ODE coefficient applied to the state
+  double *b_re, *b_im;  ///< ODE coefficient applied to the input
+  double *scale;        ///< Output scaling (unity gain at DC)
+  double *w_now, *w_prev;  ///< Input weights of current and previous input (set by discretization method)
+} Filter_Bank;
+
+typedef struct str_filter_bank_state {
+  double *s_re, *s_im;  ///< Filter states (of length n)
+  double *u_re, *u_im;  ///< Previous inputs (of length n)
+} Filter_Bank_State;
+
 Filter * Filter_Allocate_New(int alloc_order, int alloc_coeffs);
 void Filter_Allocate_In(Filter * fil, int alloc_order, int alloc_coeffs);
 void Filter_Deallocate(Filter * fil);
 
 void Filter_Append_Modes(Filter * fil, double complex * poles,int ord,double dt);
+void Filter_Discretize(double complex pole, double dt, int method, double complex * a, double complex * b);
+void Filter_Set_Discretization(Filter * fil, int method, double dt);
+void Filter_Discretization_Error(Filter * fil, double dt, double * mag_error, double * phase_error);
 
 void Filter_State_Allocate(Filter_State * sf, Filter * fil);
 void Filter_State_Deallocate(Filter_State * sf);
 void Filter_State_Clear(Filter * fil, Filter_State * sf);
 double complex Filter_Step(Filter * fil, double complex innow, Filter_State * fil_state);
+double complex Filter_Step_Single_Pole(Filter * fil, double complex innow, Filter_State * fil_state);
+void Filter_Step_Block(Filter * fil, double complex * in, double complex * out, int n, Filter_State * fil_state);
 void Filter_Set_State(Filter * fil, Filter_State * fil_state, double complex state);
+double complex Filter_Phasor_Gain(Filter * fil, double complex rot);
+double complex Filter_Set_Steady_State(Filter * fil, Filter_State * fil_state, double complex in, double complex rot);
+int Filter_Fast_Forward(Filter * fil, Filter_State * fil_state, double complex in, double complex rot, int n, double complex * out);
+int Filter_Settle_Steps(Filter * fil, Filter_State * fil_state, double complex in, double tol);
+
+void Filter_Bank_Allocate_In(Filter_Bank * bank, int alloc_n);
+void Filter_Bank_Deallocate(Filter_Bank * bank);
+int Filter_Bank_Append(Filter_Bank * bank, double complex pole, double dt, int method);
+int Filter_Bank_Append_Filter(Filter_Bank * bank, Filter * fil);
+int Filter_Bank_Set_Filter(Filter_Bank * bank, int k, Filter * fil);
+void Filter_Bank_State_Allocate(Filter_Bank_State * bank_state, Filter_Bank * bank);
+void Filter_Bank_State_Deallocate(Filter_Bank_State * bank_state);
+void Filter_Bank_State_Clear(Filter_Bank * bank, Filter_Bank_State * bank_state);
+void Filter_Bank_Step(Filter_Bank * bank, double * in_re, double * in_im, double * out_re, double * out_im, Filter_Bank_State * bank_state);
 
 #endif
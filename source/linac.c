@@ -120,12 +120,12 @@ void Linac_State_Allocate(Linac_State *linac_state, Linac *linac)
 {
 
 	// Allocate memory for the array of states
-	linac_state->cryo_state_net = calloc(linac->n_cryos, sizeof(Cryomodule_State *));
+	linac_state->cryo_state_net = State_Calloc(linac->n_cryos, sizeof(Cryomodule_State *));
 
 	// Then allocate memory for the States themselves
 	int i;
  	for(i=0;i<linac->n_cryos;i++) {
- 		linac_state->cryo_state_net[i] = (Cryomodule_State*)calloc(1,sizeof(Cryomodule_State));
+ 		linac_state->cryo_state_net[i] = (Cryomodule_State*)State_Calloc(1,sizeof(Cryomodule_State));
  		Cryomodule_State_Allocate(linac_state->cryo_state_net[i], linac->cryo_net[i]);
  	}
 
@@ -142,6 +142,36 @@ void Linac_State_Deallocate(Linac_State *linac_state, Linac *linac)
 	free(linac_state->cryo_state_net);
 }
 
+/** Helper routine completing a Linac step from the vector sums of its Cryomodules:
+  * calculates amplitude and phase errors and stores the current state in the State struct. */
+static double complex Linac_Step_Finish(Linac *linac, Linac_State *linac_state,
+	double complex linac_V, double complex linac_Kg, double *amp_error, double *phase_error)
+{
+	double complex linac_V_beam=0.0;
+
+	// Project the Linac voltage over the beam (phi radians relative RF phase to the beam),
+	linac_V_beam = linac_V*cos(linac->phi);
+	// Any deviations into the imaginary component of this vector is a phase error
+	*phase_error = carg(linac_V);
+
+	// Now calculate relative amplitude error
+	// - in relative units with respect to the Linac Energy increase,
+	// - eV considered equivalent to V here since we are dealing with Electrons.
+
+	if(linac->dE!=0.0){ // Avoid division by 0
+		*amp_error = (cabs(linac_V_beam)-linac->dE)/linac->dE;
+	} else{
+		*amp_error = cabs(linac_V_beam)-linac->dE;
+	}
+
+	// Store total Linac drive signal (vector sum of all RF Station drive signals)
+	linac_state->linac_Kg = linac_Kg;
+
+	// Total Linac Accelerating voltage (store and return)
+	linac_state->linac_V = linac_V;
+	return linac_V;
+}
+
 /** Step function for Linac:
   * Calculates the state for the next simulation step.
   * Returns vector sum of all Cryomodule accelerating voltages
@@ -157,8 +187,8 @@ double complex Linac_Step(
 	double *phase_error					///< Pointer to RF phase error (output, in radians)
 	)
 {
-	// Overall Linac accelerating voltage (and its projection on the beam)
-	double complex linac_V=0.0, linac_V_beam=0.0;
+	// Overall Linac accelerating voltage
+	double complex linac_V=0.0;
 	double complex linac_Kg=0.0;
 
 	// Run state-space simulation step
@@ -168,27 +198,54 @@ double complex Linac_Step(
 		linac_Kg += linac_state->cryo_state_net[i]->cryo_Kg;
 	}
 
-	// Project the Linac voltage over the beam (phi radians relative RF phase to the beam),
-	linac_V_beam = linac_V*cos(linac->phi);
-	// Any deviations into the imaginary component of this vector is a phase error
-	*phase_error = carg(linac_V);
+	return Linac_Step_Finish(linac, linac_state, linac_V, linac_Kg, amp_error, phase_error);
+}
 
-	// Now calculate relative amplitude error
-	// - in relative units with respect to the Linac Energy increase,
-	// - eV considered equivalent to V here since we are dealing with Electrons.
+/** Completes a Linac step whose Cryomodules have been stepped separately (e.g. by a Sim_Pool):
+  * same as Linac_Step given the Cryomodule accelerating voltages, summed in Cryomodule order. */
+double complex Linac_Step_Reduce(
+	Linac *linac,								///< Pointer to Linac struct
+	Linac_State *linac_state,		///< Pointer to Linac State
+	double complex *cryo_V,			///< Accelerating voltages returned by Cryomodule_Step (of length n_cryos)
+	double *amp_error,					///< Pointer to RF amplitude error (output, relative to overall Linac nominal voltage)
+	double *phase_error					///< Pointer to RF phase error (output, in radians)
+	)
+{
+	double complex linac_V=0.0;
+	double complex linac_Kg=0.0;
 
-	if(linac->dE!=0.0){ // Avoid division by 0
-		*amp_error = (cabs(linac_V_beam)-linac->dE)/linac->dE;
-	} else{
-		*amp_error = cabs(linac_V_beam)-linac->dE;
+	for(int i=0;i<linac->n_cryos;i++){
+		linac_V += cryo_V[i];
+		linac_Kg += linac_state->cryo_state_net[i]->cryo_Kg;
 	}
 
-	// Store total Linac drive signal (vector sum of all RF Station drive signals)
-	linac_state->linac_Kg = linac_Kg;
+	return Linac_Step_Finish(linac, linac_state, linac_V, linac_Kg, amp_error, phase_error);
+}
 
-	// Total Linac Accelerating voltage (store and return)
-	linac_state->linac_V = linac_V;
-	return linac_V;
+/** Set a Linac State to its steady state for constant timing jitter and beam charge
+  * (see Cryomodule_Set_Steady_State), with the amplitude and phase errors of the settled Linac.
+  * Returns 0 on success, or -1 if any Cryomodule has not reached its steady state. */
+int Linac_Set_Steady_State(
+	Linac *linac,								///< Pointer to Linac struct
+	Linac_State *linac_state,		///< Pointer to Linac State
+	double delta_tz,						///< Timing jitter in seconds (RF reference noise)
+	double beam_charge,					///< Beam charge in Coulombs
+	double *amp_error,					///< Pointer to RF amplitude error (output, relative to overall Linac nominal voltage)
+	double *phase_error					///< Pointer to RF phase error (output, in radians)
+	)
+{
+	double complex linac_V=0.0, cryo_V;
+	double complex linac_Kg=0.0;
+	int ret = 0;
+
+	for(int i=0;i<linac->n_cryos;i++){
+		ret |= Cryomodule_Set_Steady_State(linac->cryo_net[i], linac_state->cryo_state_net[i], delta_tz, beam_charge, &cryo_V);
+		linac_V += cryo_V;
+		linac_Kg += linac_state->cryo_state_net[i]->cryo_Kg;
+	}
+
+	Linac_Step_Finish(linac, linac_state, linac_V, linac_Kg, amp_error, phase_error);
+	return ret;
 }
 
 /** Takes a pointer to a Gun struct which has been previously allocated
@@ -49,6 +49,10 @@ void Linac_State_Deallocate(Linac_State * linac_state, Linac *linac);
 
 double complex Linac_Step(Linac *linac, Linac_State *linac_state, double delta_tz, double beam_charge,\
 	double *amp_error, double *phase_error);
+double complex Linac_Step_Reduce(Linac *linac, Linac_State *linac_state, double complex *cryo_V,
+	double *amp_error, double *phase_error);
+int Linac_Set_Steady_State(Linac *linac, Linac_State *linac_state, double delta_tz, double beam_charge,
+	double *amp_error, double *phase_error);
 
 /**
  * Data structure storing the beam parameters on
@@ -9,6 +9,174 @@
 #include "stdlib.h"
 #include "math.h"
 
+// Philox4x32 round multipliers and key increments (Salmon et al., SC'11)
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUNDS 10
+
+// Number of Philox blocks generated at once by Noise_RNG_Fill
+#define NOISE_RNG_CHUNK 256
+
+/** Initialize a counter-based random number stream given a global seed
+  * and the index of the stream (e.g. global RF Station index). */
+void Noise_RNG_Init(
+  Noise_RNG *rng,   ///< Pointer to Noise_RNG struct
+  uint32_t seed,    ///< Global simulation seed
+  uint32_t stream   ///< Stream index
+  )
+{
+  rng->key[0] = seed;
+  rng->key[1] = stream;
+  rng->counter = 0;
+}
+
+/** Generate one block of four 32-bit random words for counter (step, signal, block)
+  * with the Philox4x32-10 bijection. */
+void Noise_RNG_Block(
+  Noise_RNG *rng,     ///< Pointer to Noise_RNG struct
+  uint64_t step,      ///< Simulation step
+  uint32_t signal,    ///< Signal index within the component
+  uint32_t block,     ///< Block index within the signal and step
+  uint32_t out[4]     ///< Random words (output)
+  )
+{
+  uint32_t c0 = (uint32_t) step, c1 = (uint32_t) (step >> 32), c2 = signal, c3 = block;
+  uint32_t k0 = rng->key[0], k1 = rng->key[1];
+  uint64_t p0, p1;
+  int r;
+
+  for(r=0; r<PHILOX_ROUNDS; r++) {
+    p0 = (uint64_t) PHILOX_M0 * c0;
+    p1 = (uint64_t) PHILOX_M1 * c2;
+    c0 = (uint32_t) (p1 >> 32) ^ c1 ^ k0;
+    c1 = (uint32_t) p1;
+    c2 = (uint32_t) (p0 >> 32) ^ c3 ^ k1;
+    c3 = (uint32_t) p0;
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+/** Generate n standard normal random numbers for counter (step, signal)
+  * (Box-Muller transform on Philox output: each block yields four values). */
+void Noise_RNG_Normals(
+  Noise_RNG *rng,     ///< Pointer to Noise_RNG struct
+  uint64_t step,      ///< Simulation step
+  uint32_t signal,    ///< Signal index within the component
+  int n,              ///< Number of random numbers
+  double *out         ///< Array of n random numbers (output)
+  )
+{
+  uint32_t words[4];
+  double u1, u2, r, theta;
+  int i, k;
+
+  for(i=0; i<n; i+=4) {
+    Noise_RNG_Block(rng, step, signal, (uint32_t) (i/4), words);
+    for(k=0; k<4 && i+k<n; k+=2) {
+      // Uniforms in (0,1) (never 0, so that the logarithm is finite)
+      u1 = ((double) words[k] + 0.5)*(1.0/4294967296.0);
+      u2 = ((double) words[k+1] + 0.5)*(1.0/4294967296.0);
+      r = sqrt(-2.0*log(u1));
+      theta = 2.0*M_PI*u2;
+      out[i+k] = r*cos(theta);
+      if(i+k+1 < n) out[i+k+1] = r*sin(theta);
+    }
+  }
+}
+
+/** Philox4x32-10 kernel over arrays of counters (same key for all of them):
+  * arrays are passed as restrict-qualified arguments so that the compiler can vectorize the loop over blocks.
+  * Counters are overwritten with the random words. */
+static void Noise_Philox_Kernel(
+  int n, uint32_t key0, uint32_t key1,
+  uint32_t * restrict c0, uint32_t * restrict c1,
+  uint32_t * restrict c2, uint32_t * restrict c3
+  )
+{
+  int i, r;
+  for(i=0; i<n; i++) {
+    uint32_t x0 = c0[i], x1 = c1[i], x2 = c2[i], x3 = c3[i];
+    uint32_t k0 = key0, k1 = key1;
+    for(r=0; r<PHILOX_ROUNDS; r++) {
+      uint64_t p0 = (uint64_t) PHILOX_M0 * x0;
+      uint64_t p1 = (uint64_t) PHILOX_M1 * x2;
+      x0 = (uint32_t) (p1 >> 32) ^ x1 ^ k0;
+      x1 = (uint32_t) p1;
+      x2 = (uint32_t) (p0 >> 32) ^ x3 ^ k1;
+      x3 = (uint32_t) p0;
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+    c0[i] = x0;
+    c1[i] = x1;
+    c2[i] = x2;
+    c3[i] = x3;
+  }
+}
+
+/** Bulk version of Noise_RNG_Normals: generates n standard normal random numbers
+  * for counters (step0+k, signal), k = 0..n_steps-1, and stores them in out[k*n+j].
+  * Results are identical to calling Noise_RNG_Normals once per step, but blocks are
+  * generated in chunks by a vectorizable kernel, followed by the Box-Muller transform. */
+void Noise_RNG_Fill(
+  Noise_RNG *rng,     ///< Pointer to Noise_RNG struct
+  uint64_t step0,     ///< First simulation step
+  int n_steps,        ///< Number of simulation steps
+  uint32_t signal,    ///< Signal index within the component
+  int n,              ///< Number of random numbers per step
+  double *out         ///< Array of n_steps*n random numbers (output)
+  )
+{
+  uint32_t c0[NOISE_RNG_CHUNK], c1[NOISE_RNG_CHUNK], c2[NOISE_RNG_CHUNK], c3[NOISE_RNG_CHUNK];
+  uint32_t words[4];
+  int blocks = (n+3)/4;   // Blocks per step
+  int total = n_steps*blocks;
+  int start, nb, i, j, k;
+  double u1, u2, r, theta;
+
+  for(start=0; start<total; start+=NOISE_RNG_CHUNK) {
+    nb = (total-start < NOISE_RNG_CHUNK) ? total-start : NOISE_RNG_CHUNK;
+
+    // Counters of this chunk of blocks
+    for(i=0; i<nb; i++) {
+      uint64_t step = step0 + (uint64_t) ((start+i)/blocks);
+      c0[i] = (uint32_t) step;
+      c1[i] = (uint32_t) (step >> 32);
+      c2[i] = signal;
+      c3[i] = (uint32_t) ((start+i)%blocks);
+    }
+
+    Noise_Philox_Kernel(nb, rng->key[0], rng->key[1], c0, c1, c2, c3);
+
+    // Box-Muller transform (same as Noise_RNG_Normals)
+    for(i=0; i<nb; i++) {
+      words[0] = c0[i];
+      words[1] = c1[i];
+      words[2] = c2[i];
+      words[3] = c3[i];
+      // Position of this block's first random number in the output
+      j = 4*((start+i)%blocks);
+      double *o = out + (size_t) ((start+i)/blocks)*n;
+      for(k=0; k<4 && j+k<n; k+=2) {
+        u1 = ((double) words[k] + 0.5)*(1.0/4294967296.0);
+        u2 = ((double) words[k+1] + 0.5)*(1.0/4294967296.0);
+        r = sqrt(-2.0*log(u1));
+        theta = 2.0*M_PI*u2;
+        o[j+k] = r*cos(theta);
+        if(j+k+1 < n) o[j+k+1] = r*sin(theta);
+      }
+    }
+  }
+}
+
 /** Step function for Noise:
   * Calculates the Noise value for next simulation step.
   * It can be configured to generate several types of noise. */
@@ -17,13 +185,18 @@ void Noise_Step(
   double Tstep,       ///< Simulation time step in seconds
   int type,           ///< 1 (White Noise), 2 (Sine Wave), 3 (Chirp), 4 (Step), 0 (do nothing)
   double *settings,   ///< Pointer to noise settings (different meaning according to type of noise)
+  Noise_RNG *rng,     ///< Random number stream (White Noise)
+  int signal,         ///< Index of the noise source within the stream
   double *val         ///< Pointer to current generated noise value (output)
   )
 {
+  double normal;
+
   switch(type) {
   case 1:
     /* White Noise */
-    *val = randn(0.0, settings[0]);
+    Noise_RNG_Normals(rng, (uint64_t) t_now, (uint32_t) signal, 1, &normal);
+    *val = settings[0]*normal;
     break;
   case 2:
     /* Sine Wave */
@@ -46,6 +219,7 @@ void Noise_Step(
 
 /** Gaussian distribution pseudo-random number generator.
   * Returns noise value provided Mean and Standard Deviation.
+  * Uses rand() and hidden state: the simulation itself draws from Noise_RNG streams.
   * Credit: http://phoxis.org/2013/05/04/generating-random-numbers-from-normal-distribution-in-c/ */
 double randn(
   double mu,    ///< Mean
@@ -7,7 +7,25 @@
 #ifndef NOISE_H
 #define NOISE_H
 
-void Noise_Step(int t_now, double Tstep, int type, double *settings, double *val);
+#include <stdint.h>
+
+/**
+ * Counter-based random number stream (Philox4x32-10).
+ * Random numbers are a pure function of (seed, stream, step, signal):
+ * each component owning a stream (RF Stations, correlated noise sources)
+ * generates the same sequence regardless of the order in which components are stepped.
+ */
+typedef struct str_noise_rng {
+  uint32_t key[2];    ///< Philox key: seed and stream index
+  uint64_t counter;   ///< Current step of the stream (for components that do not track time)
+} Noise_RNG;
+
+void Noise_RNG_Init(Noise_RNG *rng, uint32_t seed, uint32_t stream);
+void Noise_RNG_Block(Noise_RNG *rng, uint64_t step, uint32_t signal, uint32_t block, uint32_t out[4]);
+void Noise_RNG_Normals(Noise_RNG *rng, uint64_t step, uint32_t signal, int n, double *out);
+void Noise_RNG_Fill(Noise_RNG *rng, uint64_t step0, int n_steps, uint32_t signal, int n, double *out);
+
+void Noise_Step(int t_now, double Tstep, int type, double *settings, Noise_RNG *rng, int signal, double *val);
 double randn(double mu, double sigma);
 
 #endif
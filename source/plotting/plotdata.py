@@ -6,10 +6,65 @@
 # import matplotlib as mtp
 # mtp.use('Agg')
 
+import os
+import struct
 import sys
 import numpy as np
 # import matplotlib.pyplot as plt
 
+## First 8 bytes of a binary Simulation output file (see Write_Sim_Header in simulation_top.c)
+BINARY_MAGIC = 'LLRFSIM1'
+
+def Read_Binary_Header(datafile):
+    """Read_Binary_Header: Parse the header of a binary Simulation output file.
+    Inputs:
+        datafile: Simulation output file name.
+    Output:
+        (header_size, names): Header size in bytes and list of column names,
+        or None if datafile is not a binary output file (i.e. it is text)."""
+
+    with open(datafile, 'rb') as f:
+        head = f.read(32)
+        if len(head) < 32 or head[:8] != BINARY_MAGIC:
+            return None
+        header_size, n_cols = struct.unpack('<2I', head[8:16])
+        names = f.read(header_size - 32).rstrip('\0').split('\n')[:n_cols]
+
+    return header_size, names
+
+def Load_Binary_Data(datafile):
+    """Load_Binary_Data: Memory-map a binary Simulation output file (no parsing, data is read on access).
+    Inputs:
+        datafile: Simulation output file name.
+    Output:
+        (names, data): List of column names and read-only array of shape (rows, columns)."""
+
+    header_size, names = Read_Binary_Header(datafile)
+    n_rows = (os.path.getsize(datafile) - header_size)//(8*len(names))
+    data = np.memmap(datafile, dtype='<f8', mode='r', offset=header_size, shape=(n_rows, len(names)))
+
+    return names, data
+
+def Load_Columns(datafile, usecols, dtype=np.double, skiprows=0):
+    """Load_Columns: Load columns of a Simulation output file, text or binary (detected from its header).
+    Inputs:
+        datafile: Simulation output file name,
+        usecols: Tuple of column indices (see Get_Column_Idx),
+        dtype: Data type of the result,
+        skiprows: Number of rows to skip at the beginning of the file.
+    Output:
+        Array of shape (rows, len(usecols)), or (rows,) for a single column."""
+
+    if Read_Binary_Header(datafile) is None:
+        return np.loadtxt(datafile, dtype=dtype, usecols=usecols, skiprows=skiprows)
+
+    names, data = Load_Binary_Data(datafile)
+    cols = data[skiprows:, list(usecols)].astype(dtype)
+    if len(usecols) == 1:
+        cols = cols[:, 0]
+
+    return cols
+
 def PlotData(plotcfgfile, columnscfgfile, XWindows=False):
     """ PlotData: Plot data given a configuration file specifying plot properties
     and a file describing the format of the data."""
@@ -62,7 +117,7 @@ def PlotData(plotcfgfile, columnscfgfile, XWindows=False):
             out_col = Get_Column_Idx(plotcont["output"], columnsdict, linac_connect)
 
             # Load data
-            data = np.loadtxt(datafile, dtype=np.double, usecols=(in_col, out_col))
+            data = Load_Columns(datafile, (in_col, out_col))
 
             # Data vectors
             indata = data[:, 0]  # Input
@@ -227,7 +282,7 @@ def Versus_Plot(datafile, plotcont, columndict, linac_connect=None, XWindows=Fal
             xlabelis = plotcont.get('xlabel', "{0} [{1}]".format(x_name, x_units))
 
         usecols = (x_col, y_col)
-        data = np.loadtxt(datafile, dtype=np.double, usecols=usecols, skiprows=skiprows)
+        data = Load_Columns(datafile, usecols, skiprows=skiprows)
         x = data[:, 0]
         y = data[:, 1]
 
@@ -247,7 +302,7 @@ def Versus_Plot(datafile, plotcont, columndict, linac_connect=None, XWindows=Fal
         x_name = "Index"
 
         usecols = (y_col,)
-        y = np.loadtxt(datafile, dtype=np.complex, usecols=usecols, skiprows=skiprows)
+        y = Load_Columns(datafile, usecols, dtype=np.complex, skiprows=skiprows)
         x = np.arange(0, y.size)
 
     xtoplot = x*scale_x
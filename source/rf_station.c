@@ -9,6 +9,7 @@
 #include "rf_station.h"
 
 #include <math.h>
+#include <string.h>
 
 /** Allocates memory for an array of RF Stations.
   * RF Stations themselves need to be allocated and filled individually,
@@ -30,7 +31,7 @@ void RF_Station_Append(RF_Station** rf_station_arr, RF_Station* rf_station, int
 void Delay_State_Allocate(Delay *delay, Delay_State *delay_state)
 {
   // Allocate memory buffer
-  delay_state -> buffer = (double complex*) calloc(delay->size,sizeof(double complex));
+  delay_state -> buffer = (double complex*) State_Calloc(delay->size,sizeof(double complex));
   // Initialize buffer
   for(int i=0 ; i<delay->size; i++){
     delay_state -> buffer[delay_state->index] = (double complex) 0.0;
@@ -113,6 +114,12 @@ void Delay_Clear(Delay *delay, Delay_State *delay_state){
   rf_station->PAscale = PAscale;
   rf_station->PAmax = PAmax;
 
+  // SSA saturation (exact formula by default, the table is built by RF_Station_Set_Saturation)
+  rf_station->sat_mode = SAT_EXACT;
+  rf_station->sat_table.n = 0;
+  rf_station->sat_table.g = NULL;
+  rf_station->sat_table.dg = NULL;
+
   /*
   * Configure the Filters using their poles
   */
@@ -201,6 +208,19 @@ RF_Station * RF_Station_Allocate_New(
   return rf_station;
 }
 
+/** Select the discretization method (FILTER_TUSTIN or FILTER_ZOH) of the RF Station's filters:
+  * SSA, noise-shaping filter and the Electrical modes of its Cavity (see Filter_Set_Discretization).
+  * Call before allocating the RF Station's States. */
+void RF_Station_Set_Discretization(
+  RF_Station *rf_station,   ///< Pointer to RF Station
+  int method                ///< Discretization method
+  )
+{
+  Filter_Set_Discretization(&rf_station->SSA_fil, method, rf_station->fpga.Tstep);
+  Filter_Set_Discretization(&rf_station->noise_shape_fil, method, rf_station->fpga.Tstep);
+  Cavity_Set_Discretization(rf_station->cav, method);
+}
+
 /** Frees memory of an RF Station struct. */
 void RF_Station_Deallocate(RF_Station *rf_station)
 {
@@ -211,6 +231,7 @@ void RF_Station_Deallocate(RF_Station *rf_station)
   FPGA_Deallocate(&rf_station->fpga);
   Cavity_Deallocate(rf_station->cav);
   Delay_Deallocate(&rf_station->loop_delay);
+  Sat_Table_Deallocate(&rf_station->sat_table);
 
   rf_station->nom_grad = 0.0;
   rf_station->Clip = 0.0;
@@ -234,6 +255,12 @@ void RF_State_Allocate(RF_State *rf_state, RF_Station *rf_station){
   rf_state->fpga_state.openloop = (int) 0;
 
   Delay_State_Allocate(&rf_station->loop_delay, &rf_state->loop_delay_state);
+
+  // Default LLRF noise stream (Sim_State_Allocate assigns one per RF Station)
+  Noise_RNG_Init(&rf_state->rng, 0, 0);
+  // LLRF noise buffer is filled on first use
+  rf_state->llrf_ns_buf = (double *)State_Calloc(6*LLRF_NOISE_BUF, sizeof(double));
+  rf_state->llrf_ns_index = LLRF_NOISE_BUF;
 }
 
 /** Frees memory of RF Station State struct. */
@@ -241,6 +268,7 @@ void RF_State_Deallocate(RF_State *rf_state, RF_Station *rf_station) {
   Filter_State_Deallocate(&rf_state->noise_shape_fil);
   Filter_State_Deallocate(&rf_state->SSA_fil);
   Cavity_State_Deallocate(&rf_state->cav_state, rf_station->cav);
+  free(rf_state->llrf_ns_buf);
 }
 
 /** Apply a phase shift of theta radians to complex signal in*/
@@ -341,6 +369,155 @@ double complex Saturate(
   return in*cpow(1.0+cpow(cabs(in),harshness), -1.0/harshness);
 }
 
+/** Interpolate the saturation gain at input magnitude r from the table (dr <= r < r_max). */
+static inline double Sat_Table_Gain(const double * restrict g, const double * restrict dg, double inv_dr, double r)
+{
+  double x = r*inv_dr;
+  int i = (int) x;
+  double t = x - i;
+  double t2 = t*t, t3 = t2*t;
+
+  // Cubic Hermite basis
+  return (2.0*t3 - 3.0*t2 + 1.0)*g[i] + (t3 - 2.0*t2 + t)*dg[i]
+    + (3.0*t2 - 2.0*t3)*g[i+1] + (t3 - t2)*dg[i+1];
+}
+
+/** Fill in a saturation table for the given harshness parameter:
+  * gain g(r) = (1+r^c)^(-1/c) and its derivative g'(r) = -r^(c-1)*(1+r^c)^(-1/c-1) on n+1 grid points over [0, r_max].
+  * r^c is not smooth at the origin for non-integer c: the exact formula is kept for the first intervals,
+  * up to the first one interpolated within SAT_TABLE_TOL (r_min). */
+void Sat_Table_Allocate_In(
+  Sat_Table *tab,       ///< Pointer to Sat_Table struct
+  double harshness,     ///< Saturation harshness parameter
+  int n,                ///< Number of table intervals
+  double r_max          ///< Input magnitude covered by the table
+  )
+{
+  int i, k;
+  double r, dr = r_max/n;
+
+  tab->harshness = harshness;
+  tab->n = n;
+  tab->r_max = r_max;
+  tab->inv_dr = n/r_max;
+  tab->g = (double *)calloc(n+1, sizeof(double));
+  tab->dg = (double *)calloc(n+1, sizeof(double));
+
+  for(i=0; i<=n; i++) {
+    r = i*dr;
+    tab->g[i] = pow(1.0+pow(r,harshness), -1.0/harshness);
+    tab->dg[i] = -dr*pow(r,harshness-1.0)*pow(1.0+pow(r,harshness), -1.0/harshness-1.0);
+  }
+  // The derivative is unbounded at the origin for harshness < 1 (the first interval is never interpolated)
+  if(harshness < 1.0) tab->dg[0] = 0.0;
+
+  // The interpolation error decreases away from the origin: first interval within tolerance
+  tab->r_min = r_max;
+  for(i=1; i<n; i++) {
+    double err = 0.0;
+    for(k=1; k<SAT_TABLE_CHECKS; k++) {
+      r = (i + (double) k/SAT_TABLE_CHECKS)*dr;
+      double exact = pow(1.0+pow(r,harshness), -1.0/harshness);
+      err = fmax(err, fabs(Sat_Table_Gain(tab->g, tab->dg, tab->inv_dr, r) - exact)/exact);
+    }
+    if(err < SAT_TABLE_TOL) {
+      tab->r_min = i*dr;
+      break;
+    }
+  }
+}
+
+/** Frees memory of a Sat_Table struct. */
+void Sat_Table_Deallocate(Sat_Table *tab)
+{
+  free(tab->g);
+  free(tab->dg);
+  tab->g = NULL;
+  tab->dg = NULL;
+  tab->n = 0;
+}
+
+/** Select the SSA saturation mode of an RF Station (SAT_EXACT or SAT_TABLE).
+  * The saturation table is only built (once) when SAT_TABLE is first selected. */
+void RF_Station_Set_Saturation(
+  RF_Station *rf_station, ///< Pointer to RF Station
+  int sat_mode            ///< SSA saturation mode
+  )
+{
+  if(sat_mode == SAT_TABLE && rf_station->sat_table.n == 0)
+    Sat_Table_Allocate_In(&rf_station->sat_table, rf_station->Clip, SAT_TABLE_SIZE, SAT_TABLE_RMAX);
+  rf_station->sat_mode = sat_mode;
+}
+
+/** Implement Saturation of input signal for SSA using the saturation table
+  * (same as Saturate with the table's harshness parameter).
+  * The exact formula is used beyond the table and below r_min,
+  * where r^c is not smooth for non-integer c. */
+double complex Saturate_Table(
+  Sat_Table *tab,       ///< Pointer to saturation table
+  double complex in     ///< Input (complex) signal
+  )
+{
+  double r = sqrt(creal(in)*creal(in) + cimag(in)*cimag(in));
+
+  if(r >= tab->r_max || r < tab->r_min) return in*pow(1.0+pow(r,tab->harshness), -1.0/tab->harshness);
+  return in*Sat_Table_Gain(tab->g, tab->dg, tab->inv_dr, r);
+}
+
+/** Saturation of n input signals sharing the same saturation table (e.g. the SSAs of several RF Stations with the same harshness),
+  * with the same result as Saturate_Table on each of them. The table lookups are done in a single loop over
+  * the magnitudes the compiler can vectorize; inputs outside the interpolated range are then fixed up with the exact formula.
+  * in and out must not overlap. */
+void Saturate_Table_Block(
+  Sat_Table *tab,                     ///< Pointer to saturation table
+  const double complex * restrict in, ///< Array of n input signals
+  double complex * restrict out,      ///< Array of n output signals
+  int n                               ///< Number of signals
+  )
+{
+  int k;
+  const double * restrict x = (const double *) in;
+  double * restrict y = (double *) out;
+  const double * restrict g = tab->g;
+  const double * restrict dg = tab->dg;
+  double inv_dr = tab->inv_dr, r_hi = tab->r_max*(1.0-1e-15), r_lo = fmin(tab->r_min, r_hi);
+
+  for(k=0; k<n; k++) {
+    double re = x[2*k], im = x[2*k+1];
+    double r = sqrt(re*re + im*im);
+    // Clamp to the interpolated range (fixed up below)
+    double gain = Sat_Table_Gain(g, dg, inv_dr, r < r_lo ? r_lo : (r < r_hi ? r : r_hi));
+    y[2*k] = re*gain;
+    y[2*k+1] = im*gain;
+  }
+
+  // Inputs outside the interpolated range
+  for(k=0; k<n; k++) {
+    double re = x[2*k], im = x[2*k+1];
+    double r = sqrt(re*re + im*im);
+    if(r >= tab->r_max || r < tab->r_min) out[k] = Saturate_Table(tab, in[k]);
+  }
+}
+
+/** Maximum relative error of the saturation table against the exact formula (Saturate),
+  * sampled at n_test input magnitudes over the table's range. */
+double Sat_Table_Max_Error(
+  Sat_Table *tab,   ///< Pointer to saturation table
+  int n_test        ///< Number of input magnitudes to test
+  )
+{
+  int i;
+  double r, exact, err, max_err = 0.0;
+
+  for(i=1; i<=n_test; i++) {
+    r = i*tab->r_max/(n_test+1);
+    exact = creal(Saturate(r, tab->harshness));
+    err = fabs(creal(Saturate_Table(tab, r)) - exact)/exact;
+    if(err > max_err) max_err = err;
+  }
+  return max_err;
+}
+
 /** Step function for Solid-State Amplifier: Saturation and band limit.
   * Calculates the state for the next simulation step.
   * Returns the error signal and stores current state in State struct. */
@@ -357,7 +534,8 @@ double complex SSA_Step(
   // Apply low-pass filter to limit bandwidth (SSA_fil)
   fil_out = Filter_Step(&rf_station->SSA_fil, drive_in, &rf_state->SSA_fil);
   // Clip
-  satout = Saturate(fil_out,rf_station->Clip);
+  if(rf_station->sat_mode == SAT_TABLE) satout = Saturate_Table(&rf_station->sat_table, fil_out);
+  else satout = Saturate(fil_out,rf_station->Clip);
   // Scale output signal (sqrt(W) -> Normalized units)
   satout = satout*rf_station->PAscale;
   
@@ -375,9 +553,19 @@ void SSA_Clear(RF_Station *rf_station, RF_State * rf_state)
   * and considered Gaussian, where 1/f noise is ignored (see Physics documentation) */
 void Apply_LLRF_Noise(RF_Station *rf_station, RF_State *rf_state)
 {
-  rf_state->probe_ns = randn(0.0, rf_station->probe_ns_rms) + _Complex_I*randn(0.0, rf_station->probe_ns_rms);
-  rf_state->rev_ns = randn(0.0, rf_station->rev_ns_rms) + _Complex_I*randn(0.0, rf_station->rev_ns_rms);
-  rf_state->fwd_ns = randn(0.0, rf_station->fwd_ns_rms) + _Complex_I*randn(0.0, rf_station->fwd_ns_rms);
+  // Refill the noise buffer with the next LLRF_NOISE_BUF steps of the RF State's stream
+  if(rf_state->llrf_ns_index >= LLRF_NOISE_BUF) {
+    Noise_RNG_Fill(&rf_state->rng, rf_state->rng.counter, LLRF_NOISE_BUF, 0, 6, rf_state->llrf_ns_buf);
+    rf_state->rng.counter += LLRF_NOISE_BUF;
+    rf_state->llrf_ns_index = 0;
+  }
+
+  // Six Gaussian numbers (real and imaginary parts of each port) for this step
+  double *ns = rf_state->llrf_ns_buf + 6*rf_state->llrf_ns_index++;
+
+  rf_state->probe_ns = rf_station->probe_ns_rms*ns[0] + _Complex_I*rf_station->probe_ns_rms*ns[1];
+  rf_state->rev_ns = rf_station->rev_ns_rms*ns[2] + _Complex_I*rf_station->rev_ns_rms*ns[3];
+  rf_state->fwd_ns = rf_station->fwd_ns_rms*ns[4] + _Complex_I*rf_station->fwd_ns_rms*ns[5];
 }
 
 /** Step function for RF Station:
@@ -429,6 +617,259 @@ double complex RF_Station_Step(
   return V_acc;
 }
 
+/** Helper routine consuming n steps of the LLRF noise stream of an RF State without applying them:
+  * same stream position as n calls to Apply_LLRF_Noise (whole buffers are skipped without being generated). */
+static void Skip_LLRF_Noise(RF_State *rf_state, int n)
+{
+  int k;
+
+  while(n > 0) {
+    if(rf_state->llrf_ns_index >= LLRF_NOISE_BUF) {
+      if(n >= LLRF_NOISE_BUF) {
+        rf_state->rng.counter += LLRF_NOISE_BUF;
+        n -= LLRF_NOISE_BUF;
+        continue;
+      }
+      Noise_RNG_Fill(&rf_state->rng, rf_state->rng.counter, LLRF_NOISE_BUF, 0, 6, rf_state->llrf_ns_buf);
+      rf_state->rng.counter += LLRF_NOISE_BUF;
+      rf_state->llrf_ns_index = 0;
+    }
+    k = LLRF_NOISE_BUF - rf_state->llrf_ns_index;
+    if(k > n) k = n;
+    rf_state->llrf_ns_index += k;
+    n -= k;
+  }
+}
+
+/** Helper routine advancing an RF Station in open loop, with no LLRF noise, by n steps of constant inputs
+  * once its SSA filter has settled (see Filter_Settle_Steps): the SSA output is then the saturation
+  * of the constant drive, the SSA filter State jumps to the last step (see Filter_Fast_Forward)
+  * and the Cavity is advanced in closed form (see Cavity_Fast_Forward). The probe signal still goes through
+  * the loop delay and noise-shaping filter every step, so that the RF State follows regular stepping.
+  * Recorded signals as in RF_Station_Step_Block (any may be NULL).
+  * Returns 0, or -1 (RF State untouched) if the filters are not single-pole. */
+static int RF_Station_Fast_Forward(RF_Station *rf_station, int n,
+  double delta_tz, double complex beam_current, double complex feed_forward,
+  double complex *V, double complex *E_probe, double complex *E_reverse, double complex *E_fwd, double complex *Kg,
+  double *delta_omega, RF_State *rf_state)
+{
+  int i, k, m;
+  Cavity *cav = rf_station->cav;
+  double complex drive_in, Kg_ss, fil_out, probe_prev, probe[RF_FF_CHUNK];
+
+  if(!cav->packed) return -1;
+
+  // SSA: settled filter output (unity DC gain) through the saturation
+  drive_in = (rf_station->fpga.set_point + feed_forward)/rf_station->PAscale;
+  if(Filter_Fast_Forward(&rf_station->SSA_fil, &rf_state->SSA_fil, drive_in, 1.0, n, &fil_out) != 0) return -1;
+  if(rf_station->sat_mode == SAT_TABLE) Kg_ss = Saturate_Table(&rf_station->sat_table, drive_in);
+  else Kg_ss = Saturate(drive_in, rf_station->Clip);
+  Kg_ss = Kg_ss*rf_station->PAscale;
+
+  // FPGA (open loop) and LLRF noise (zero)
+  rf_state->fpga_state.drive = rf_station->fpga.set_point;
+  rf_state->fpga_state.state = rf_station->fpga.set_point;
+  Skip_LLRF_Noise(rf_state, n);
+  rf_state->probe_ns = 0.0;
+  rf_state->rev_ns = 0.0;
+  rf_state->fwd_ns = 0.0;
+
+  for(i=0;i<n;i+=m) {
+    m = (n-i < RF_FF_CHUNK) ? n-i : RF_FF_CHUNK;
+
+    // Cavity
+    probe_prev = rf_state->cav_state.E_probe;
+    Cavity_Fast_Forward(cav, m, delta_tz, Kg_ss, beam_current,
+      V ? V+i : NULL, probe, E_reverse ? E_reverse+i : NULL, &rf_state->cav_state);
+    if(E_probe) memcpy(E_probe+i, probe, m*sizeof(double complex));
+
+    // Probe signal of the previous step through the loop delay and noise-shaping filter
+    for(k=0;k<m;k++) {
+      Filter_Step(&rf_station->noise_shape_fil,
+        Delay_Step(k > 0 ? probe[k-1] : probe_prev, &rf_station->loop_delay, &rf_state->loop_delay_state),
+        &rf_state->noise_shape_fil);
+    }
+  }
+
+  rf_state->cav_state.E_fwd = Kg_ss;
+  for(i=0;i<n;i++) {
+    if(E_fwd) E_fwd[i] = Kg_ss;
+    if(Kg) Kg[i] = Kg_ss;
+    if(delta_omega) delta_omega[i] = rf_state->cav_state.elecMode_state_net[cav->fund_index]->delta_omega;
+  }
+
+  return 0;
+}
+
+/** Block step function for RF Station:
+  * Calls RF_Station_Step once per sample over n samples of input waveforms,
+  * and records the chosen RF Station signals after every step.
+  * Any input waveform may be NULL (zero input), and any output waveform may be NULL (not recorded).
+  * With the Cavity's fast-forward enabled (see Cavity_Set_Fast_Forward), an RF Station in open loop
+  * with no LLRF noise advances long enough intervals of constant inputs (timing jitter, beam current, feed-forward)
+  * in closed form (see RF_Station_Fast_Forward), once the transient of the SSA filter through the saturation
+  * has been stepped as usual (see RF_FF_SSA_TOL). Results match regular stepping to within rounding errors. */
+void RF_Station_Step_Block(
+  RF_Station *rf_station,         ///< Pointer to RF Station
+  int n,                          ///< Number of simulation steps
+  // Input waveforms (length n)
+  double *delta_tz,               ///< Timing jitter in seconds (RF reference noise)
+  double complex *beam_current,   ///< Beam current in Amps
+  double complex *feed_forward,   ///< Feed-forward signal
+  // Output waveforms (length n)
+  double complex *V,              ///< Overall cavity accelerating voltage
+  double complex *E_probe,        ///< Cavity field probe signal
+  double complex *E_reverse,      ///< Reverse signal
+  double complex *E_fwd,          ///< Digitized forward signal
+  double complex *Kg,             ///< SSA output (cavity drive) in sqrt(W)
+  double *delta_omega,            ///< Fundamental mode's frequency perturbation in rad/s
+  RF_State *rf_state              ///< Pointer to RF State
+  )
+{
+  int i, j, run, settle, hold = 0;
+  double complex V_now, feed_now;
+  Cavity *cav = rf_station->cav;
+
+  // Linear, deterministic chain from the feed-forward to the Cavity (but for the saturation)
+  int quiescent = cav->fast_forward > 0 && rf_state->fpga_state.openloop == 1
+    && rf_station->probe_ns_rms == 0.0 && rf_station->rev_ns_rms == 0.0 && rf_station->fwd_ns_rms == 0.0;
+
+  for(i=0;i<n;i++) {
+    // Constant-input interval starting at step i: stepped until the SSA filter has settled, then fast-forwarded
+    if(quiescent && i >= hold) {
+      for(j=i+1;j<n;j++) {
+        if(delta_tz && delta_tz[j] != delta_tz[i]) break;
+        if(beam_current && beam_current[j] != beam_current[i]) break;
+        if(feed_forward && feed_forward[j] != feed_forward[i]) break;
+      }
+      run = j-i;
+      feed_now = feed_forward ? feed_forward[i] : 0.0;
+      settle = Filter_Settle_Steps(&rf_station->SSA_fil, &rf_state->SSA_fil,
+        (rf_station->fpga.set_point + feed_now)/rf_station->PAscale, RF_FF_SSA_TOL);
+
+      if(settle == 0 && run >= cav->fast_forward && RF_Station_Fast_Forward(rf_station, run,
+        delta_tz ? delta_tz[i] : 0.0, beam_current ? beam_current[i] : 0.0, feed_now,
+        V ? V+i : NULL, E_probe ? E_probe+i : NULL, E_reverse ? E_reverse+i : NULL, E_fwd ? E_fwd+i : NULL,
+        Kg ? Kg+i : NULL, delta_omega ? delta_omega+i : NULL, rf_state) == 0) {
+        i += run-1;
+        continue;
+      }
+      // Regular steps through the SSA transient (or to the end of the interval)
+      hold = (settle > 0 && settle < run) ? i+settle : i+run;
+    }
+
+    V_now = RF_Station_Step(rf_station,
+      delta_tz ? delta_tz[i] : 0.0,
+      beam_current ? beam_current[i] : 0.0,
+      feed_forward ? feed_forward[i] : 0.0,
+      rf_state);
+
+    if(V) V[i] = V_now;
+    if(E_probe) E_probe[i] = rf_state->cav_state.E_probe;
+    if(E_reverse) E_reverse[i] = rf_state->cav_state.E_reverse;
+    if(E_fwd) E_fwd[i] = rf_state->cav_state.E_fwd;
+    if(Kg) Kg[i] = rf_state->cav_state.Kg;
+    if(delta_omega) delta_omega[i] = rf_state->cav_state.elecMode_state_net[cav->fund_index]->delta_omega;
+  }
+}
+
+/** SSA input (drive, in the same units as the SSA output) delivering output Kg in steady state:
+  * inverse of the saturation (exact formula, refined against the table in SAT_TABLE mode).
+  * Returns 0 on success, or -1 if Kg is beyond the SSA's reach
+  * (the input magnitude is then set to SAT_TABLE_RMAX*PAscale, with the phase of Kg). */
+static int SSA_Steady_Input(RF_Station *rf_station, double complex Kg, double complex *drive)
+{
+  double complex y = Kg/rf_station->PAscale;
+  double r_y = cabs(y), c = rf_station->Clip, r_x;
+  int ret = 0;
+
+  if(r_y == 0.0) {
+    *drive = 0.0;
+    return 0;
+  }
+
+  // |Saturate(x)|^c = |x|^c/(1+|x|^c) < 1
+  double y_c = pow(r_y, c);
+  if(y_c >= 1.0) {
+    r_x = SAT_TABLE_RMAX;
+    ret = -1;
+  } else {
+    r_x = r_y*pow(1.0 - y_c, -1.0/c);
+  }
+
+  // The saturation table differs slightly from the exact formula: a few fixed-point iterations on the magnitude
+  if(ret == 0 && rf_station->sat_mode == SAT_TABLE) {
+    for(int i=0;i<4;i++) r_x *= r_y/cabs(Saturate_Table(&rf_station->sat_table, r_x));
+  }
+
+  *drive = r_x*(y/r_y)*rf_station->PAscale;
+  return ret;
+}
+
+/** Set an RF Station State to the steady state of its closed feedback loop (operating point),
+  * for constant timing jitter, beam current and feed-forward, at the current frequency offsets of
+  * the cavity's Electrical modes (see Cryomodule_Set_Steady_State for Lorentz-force detuning):
+  * the FPGA integrator holds the drive for which the (delayed, filtered) probe signal meets the set-point,
+  * through the SSA (filter and saturation) and the cavity modes. The loop delay buffer, noise-shaping
+  * and SSA filters, FPGA and cavity States are written accordingly (LLRF noise is left out).
+  * In open loop (fpga_state.openloop), the FPGA drives the set-point.
+  * Returns 0 on success, or -1 if the operating point is beyond the SSA or FPGA limits
+  * (the drive is then clipped, and the State is the cavity's steady state for the clipped drive). */
+int RF_Station_Set_Steady_State(
+  RF_Station *rf_station,         ///< Pointer to RF Station
+  double delta_tz,                ///< Timing jitter in seconds (RF reference noise)
+  double complex beam_current,    ///< Beam current in Amps
+  double complex feed_forward,    ///< Feed-forward signal
+  RF_State *rf_state              ///< Pointer to RF State
+  )
+{
+  FPGA *fpga = &rf_station->fpga;
+  FPGA_State *fpga_state = &rf_state->fpga_state;
+  Cavity_State *cav_state = &rf_state->cav_state;
+  double complex drive, Kg, E_probe_lp;
+  int ret = 0;
+
+  if(fpga_state->openloop == 1) {
+    drive = fpga->set_point;
+  } else {
+    // The cavity probe signal is linear in the cavity drive (Kg): solve for the set-point
+    double complex probe_0 = Cavity_Steady_Probe(rf_station->cav, delta_tz, 0.0, beam_current, cav_state);
+    double complex probe_1 = Cavity_Steady_Probe(rf_station->cav, delta_tz, 1.0, beam_current, cav_state);
+    Kg = (fpga->set_point - probe_0)/(probe_1 - probe_0);
+
+    // FPGA drive delivering Kg through the SSA
+    if(SSA_Steady_Input(rf_station, Kg, &drive) != 0) ret = -1;
+    drive -= feed_forward;
+
+    // Integrator and output limits
+    double sat = fpga->state_sat < fpga->out_sat ? fpga->state_sat : fpga->out_sat;
+    if(cabs(drive) > sat) {
+      drive *= sat/cabs(drive);
+      ret = -1;
+    }
+  }
+  fpga_state->state = drive;
+  fpga_state->drive = drive;
+
+  // SSA (band-limiting filter and saturation) and cavity
+  double complex fil_out = Filter_Set_Steady_State(&rf_station->SSA_fil, &rf_state->SSA_fil,
+    (drive+feed_forward)/rf_station->PAscale, 1.0);
+  if(rf_station->sat_mode == SAT_TABLE) Kg = Saturate_Table(&rf_station->sat_table, fil_out);
+  else Kg = Saturate(fil_out, rf_station->Clip);
+  Kg = Kg*rf_station->PAscale;
+
+  Cavity_Set_Steady_State(rf_station->cav, delta_tz, Kg, beam_current, cav_state);
+  cav_state->E_fwd = Kg;
+
+  // Loop delay and noise-shaping filter hold the probe signal
+  for(int i=0;i<rf_station->loop_delay.size;i++) rf_state->loop_delay_state.buffer[i] = cav_state->E_probe;
+  rf_state->loop_delay_state.index = 0;
+  E_probe_lp = Filter_Set_Steady_State(&rf_station->noise_shape_fil, &rf_state->noise_shape_fil, cav_state->E_probe, 1.0);
+  fpga_state->err = E_probe_lp - fpga->set_point;
+
+  return ret;
+}
+
 /** Helper routine to zero out RF Station State. Useful to restore initial state in unit tests. */
 void RF_Station_Clear(RF_Station *rf_station, RF_State * rf_state)
 {
@@ -437,4 +878,10 @@ void RF_Station_Clear(RF_Station *rf_station, RF_State * rf_state)
   Filter_State_Clear(&rf_station->noise_shape_fil, &rf_state->noise_shape_fil);
   SSA_Clear(rf_station, rf_state);
   Delay_Clear(&rf_station->loop_delay, &rf_state->loop_delay_state);
+
+  // Restart the LLRF noise stream from its first step (the key is kept) and empty its buffer
+  rf_state->rng.counter = 0;
+  memset(rf_state->llrf_ns_buf, 0, 6*LLRF_NOISE_BUF*sizeof(double));
+  rf_state->llrf_ns_index = LLRF_NOISE_BUF;
+  rf_state->probe_ns = rf_state->rev_ns = rf_state->fwd_ns = 0.0;
 }
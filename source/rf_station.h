@@ -55,6 +55,37 @@ double complex Delay_Step(double complex in, Delay *delay, Delay_State *delay_st
 void Delay_Clear(Delay *delay, Delay_State *delay_state);
 void Delay_Deallocate(Delay *delay);
 
+/*
+ * SSA saturation table
+ */
+
+#define SAT_EXACT 0   ///< Saturation evaluated with the exact formula (Saturate)
+#define SAT_TABLE 1   ///< Saturation interpolated from the RF Station's table (Saturate_Table)
+
+#define SAT_TABLE_SIZE 1024   ///< Number of table intervals
+#define SAT_TABLE_RMAX 8.0    ///< Input magnitude covered by the table (exact formula beyond)
+#define SAT_TABLE_TOL 1e-9    ///< Relative error tolerance of the interpolated intervals (exact formula below r_min)
+#define SAT_TABLE_CHECKS 8    ///< Points per interval checked against the tolerance
+
+/**
+ * Gain curve g(r) = (1+r^c)^(-1/c) of the SSA saturation (Saturate(in,c) = in*g(|in|))
+ * tabulated on a uniform grid over [0, r_max], with its analytic derivative,
+ * for cubic Hermite interpolation.
+ */
+typedef struct str_Sat_Table {
+  double harshness;   ///< Saturation harshness parameter (c)
+  int n;              ///< Number of intervals
+  double r_max;       ///< Input magnitude covered by the table
+  double r_min;       ///< Input magnitude below which the exact formula is used
+  double inv_dr;      ///< Inverse of the grid spacing
+  double *g;          ///< Gain at the n+1 grid points
+  double *dg;         ///< Derivative of the gain at the grid points, times the grid spacing
+} Sat_Table;
+
+void Sat_Table_Allocate_In(Sat_Table *tab, double harshness, int n, double r_max);
+void Sat_Table_Deallocate(Sat_Table *tab);
+double Sat_Table_Max_Error(Sat_Table *tab, int n_test);
+
 /*
  * RF Station
  */
@@ -65,6 +96,8 @@ typedef struct str_RF_Station {
   double Clip;  ///< Saturation parameter
   double PAscale; ///< Amplifier scaling (from unitless to sqrt(W))
   double PAmax;
+  int sat_mode;   ///< SSA saturation mode (SAT_EXACT or SAT_TABLE, see RF_Station_Set_Saturation)
+  Sat_Table sat_table;  ///< SSA saturation table (built when SAT_TABLE mode is selected)
 
   Filter noise_shape_fil; ///< Noise-shaping low-pass filter
   Filter SSA_fil; ///< SSA Filters
@@ -84,6 +117,14 @@ typedef RF_Station** RF_Station_dp;
 RF_Station_dp RF_Station_Allocate_Array(int n);
 void RF_Station_Append(RF_Station** rf_station_arr, RF_Station* rf_station, int index);
 
+/** Number of simulation steps of LLRF noise generated at once (per RF State) */
+#define LLRF_NOISE_BUF 4096
+
+/** Relative transient of the SSA filter below which RF_Station_Step_Block takes the SSA output as constant (fast-forward) */
+#define RF_FF_SSA_TOL 1e-14
+/** Number of steps of the probe signal buffered at once by the fast-forward of RF_Station_Step_Block */
+#define RF_FF_CHUNK 1024
+
 typedef struct str_RF_Station_State {
 
   Filter_State noise_shape_fil, SSA_fil;
@@ -93,6 +134,9 @@ typedef struct str_RF_Station_State {
 
   // Noise signal for each sampled signal
   double complex probe_ns, rev_ns, fwd_ns;
+  Noise_RNG rng;  ///< Random number stream of the LLRF noise (one per RF Station)
+  double *llrf_ns_buf;  ///< LLRF noise buffer: LLRF_NOISE_BUF steps of 6 standard normals (probe, reverse, forward)
+  int llrf_ns_index;    ///< Next step to be consumed from llrf_ns_buf (refilled when it reaches LLRF_NOISE_BUF)
 
 } RF_State;
 
@@ -131,6 +175,8 @@ RF_Station * RF_Station_Allocate_New(
   double rev_ns_rms,
   double fwd_ns_rms);
 
+void RF_Station_Set_Discretization(RF_Station *rf_station, int method);
+void RF_Station_Set_Saturation(RF_Station *rf_station, int sat_mode);
 void RF_Station_Deallocate(RF_Station *rf_station);
 
 void RF_State_Allocate(RF_State *rf_state, RF_Station *rf_station);
@@ -141,6 +187,13 @@ double complex RF_Station_Step(
   double delta_tz, double complex beam_current, double complex feed_forward,
   RF_State *rf_state);
 
+void RF_Station_Step_Block(
+  RF_Station *rf_station, int n,
+  double *delta_tz, double complex *beam_current, double complex *feed_forward,
+  double complex *V, double complex *E_probe, double complex *E_reverse,
+  double complex *E_fwd, double complex *Kg, double *delta_omega,
+  RF_State *rf_state);
+
 /**
  * Step a Solid-State Amplifier (SSA) in time
  */
@@ -148,12 +201,16 @@ double complex SSA_Step(RF_Station *rf_station, double complex drive_in,
   RF_State *rf_state);
 
 void RF_Station_Clear(RF_Station *rf_station, RF_State *rf_state);
+int RF_Station_Set_Steady_State(RF_Station *rf_station, double delta_tz, double complex beam_current,
+  double complex feed_forward, RF_State *rf_state);
 
 /**
  * Exactly what it sounds like, apply a phase shift to a complex signal.
  */
 double complex Phase_Shift(double complex in, double theta);
 double complex Saturate(double complex in, double harshness);
+double complex Saturate_Table(Sat_Table *tab, double complex in);
+void Saturate_Table_Block(Sat_Table *tab, const double complex *in, double complex *out, int n);
 void Apply_LLRF_Noise(RF_Station *rf_station, RF_State *rf_state);
 
 void SSA_Clear(RF_Station *rf_station, RF_State *rf_state);
@@ -257,6 +257,368 @@ def unit_SSA(showplots=True, TOL=1.0e-14):
 
     plt.show()
 
+def unit_RF_Station_discretization():
+    """
+    Unit test for the exact (zero-order-hold) discretization selected from the JSON configuration
+    (Simulation "discretization" entry, RF_Station_Set_Discretization).
+    PASS if the SSA, noise-shaping and cavity filters (including the cavity's packed coefficients)
+    map their poles exactly (exp(p*Tstep)).
+    """
+
+    # Import JSON parser module
+    from get_configuration import Get_SWIG_RF_Station
+
+    zoh_config = '{"Simulation": {"discretization": {"value": "zoh"}}}'
+    rf_station, Tstep, fund_mode_dict = Get_SWIG_RF_Station(zoh_config, Verbose=False)
+    station = rf_station.C_Pointer
+    cav = station.cav
+
+    # SSA, noise-shaping and Electrical mode filters
+    fils = [station.SSA_fil, station.noise_shape_fil]
+    fils += [mode.C_Pointer.fil for mode in rf_station.cavity.elec_modes]
+
+    error = 0.0
+    method_pass = True
+    for fil in fils:
+        method_pass = method_pass & (fil.method == acc.FILTER_ZOH)
+        pole = acc.complexdouble_Array.frompointer(fil.poles)[0]
+        a = acc.complexdouble_Array.frompointer(fil.coeffs)[0]
+        error = max(error, np.abs(a - np.exp(pole*Tstep)))
+
+    # Packed coefficients of the Electrical modes
+    a_re = acc.double_Array.frompointer(cav.fil_bank.a_re)
+    a_im = acc.double_Array.frompointer(cav.fil_bank.a_im)
+    for idx, mode in enumerate(rf_station.cavity.elec_modes):
+        pole = acc.complexdouble_Array.frompointer(mode.C_Pointer.fil.poles)[0]
+        error = max(error, np.abs(a_re[idx] + 1j*a_im[idx] - np.exp(pole*Tstep)))
+
+    print '  ZOH pole mapping max error is {:.2e}'.format(error)
+
+    return method_pass & (error < 1e-12)
+
+def unit_saturate_table(n_test=100000):
+    """
+    Unit test for the table-driven SSA saturation (Sat_Table, Saturate_Table, RF_Station_Set_Saturation):
+    the table is only built when selected from the JSON configuration (Amplifier "saturation" entry),
+    and its relative error against the exact formula (Saturate), swept independently over and beyond
+    the table's range (complex inputs), stays within the bound reported by Sat_Table_Max_Error
+    and the interpolation tolerance (SAT_TABLE_TOL), for integer and non-integer harshness parameters.
+    PASS if all conditions hold.
+    """
+
+    # Import JSON parser module
+    from get_configuration import Get_SWIG_RF_Station
+
+    # Exact saturation by default: no table
+    rf_station, Tstep, fund_mode_dict = Get_SWIG_RF_Station("{}", Verbose=False)
+    exact_station = rf_station.C_Pointer
+    mode_pass = (exact_station.sat_mode == acc.SAT_EXACT) & (exact_station.sat_table.n == 0)
+
+    table_config = '{"SSA_Amplifier": {"saturation": {"value": "table"}}}'
+    rf_station, Tstep, fund_mode_dict = Get_SWIG_RF_Station(table_config, Verbose=False)
+    station = rf_station.C_Pointer
+    mode_pass = mode_pass & (station.sat_mode == acc.SAT_TABLE) & (station.sat_table.n == acc.SAT_TABLE_SIZE)
+
+    # Station table and stand-alone tables for other harshness parameters
+    tables = [station.sat_table]
+    for c in [0.5, 1.0, 1.5, 2.5, 3.0]:
+        tab = acc.Sat_Table()
+        acc.Sat_Table_Allocate_In(tab, c, acc.SAT_TABLE_SIZE, acc.SAT_TABLE_RMAX)
+        tables.append(tab)
+
+    r = np.linspace(0.0, 1.2*acc.SAT_TABLE_RMAX, 20001)[1:]
+    x = r*np.exp(0.7j)
+
+    error_pass = True
+    for tab in tables:
+        err = max(np.abs(acc.Saturate_Table(tab, xk) - acc.Saturate(xk, tab.harshness))/np.abs(acc.Saturate(xk, tab.harshness)) for xk in x)
+        max_error = acc.Sat_Table_Max_Error(tab, n_test)
+        print '  Harshness {0}: swept error {1:.2e}, Sat_Table_Max_Error {2:.2e}'.format(tab.harshness, err, max_error)
+        error_pass = error_pass & (err < 2.0*acc.SAT_TABLE_TOL) & (max_error < 2.0*acc.SAT_TABLE_TOL) & (err < 2.0*max_error)
+
+    for tab in tables[1:]:
+        acc.Sat_Table_Deallocate(tab)
+
+    # SSA output in table mode follows the exact curve
+    out_error = 0.0
+    for xk in x[::1000]:
+        out_error = max(out_error, np.abs(acc.Saturate_Table(station.sat_table, xk) - acc.Saturate(xk, station.Clip)))
+    print '  SSA saturation (Clip {0}) max absolute error {1:.2e}'.format(station.Clip, out_error)
+
+    return mode_pass & error_pass & (out_error < 2.0*acc.SAT_TABLE_TOL)
+
+def unit_saturate_table_block(n_steps=2000, n_stations=4):
+    """
+    Unit test for the batch table-driven SSA saturation (Saturate_Table_Block):
+    the SSA input waveforms of several RF Stations sharing a saturation table (drives ramping up
+    to beyond the table's range with different phases) are saturated in one call, for integer and non-integer
+    harshness parameters, and compared against the exact formula (Saturate) and the scalar Saturate_Table.
+    PASS if the relative error is within the interpolation tolerance (SAT_TABLE_TOL), the result matches
+    Saturate_Table exactly and the call rejects arrays of different lengths.
+    """
+
+    # SSA input waveforms of n_stations stations (one after the other)
+    t = np.linspace(0.0, 1.0, n_steps)
+    drives = [(0.2 + 1.1*k)*acc.SAT_TABLE_RMAX/n_stations*t*np.exp(1j*(0.3 + 1.7*k)) for k in range(n_stations)]
+    x = np.concatenate(drives).astype(np.complex128)
+
+    error_pass = True
+    for c in [0.5, 1.0, 1.5, 2.5, 3.0]:
+        tab = acc.Sat_Table()
+        acc.Sat_Table_Allocate_In(tab, c, acc.SAT_TABLE_SIZE, acc.SAT_TABLE_RMAX)
+
+        y = np.zeros_like(x)
+        n = acc.Saturate_Table_Block(tab, x, y)
+
+        exact = np.array([acc.Saturate(xk, c) for xk in x])
+        scalar = np.array([acc.Saturate_Table(tab, xk) for xk in x])
+        nz = np.abs(exact) > 0.0
+        err = np.max(np.abs(y[nz] - exact[nz])/np.abs(exact[nz]))
+        print '  Harshness {0}: {1} stations x {2} steps, max relative error {3:.2e}'.format(c, n_stations, n_steps, err)
+        error_pass = error_pass & (n == len(x)) & (err < 2.0*acc.SAT_TABLE_TOL) & np.array_equal(y, scalar)
+
+        # Mismatched lengths
+        error_pass = error_pass & (acc.Saturate_Table_Block(tab, x, y[:-1]) == -1)
+
+        acc.Sat_Table_Deallocate(tab)
+
+    return error_pass
+
+def unit_noise_philox():
+    """
+    Unit test for the Philox4x32-10 counter-based generator (Noise_RNG_Block, noise.c/h):
+    compare against the known-answer vectors published with Random123 (kat_vectors).
+    The 128-bit counter is (step low word, step high word, signal, block) and the key is (seed, stream).
+    PASS if all vectors are reproduced.
+    """
+
+    # (counter, key, expected output)
+    kat_vectors = [
+        ([0x00000000, 0x00000000, 0x00000000, 0x00000000], [0x00000000, 0x00000000],
+            [0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8]),
+        ([0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff], [0xffffffff, 0xffffffff],
+            [0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd]),
+        ([0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344], [0xa4093822, 0x299f31d0],
+            [0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1])]
+
+    rng = acc.Noise_RNG()
+    out = acc.uint32_Array(4)
+
+    kat_pass = True
+    for ctr, key, expected in kat_vectors:
+        acc.Noise_RNG_Init(rng, key[0], key[1])
+        acc.Noise_RNG_Block(rng, ctr[0] + (ctr[1] << 32), ctr[2], ctr[3], out)
+        words = [out[k] for k in xrange(4)]
+        print '  Philox4x32-10 output: ' + ' '.join('{:08x}'.format(w) for w in words)
+        kat_pass = kat_pass & (words == expected)
+
+    return kat_pass
+
+def unit_noise_normals(n_steps=100000, n=6, seed=12345):
+    """
+    Unit test for the standard normals drawn from Philox streams (Noise_RNG_Fill, Box-Muller transform):
+    draw n_steps*n numbers and check their sample mean and variance against 0 and 1,
+    within five standard errors. Noise_RNG_Fill must also match per-step Noise_RNG_Normals draws.
+    Return PASS/FAIL boolean.
+    """
+
+    rng = acc.Noise_RNG()
+    acc.Noise_RNG_Init(rng, seed, 7)
+
+    N = n_steps*n
+    buf = acc.double_Array(N)
+    acc.Noise_RNG_Fill(rng, 0, n_steps, 3, n, buf)
+    x = np.array([buf[i] for i in xrange(N)])
+
+    mean = x.mean()
+    var = x.var()
+    print '  {0} normals: mean {1:.2e}, variance {2:.5f}'.format(N, mean, var)
+    dist_pass = (np.abs(mean) < 5.0/np.sqrt(N)) & (np.abs(var-1.0) < 5.0*np.sqrt(2.0/N))
+
+    # Bulk and per-step generation draw the same numbers
+    step = acc.double_Array(n)
+    same_pass = True
+    for k in [0, 1, n_steps//2, n_steps-1]:
+        acc.Noise_RNG_Normals(rng, k, 3, n, step)
+        same_pass = same_pass & all(step[j] == x[k*n+j] for j in xrange(n))
+
+    return dist_pass & same_pass
+
+def unit_llrf_noise(n_steps=5000):
+    """
+    Unit test for the buffered LLRF noise (Apply_LLRF_Noise, RF_Station_Clear):
+    step the noise for n_steps (crossing a buffer refill at LLRF_NOISE_BUF steps) and compare every step
+    against a per-step draw (Noise_RNG_Normals) of the RF State's stream, then clear the RF Station
+    and check that the noise restarts from the first step.
+    PASS if buffered and per-step noise are identical.
+    """
+
+    # Import JSON parser module
+    from get_configuration import Get_SWIG_RF_Station
+
+    rf_station, Tstep, fund_mode_dict = Get_SWIG_RF_Station("{}", Verbose=False)
+    station = rf_station.C_Pointer
+    rf_state = rf_station.State
+
+    ns = acc.double_Array(6)
+    def ns_expected(k):
+        acc.Noise_RNG_Normals(rf_state.rng, k, 0, 6, ns)
+        return (station.probe_ns_rms*ns[0] + 1j*(station.probe_ns_rms*ns[1]),
+            station.rev_ns_rms*ns[2] + 1j*(station.rev_ns_rms*ns[3]),
+            station.fwd_ns_rms*ns[4] + 1j*(station.fwd_ns_rms*ns[5]))
+
+    def ns_applied():
+        acc.Apply_LLRF_Noise(station, rf_state)
+        return (rf_state.probe_ns, rf_state.rev_ns, rf_state.fwd_ns)
+
+    rms_pass = (station.probe_ns_rms > 0.0) & (station.rev_ns_rms > 0.0) & (station.fwd_ns_rms > 0.0)
+
+    same_pass = True
+    for k in xrange(n_steps):
+        same_pass = same_pass & (ns_applied() == ns_expected(k))
+
+    # Clear restarts the stream (partially consumed buffer is discarded)
+    acc.RF_Station_Clear(station, rf_state)
+    clear_pass = (rf_state.rng.counter == 0) & (rf_state.llrf_ns_index == acc.LLRF_NOISE_BUF)
+    for k in xrange(3):
+        clear_pass = clear_pass & (ns_applied() == ns_expected(k))
+
+    print '  Buffered LLRF noise identical to per-step draws: {0}, restarted by Clear: {1}'.format(same_pass, clear_pass)
+
+    return rms_pass & same_pass & clear_pass
+
+def unit_RF_Station_step_block(nt=5000, seed=4):
+    """
+    Unit test for RF_Station_Step_Block: run the same timing jitter, beam current and feed-forward waveforms
+    through RF_Station_Step (one call per step) and RF_Station_Step_Block, on two instances of the
+    RF Station (closed loop, same LLRF noise streams).
+    Empty arrays stand for zero inputs (timing jitter and feed-forward) and unrecorded outputs.
+    PASS if the recorded waveforms are identical and the block call returns the number of steps,
+    or -1 (without stepping) when the waveform lengths do not match.
+    """
+
+    # Import JSON parser module
+    from get_configuration import Get_SWIG_RF_Station
+
+    test_file = "source/configfiles/unit_tests/cavity_test_step1.json"
+
+    def new_station():
+        rf_station, Tstep, fund_mode_dict = Get_SWIG_RF_Station(test_file, Verbose=False)
+        fund_state = acc.ElecMode_State_Get(rf_station.State.cav_state, rf_station.C_Pointer.cav.fund_index)
+        return rf_station, fund_state, Tstep
+
+    def outputs():
+        return [np.zeros(nt, dtype=np.complex) for k in xrange(5)] + [np.zeros(nt, dtype=np.double)]
+
+    def step_loop(delta_tz, feed_forward):
+        rf_station, fund_state, Tstep = new_station()
+        V, E_probe, E_reverse, E_fwd, Kg, delta_omega = outputs()
+        for i in xrange(nt):
+            V[i] = acc.RF_Station_Step(rf_station.C_Pointer, delta_tz[i], beam_current[i], feed_forward[i], rf_station.State)
+            E_probe[i] = rf_station.State.cav_state.E_probe
+            E_reverse[i] = rf_station.State.cav_state.E_reverse
+            E_fwd[i] = rf_station.State.cav_state.E_fwd
+            Kg[i] = rf_station.State.cav_state.Kg
+            delta_omega[i] = fund_state.delta_omega
+        return V, E_probe, E_reverse, E_fwd, Kg, delta_omega
+
+    rf_station, fund_state, Tstep = new_station()
+    rng = np.random.RandomState(seed)
+    delta_tz = 1e-13*rng.randn(nt)
+    beam_current = np.where(np.arange(nt) % 1000 < 300, 1e-12/Tstep, 0.0).astype(np.complex)
+    feed_forward = 0.01*np.exp(2j*np.pi*np.arange(nt)/nt)
+    no_input = np.zeros(0, dtype=np.complex)
+    no_output = np.zeros(0, dtype=np.complex)
+    no_delta_tz = np.zeros(0, dtype=np.double)
+    no_detuning = np.zeros(0, dtype=np.double)
+
+    # All inputs and outputs
+    ref = step_loop(delta_tz, feed_forward)
+    V, E_probe, E_reverse, E_fwd, Kg, delta_omega = outputs()
+    n = acc.RF_Station_Step_Block(rf_station.C_Pointer, delta_tz, beam_current, feed_forward,
+        V, E_probe, E_reverse, E_fwd, Kg, delta_omega, rf_station.State)
+    full_pass = (n == nt) & all(np.array_equal(x, y) for x, y in zip(ref, [V, E_probe, E_reverse, E_fwd, Kg, delta_omega]))
+
+    # Zero timing jitter and feed-forward, only the probe and forward signals recorded
+    zeros = np.zeros(nt)
+    ref = step_loop(zeros, zeros.astype(np.complex))
+    rf_station, fund_state, Tstep = new_station()
+    V, E_probe, E_reverse, E_fwd, Kg, delta_omega = outputs()
+    n = acc.RF_Station_Step_Block(rf_station.C_Pointer, no_delta_tz, beam_current, no_input,
+        no_output, E_probe, no_output, E_fwd, no_output, no_detuning, rf_station.State)
+    empty_pass = (n == nt) & np.array_equal(ref[1], E_probe) & np.array_equal(ref[3], E_fwd)
+
+    # Mismatched lengths
+    E_probe_last = rf_station.State.cav_state.E_probe
+    n = acc.RF_Station_Step_Block(rf_station.C_Pointer, delta_tz, beam_current, no_input,
+        no_output, E_probe[:-1], no_output, no_output, no_output, no_detuning, rf_station.State)
+    length_pass = (n == -1) & (rf_station.State.cav_state.E_probe == E_probe_last)
+
+    print '  RF_Station_Step vs. RF_Station_Step_Block: all signals {0}, empty arrays {1}, mismatched lengths {2}'.format(
+        'identical' if full_pass else 'differ', 'identical' if empty_pass else 'differ', 'rejected' if length_pass else 'accepted')
+
+    return full_pass & empty_pass & length_pass
+
+def unit_RF_Station_fast_forward(Tmax=2e-3, min_steps=16):
+    """
+    Unit test for the fast-forward of RF_Station_Step_Block (Cavity_Set_Fast_Forward on the RF Station's Cavity)
+    with the SSA test configuration: in open loop with no LLRF noise, a piecewise-constant feed-forward drives
+    the SSA into saturation and back (and the beam is turned on), with and without fast-forward;
+    the transients of the SSA filter through the saturation are stepped, the settled intervals fast-forwarded.
+    The same runs with the loop closed, or with LLRF noise, must fall back to regular stepping.
+    PASS if the open-loop records match to within rounding errors (the SSA output to within RF_FF_SSA_TOL)
+    and the other records are identical.
+    """
+
+    # Import JSON parser module
+    from get_configuration import Get_SWIG_RF_Station
+
+    test_file = "source/configfiles/unit_tests/SSA_test.json"
+
+    def run(fast_forward, openloop=1, ns_rms=0.0):
+        rf_station, Tstep, fund_mode_dict = Get_SWIG_RF_Station(test_file, Verbose=False)
+        acc.Cavity_Set_Fast_Forward(rf_station.C_Pointer.cav, min_steps if fast_forward else 0)
+        rf_station.State.fpga_state.openloop = openloop
+        rf_station.C_Pointer.probe_ns_rms = ns_rms
+        rf_station.C_Pointer.rev_ns_rms = ns_rms
+        rf_station.C_Pointer.fwd_ns_rms = ns_rms
+
+        nt = int(Tmax/Tstep)
+        # SSA input (normalized units): off, saturated, then back in the linear region
+        level = np.zeros(nt, dtype=np.complex)
+        level[nt//10:] = 1.5
+        level[nt//2:] = 0.3*np.exp(0.5j)
+        feed_forward = level*rf_station.C_Pointer.PAscale - rf_station.C_Pointer.fpga.set_point
+        beam_current = np.zeros(nt, dtype=np.complex)
+        beam_current[int(nt*0.7):] = 1e-12/Tstep
+        no_delta_tz = np.zeros(0, dtype=np.double)
+        no_detuning = np.zeros(0, dtype=np.double)
+
+        V, E_probe, E_reverse, E_fwd, Kg = [np.zeros(nt, dtype=np.complex) for k in xrange(5)]
+        acc.RF_Station_Step_Block(rf_station.C_Pointer, no_delta_tz, beam_current, feed_forward,
+            V, E_probe, E_reverse, E_fwd, Kg, no_detuning, rf_station.State)
+        return [V, E_probe, E_reverse, E_fwd, Kg]
+
+    # Open loop, no LLRF noise
+    ref = run(False)
+    ff = run(True)
+    error = max([np.abs(y-x).max()/np.abs(x).max() for x, y in zip(ref, ff)])
+    Kg_error = np.abs(ff[4]-ref[4]).max()/np.abs(ref[4]).max()
+    engaged = not all(np.array_equal(x, y) for x, y in zip(ref, ff))
+    open_pass = engaged & (error < 1e-9) & (Kg_error < 100*acc.RF_FF_SSA_TOL)
+
+    # Closed loop, LLRF noise
+    fallback_pass = True
+    for openloop, ns_rms in [(0, 0.0), (1, 1e-6)]:
+        ref = run(False, openloop, ns_rms)
+        ff = run(True, openloop, ns_rms)
+        fallback_pass = fallback_pass & all(np.array_equal(x, y) for x, y in zip(ref, ff))
+
+    print '  RF Station fast-forward vs. stepping max relative error is {:.2e} (SSA output {:.2e}), fallback records {}'.format(
+        error, Kg_error, 'identical' if fallback_pass else 'differ')
+
+    return open_pass & fallback_pass
+
 def run_RF_Station_test(Tmax, test_file):
 
     # Import JSON parser module
@@ -349,6 +711,46 @@ def perform_tests():
         result = 'FAIL'
     print ">>> " + result
 
+    print "\n****\nTesting RF Station exact discretization..."
+    discretization_pass = unit_RF_Station_discretization()
+    if (discretization_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting RF Station block step..."
+    block_pass = unit_RF_Station_step_block()
+    if (block_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting RF Station fast-forward..."
+    fast_forward_pass = unit_RF_Station_fast_forward()
+    if (fast_forward_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting SSA saturation table..."
+    sat_table_pass = unit_saturate_table() & unit_saturate_table_block()
+    if (sat_table_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Philox random number streams..."
+    noise_pass = unit_noise_philox() & unit_noise_normals() & unit_llrf_noise()
+    if (noise_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
     # This is not a PASS/FAIL test
     print "\n****\nTesting Saturate..."
     unit_saturate()
@@ -368,7 +770,7 @@ def perform_tests():
 
     plt.figure()
 
-    return fpga_pass & phase_shift_pass
+    return fpga_pass & phase_shift_pass & discretization_pass & block_pass & fast_forward_pass & sat_table_pass & noise_pass
 
 if __name__ == "__main__":
     plt.close('all')
@@ -10,10 +10,10 @@ d               := $(dir)
 TGT_$(d)        :=
 
 $(d)/accelerator.py: $(d)/accelerator.i
-	swig -v -python $^
+	swig -v -python $(SWIG_FLAGS) $^
 
 $(d)/accelerator_wrap.c: $(d)/accelerator.i
-	swig -v -python $^
+	swig -v -python $(SWIG_FLAGS) $^
 
 CFLAGS_$(d)/filter.o := -I/usr/include/python2.7 -I/usr/include/numpy
 CFLAGS_$(d)/rf_station.o := -I/usr/include/python2.7 -I/usr/include/numpy
@@ -21,14 +21,19 @@ CFLAGS_$(d)/cryomodule.o := -I/usr/include/python2.7 -I/usr/include/numpy
 CFLAGS_$(d)/linac.o := -I/usr/include/python2.7 -I/usr/include/numpy
 CFLAGS_$(d)/doublecompress.o := -I/usr/include/python2.7 -I/usr/include/numpy
 CFLAGS_$(d)/simulation_top.o := -I/usr/include/python2.7 -I/usr/include/numpy
+CFLAGS_$(d)/sim_pool.o := -I/usr/include/python2.7 -I/usr/include/numpy
+CFLAGS_$(d)/sim_psd.o := -I/usr/include/python2.7 -I/usr/include/numpy
+CFLAGS_$(d)/sim_stats.o := -I/usr/include/python2.7 -I/usr/include/numpy
+CFLAGS_$(d)/sim_writer.o := -I/usr/include/python2.7 -I/usr/include/numpy
+CFLAGS_$(d)/state_arena.o := -I/usr/include/python2.7 -I/usr/include/numpy
 # CFLAGS_$(d)/beam_based_feedback.o := -I/usr/include/python2.7 -I/usr/include/numpy
 CFLAGS_$(d)/noise.o := -I/usr/include/python2.7 -I/usr/include/numpy
 CFLAGS_$(d)/cavity.o := -I/usr/include/python2.7 -I/usr/include/numpy
 CFLAGS_$(d)/accelerator_wrap.o := -I/usr/include/python2.7 -I/usr/include/numpy
 
 $(d)/accelerator_wrap.o: CF_ALL := $(filter-out -Wcast-qual -Wshadow -Wmissing-prototypes -Wstrict-prototypes,$(CF_ALL))
-$(d)/_accelerator.so: $(d)/filter.o $(d)/cavity.o $(d)/rf_station.o $(d)/cryomodule.o $(d)/linac.o $(d)/doublecompress.o $(d)/noise.o $(d)/simulation_top.o $(d)/accelerator_wrap.o
-	$(CC) -shared $^ -o $@
+$(d)/_accelerator.so: $(d)/filter.o $(d)/cavity.o $(d)/rf_station.o $(d)/cryomodule.o $(d)/linac.o $(d)/doublecompress.o $(d)/noise.o $(d)/simulation_top.o $(d)/sim_pool.o $(d)/sim_psd.o $(d)/sim_stats.o $(d)/sim_writer.o $(d)/state_arena.o $(d)/accelerator_wrap.o
+	$(CC) -shared $^ -o $@ -lpthread
 	# Use this rule if you're running under Mac OSX
 	# $(CC) -lpython -dynamclib $^ -o $@
 
@@ -0,0 +1,196 @@
+/**
+ * @file sim_pool.c
+ * @brief Simulation thread pool: a persistent pool of worker threads stepping the Cryomodules
+ * of all Linac sections in parallel. Cryomodules in a simulation step only depend on the step's
+ * timing jitter and beam charge; their accelerating voltages are combined in machine order
+ * once all of them have been stepped, so results are bit-identical to the serial Linac_Step.
+ */
+
+#include "sim_pool.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Allocate zeroed memory aligned to a cache line. */
+static void *Sim_Pool_Calloc(size_t n, size_t size)
+{
+	void *ptr = NULL;
+	if(posix_memalign(&ptr, SIM_POOL_CACHE_LINE, (n > 0 ? n : 1)*size) != 0) return NULL;
+	memset(ptr, 0, (n > 0 ? n : 1)*size);
+	return ptr;
+}
+
+/** Relative cost of a Cryomodule step, used to balance the initial assignment of tasks to threads. */
+static double Sim_Pool_Task_Cost(Cryomodule *cryo)
+{
+	double cost = cryo->n_mechModes;
+	for(int s=0;s<cryo->n_rf_stations;s++) cost += 8.0 + 4.0*cryo->rf_station_net[s]->cav->n_modes;
+	return cost;
+}
+
+/** Step every task a thread can claim: its own range first, then ranges of the other threads (work-stealing). */
+static void Sim_Pool_Work(Sim_Pool *pool, int id)
+{
+	double delta_tz = pool->delta_tz, beam_charge = pool->beam_charge;
+
+	for(int w=0;w<pool->n_threads;w++) {
+		Sim_Pool_Worker *victim = &pool->workers[(id+w)%pool->n_threads];
+		for(;;) {
+			int idx = __atomic_fetch_add(&victim->next, 1, __ATOMIC_RELAXED);
+			if(idx >= victim->end) break;
+			Sim_Pool_Task *task = &pool->tasks[idx];
+			task->cryo_V = Cryomodule_Step(task->cryo, task->cryo_state, delta_tz, beam_charge);
+		}
+	}
+}
+
+/** Worker thread: wait for a new step (generation), step tasks and report completion, until stopped. */
+static void *Sim_Pool_Thread(void *arg)
+{
+	Sim_Pool_Worker *worker = (Sim_Pool_Worker *)arg;
+	Sim_Pool *pool = worker->pool;
+	unsigned seen = 0;
+
+	for(;;) {
+		// Wait for the next step
+		int spins = 0;
+		while(__atomic_load_n(&pool->generation, __ATOMIC_ACQUIRE) == seen) {
+			if(++spins > SIM_POOL_SPINS) { sched_yield(); spins = 0; }
+		}
+		seen++;
+		if(__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) break;
+
+		Sim_Pool_Work(pool, worker->id);
+
+		// Publish the results of this step
+		__atomic_add_fetch(&pool->done, 1, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+/** Allocates a Sim_Pool for the Cryomodules of the given Linacs (and their States, previously allocated)
+  * and starts n_threads-1 worker threads (the thread calling Sim_Pool_Step is the remaining one).
+  * The number of threads is limited to the number of Cryomodules and of online processors.
+  * Tasks are initially assigned to threads in contiguous ranges of balanced cost.
+  * Returns a pointer to the newly allocated struct, or NULL if threads can not be started. */
+Sim_Pool *Sim_Pool_Allocate_New(
+	Linac **linac_net,							///< Array of Linac Sections
+	Linac_State **linac_state_net,	///< Array of Linac States
+	int n_linacs,										///< Number of Linac Sections
+	int n_threads										///< Number of threads (including the calling thread)
+	)
+{
+	int l, c, t, k;
+	Sim_Pool *pool = Sim_Pool_Calloc(1, sizeof(Sim_Pool));
+	if(pool == NULL) return NULL;
+
+	pool->n_linacs = n_linacs;
+	pool->linac_net = linac_net;
+	pool->linac_state_net = linac_state_net;
+
+	// Tasks in machine order
+	pool->task_start = calloc(n_linacs+1, sizeof(int));
+	pool->n_tasks = 0;
+	for(l=0;l<n_linacs;l++) {
+		pool->task_start[l] = pool->n_tasks;
+		pool->n_tasks += linac_net[l]->n_cryos;
+	}
+	pool->task_start[n_linacs] = pool->n_tasks;
+
+	pool->tasks = Sim_Pool_Calloc(pool->n_tasks, sizeof(Sim_Pool_Task));
+	pool->cryo_V = calloc(pool->n_tasks > 0 ? pool->n_tasks : 1, sizeof(double complex));
+	k = 0;
+	for(l=0;l<n_linacs;l++) {
+		for(c=0;c<linac_net[l]->n_cryos;c++,k++) {
+			pool->tasks[k].cryo = linac_net[l]->cryo_net[c];
+			pool->tasks[k].cryo_state = linac_state_net[l]->cryo_state_net[c];
+		}
+	}
+
+	// No more threads than tasks or processors
+	long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if(n_cpus > 0 && n_threads > n_cpus) n_threads = (int)n_cpus;
+	if(n_threads > pool->n_tasks) n_threads = pool->n_tasks;
+	if(n_threads < 1) n_threads = 1;
+	pool->n_threads = n_threads;
+	pool->workers = Sim_Pool_Calloc(n_threads, sizeof(Sim_Pool_Worker));
+
+	// Split tasks into contiguous ranges of (roughly) equal cost
+	double total = 0.0, acc = 0.0;
+	for(k=0;k<pool->n_tasks;k++) total += Sim_Pool_Task_Cost(pool->tasks[k].cryo);
+	k = 0;
+	for(t=0;t<n_threads;t++) {
+		pool->workers[t].start = k;
+		while(k < pool->n_tasks && (t == n_threads-1 || acc + 0.5*Sim_Pool_Task_Cost(pool->tasks[k].cryo) < total*(t+1)/n_threads)) {
+			acc += Sim_Pool_Task_Cost(pool->tasks[k].cryo);
+			k++;
+		}
+		pool->workers[t].end = k;
+		pool->workers[t].next = pool->workers[t].end;
+		pool->workers[t].id = t;
+		pool->workers[t].pool = pool;
+	}
+
+	// Start worker threads
+	for(t=1;t<n_threads;t++) {
+		if(pthread_create(&pool->workers[t].thread, NULL, Sim_Pool_Thread, &pool->workers[t]) != 0) {
+			pool->n_threads = t;
+			Sim_Pool_Deallocate(pool);
+			return NULL;
+		}
+	}
+
+	return pool;
+}
+
+/** Stops the worker threads and frees memory of a Sim_Pool struct (Linacs and their States are not freed). */
+void Sim_Pool_Deallocate(Sim_Pool *pool)
+{
+	__atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+	for(int t=1;t<pool->n_threads;t++) pthread_join(pool->workers[t].thread, NULL);
+
+	free(pool->tasks);
+	free(pool->workers);
+	free(pool->cryo_V);
+	free(pool->task_start);
+	free(pool);
+}
+
+/** Step function for all Linacs bound to a Sim_Pool:
+  * same as calling Linac_Step for every Linac with the same timing jitter and beam charge,
+  * with Cryomodules stepped in parallel. Stores amplitude and phase errors of each Linac. */
+void Sim_Pool_Step(
+	Sim_Pool *pool,						///< Pointer to Sim_Pool
+	double delta_tz,					///< Timing jitter in seconds (RF reference noise)
+	double beam_charge,				///< Beam charge in Coulombs
+	double *amp_error_net,		///< Array of Linac RF amplitude errors (output)
+	double *phase_error_net		///< Array of Linac RF phase errors (output)
+	)
+{
+	int t, k, spins = 0;
+
+	// Reset task ranges and publish the step inputs (worker threads are idle here)
+	for(t=0;t<pool->n_threads;t++) __atomic_store_n(&pool->workers[t].next, pool->workers[t].start, __ATOMIC_RELAXED);
+	pool->delta_tz = delta_tz;
+	pool->beam_charge = beam_charge;
+	__atomic_store_n(&pool->done, 0, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&pool->generation, 1, __ATOMIC_RELEASE);
+
+	// The calling thread takes part as worker 0
+	Sim_Pool_Work(pool, 0);
+
+	// Barrier: wait for the other threads
+	while(__atomic_load_n(&pool->done, __ATOMIC_ACQUIRE) < pool->n_threads-1) {
+		if(++spins > SIM_POOL_SPINS) { sched_yield(); spins = 0; }
+	}
+
+	// Fixed-order reductions
+	for(k=0;k<pool->n_tasks;k++) pool->cryo_V[k] = pool->tasks[k].cryo_V;
+	for(int l=0;l<pool->n_linacs;l++) {
+		Linac_Step_Reduce(pool->linac_net[l], pool->linac_state_net[l], pool->cryo_V + pool->task_start[l],
+			&amp_error_net[l], &phase_error_net[l]);
+	}
+}
@@ -0,0 +1,68 @@
+/**
+  * @file sim_pool.h
+  * @brief Header file for sim_pool.c
+  * Persistent pool of worker threads stepping the Cryomodules of all Linacs in parallel.
+*/
+
+#ifndef SIM_POOL_H
+#define SIM_POOL_H
+
+#include <complex.h>
+#include <pthread.h>
+
+#include "linac.h"
+
+#define SIM_POOL_CACHE_LINE 64  ///< Alignment of per-thread and per-task data (avoids false sharing)
+#define SIM_POOL_SPINS 4096     ///< Spin iterations before a waiting thread yields the CPU
+
+/**
+ * A Cryomodule step, the unit of work distributed among threads.
+ * Tasks are numbered in machine order (Linac, then Cryomodule).
+ */
+typedef struct str_Sim_Pool_Task {
+	Cryomodule *cryo;
+	Cryomodule_State *cryo_state;
+	double complex cryo_V;   ///< Cryomodule accelerating voltage (output)
+} __attribute__((aligned(SIM_POOL_CACHE_LINE))) Sim_Pool_Task;
+
+/**
+ * Per-thread range of tasks [next, end). The owner and idle threads (work-stealing)
+ * claim tasks from it with an atomic increment of next.
+ */
+typedef struct str_Sim_Pool_Worker {
+	int next;         ///< Next unclaimed task
+	int start, end;   ///< Range of tasks assigned to the thread at the beginning of a step
+	int id;           ///< Worker index (0 is the calling thread)
+	pthread_t thread;
+	struct str_Sim_Pool *pool;
+} __attribute__((aligned(SIM_POOL_CACHE_LINE))) Sim_Pool_Worker;
+
+/**
+ * Data structure storing a pool of worker threads bound to a Simulation
+ * (see Sim_Pool_Allocate_New and Sim_Pool_Step).
+ */
+typedef struct str_Sim_Pool {
+	int n_threads;            ///< Number of threads, including the calling thread
+	int n_tasks;              ///< Number of Cryomodules over all Linacs
+	Sim_Pool_Task *tasks;
+	Sim_Pool_Worker *workers;
+
+	int n_linacs;
+	Linac **linac_net;
+	Linac_State **linac_state_net;
+	int *task_start;          ///< First task of each Linac (of length n_linacs+1)
+	double complex *cryo_V;   ///< Cryomodule accelerating voltages gathered for the reductions (of length n_tasks)
+
+	// Step inputs, published with generation
+	double delta_tz, beam_charge;
+
+	unsigned generation __attribute__((aligned(SIM_POOL_CACHE_LINE)));  ///< Incremented to start a step
+	int stop;                 ///< Set to terminate the worker threads
+	int done __attribute__((aligned(SIM_POOL_CACHE_LINE)));  ///< Number of worker threads done with the current step
+} Sim_Pool;
+
+Sim_Pool *Sim_Pool_Allocate_New(Linac **linac_net, Linac_State **linac_state_net, int n_linacs, int n_threads);
+void Sim_Pool_Deallocate(Sim_Pool *pool);
+void Sim_Pool_Step(Sim_Pool *pool, double delta_tz, double beam_charge, double *amp_error_net, double *phase_error_net);
+
+#endif
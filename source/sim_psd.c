@@ -0,0 +1,198 @@
+/**
+ * @file sim_psd.c
+ * @brief Online power spectral density estimation of Simulation signals (Welch's method):
+ * periodograms of overlapping segments are computed with a built-in radix-2 FFT as the segments
+ * fill during Simulation_Run, so spectra of arbitrarily long runs need no waveform dumps.
+ * Estimates follow the conventions of scipy.signal.welch with its default settings
+ * (one-sided density, 50% overlap, constant detrend).
+ */
+
+#include "sim_psd.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Complex product written out (avoids the C99 Annex G special-value handling of the * operator). */
+static inline double complex Sim_FFT_Mul(double complex a, double complex b)
+{
+	double ar = creal(a), ai = cimag(a), br = creal(b), bi = cimag(b);
+	return (ar*br - ai*bi) + I*(ar*bi + ai*br);
+}
+
+/** In-place radix-2 decimation-in-time FFT of length n (power of 2):
+  * X[k] = sum_j x[j] exp(-2 pi i j k/n), with twiddle[k] = exp(-2 pi i k/n) for k < n/2
+  * and bitrev the bit-reversal permutation of 0..n-1. */
+void Sim_FFT(double complex *x, int n, const double complex *twiddle, const int *bitrev)
+{
+	for(int i=0;i<n;i++) {
+		int j = bitrev[i];
+		if(j > i) {
+			double complex tmp = x[i];
+			x[i] = x[j];
+			x[j] = tmp;
+		}
+	}
+
+	for(int len=2;len<=n;len<<=1) {
+		int half = len/2, stride = n/len;
+		for(int start=0;start<n;start+=len) {
+			for(int k=0;k<half;k++) {
+				double complex u = x[start+k];
+				double complex v = Sim_FFT_Mul(x[start+k+half], twiddle[k*stride]);
+				x[start+k] = u + v;
+				x[start+k+half] = u - v;
+			}
+		}
+	}
+}
+
+/** Allocates a Welch PSD accumulator for the given output columns (see Sim_Output_Row).
+  * Returns 0 on success, or -1 if n_fft is not a power of 2 (at least 2). */
+int Sim_PSD_Allocate_In(
+	Sim_PSD *psd,				///< Pointer to Sim_PSD
+	int *cols,					///< Output column of each signal
+	int n_signals,			///< Number of signals
+	int n_fft,					///< Segment length (power of 2)
+	int window_type,		///< SIM_PSD_RECT or SIM_PSD_HANN
+	double Tstep				///< Sampling period (Simulation time step) in seconds
+	)
+{
+	int i, bits = 0;
+
+	if(n_fft < 2 || (n_fft & (n_fft-1)) != 0) return -1;
+	while((1 << bits) < n_fft) bits++;
+
+	psd->n_signals = n_signals;
+	psd->cols = calloc(n_signals > 0 ? n_signals : 1, sizeof(int));
+	memcpy(psd->cols, cols, n_signals*sizeof(int));
+	psd->n_fft = n_fft;
+	psd->window_type = window_type;
+	psd->fs = 1.0/Tstep;
+
+	// Window
+	psd->window = calloc(n_fft, sizeof(double));
+	psd->win_sq = 0.0;
+	for(i=0;i<n_fft;i++) {
+		psd->window[i] = window_type == SIM_PSD_HANN ? 0.5 - 0.5*cos(2.0*M_PI*i/n_fft) : 1.0;
+		psd->win_sq += psd->window[i]*psd->window[i];
+	}
+
+	// FFT tables
+	psd->work = calloc(n_fft, sizeof(double complex));
+	psd->twiddle = calloc(n_fft/2, sizeof(double complex));
+	psd->bitrev = calloc(n_fft, sizeof(int));
+	for(i=0;i<n_fft/2;i++) psd->twiddle[i] = cos(2.0*M_PI*i/n_fft) - I*sin(2.0*M_PI*i/n_fft);
+	for(i=0;i<n_fft;i++) {
+		int r = 0;
+		for(int b=0;b<bits;b++) if(i & (1 << b)) r |= 1 << (bits-1-b);
+		psd->bitrev[i] = r;
+	}
+
+	psd->history = calloc((size_t)(n_signals > 0 ? n_signals : 1)*n_fft, sizeof(double));
+	psd->psd_sum = calloc((size_t)(n_signals > 0 ? n_signals : 1)*(n_fft/2+1), sizeof(double));
+	Sim_PSD_Reset(psd);
+
+	return 0;
+}
+
+/** Frees memory of the arrays of a Sim_PSD struct. */
+void Sim_PSD_Deallocate(Sim_PSD *psd)
+{
+	free(psd->cols);
+	free(psd->window);
+	free(psd->work);
+	free(psd->twiddle);
+	free(psd->bitrev);
+	free(psd->history);
+	free(psd->psd_sum);
+}
+
+/** Discard accumulated samples and periodograms. */
+void Sim_PSD_Reset(Sim_PSD *psd)
+{
+	psd->pos = 0;
+	psd->n_samples = 0;
+	psd->n_segments = 0;
+	memset(psd->history, 0, (size_t)psd->n_signals*psd->n_fft*sizeof(double));
+	memset(psd->psd_sum, 0, (size_t)psd->n_signals*(psd->n_fft/2+1)*sizeof(double));
+}
+
+/** Accumulate the periodograms of the last n_fft samples of every signal.
+  * Signals are transformed in pairs, as the real and imaginary parts of one complex FFT. */
+static void Sim_PSD_Segment(Sim_PSD *psd)
+{
+	int n = psd->n_fft, half = n/2;
+	double scale = 1.0/(psd->fs*psd->win_sq);
+
+	for(int s=0;s<psd->n_signals;s+=2) {
+		int pair = s+1 < psd->n_signals;
+		const double *h1 = psd->history + (size_t)s*n;
+		const double *h2 = pair ? h1 + n : h1;
+		double m1 = 0.0, m2 = 0.0;
+
+		// Constant detrend
+		for(int i=0;i<n;i++) {
+			m1 += h1[i];
+			m2 += h2[i];
+		}
+		m1 /= n;
+		m2 /= n;
+
+		// Window the segment (oldest sample first)
+		for(int i=0;i<n;i++) {
+			int j = (psd->pos + i) & (n-1);
+			double w = psd->window[i];
+			psd->work[i] = w*(h1[j]-m1) + I*(pair ? w*(h2[j]-m2) : 0.0);
+		}
+
+		Sim_FFT(psd->work, n, psd->twiddle, psd->bitrev);
+
+		// Separate the spectra of both signals and accumulate one-sided densities
+		double *p1 = psd->psd_sum + (size_t)s*(half+1);
+		double *p2 = p1 + (half+1);
+		for(int k=0;k<=half;k++) {
+			double complex zk = psd->work[k], zn = psd->work[(n-k) & (n-1)];
+			double sr = creal(zk) + creal(zn), si = cimag(zk) - cimag(zn);  // 2 X1[k]
+			double dr = creal(zk) - creal(zn), di = cimag(zk) + cimag(zn);  // 2i X2[k]
+			double f = (k == 0 || k == half) ? 0.25*scale : 0.5*scale;
+			p1[k] += f*(sr*sr + si*si);
+			if(pair) p2[k] += f*(dr*dr + di*di);
+		}
+	}
+
+	psd->n_segments++;
+}
+
+/** Feed a Simulation output row to the accumulator: the selected columns are appended to the
+  * signal histories, and a segment is processed every n_fft/2 samples once n_fft samples are available. */
+void Sim_PSD_Update(Sim_PSD *psd, const double *row)
+{
+	int n = psd->n_fft;
+
+	for(int s=0;s<psd->n_signals;s++) psd->history[(size_t)s*n + psd->pos] = row[psd->cols[s]];
+	psd->pos = (psd->pos + 1) & (n-1);
+	psd->n_samples++;
+
+	if(psd->n_samples >= n && (psd->n_samples - n) % (n/2) == 0) Sim_PSD_Segment(psd);
+}
+
+/** Number of frequency bins of the one-sided PSD (n_fft/2+1). */
+int Sim_PSD_Bins(Sim_PSD *psd)
+{
+	return psd->n_fft/2 + 1;
+}
+
+/** Frequency of bin in Hz. */
+double Sim_PSD_Frequency(Sim_PSD *psd, int bin)
+{
+	return bin*psd->fs/psd->n_fft;
+}
+
+/** Power spectral density of signal at bin [signal units^2/Hz], averaged over the segments so far
+  * (0 if no segment has been completed). */
+double Sim_PSD_Value(Sim_PSD *psd, int signal, int bin)
+{
+	if(psd->n_segments == 0) return 0.0;
+	return psd->psd_sum[(size_t)signal*(psd->n_fft/2+1) + bin]/psd->n_segments;
+}
@@ -0,0 +1,52 @@
+/**
+  * @file sim_psd.h
+  * @brief Header file for sim_psd.c
+  * Online power spectral density estimation (Welch's method) of Simulation output columns.
+*/
+
+#ifndef SIM_PSD_H
+#define SIM_PSD_H
+
+#include <complex.h>
+
+#define SIM_PSD_RECT 0  ///< Rectangular window
+#define SIM_PSD_HANN 1  ///< Hann window (periodic, as scipy.signal.get_window('hann'))
+
+/**
+ * Data structure storing a Welch PSD accumulator for selected columns (signals) of Simulation output rows:
+ * segments of n_fft samples overlapping by half are detrended (mean removed), windowed and transformed
+ * as soon as they fill, and their one-sided periodograms are summed. Memory is O(n_fft) per signal,
+ * independent of the number of samples.
+ */
+typedef struct str_Sim_PSD {
+	int n_signals;             ///< Number of signals
+	int *cols;                 ///< Output column of each signal
+	int n_fft;                 ///< Segment length (power of 2)
+	int window_type;           ///< SIM_PSD_RECT or SIM_PSD_HANN
+	double fs;                 ///< Sampling frequency in Hz
+	double *window;            ///< Window (n_fft values)
+	double win_sq;             ///< Sum of squares of the window
+
+	double *history;           ///< Last n_fft samples of each signal (circular, n_signals*n_fft values)
+	int pos;                   ///< Position of the next sample in history
+	long n_samples;            ///< Number of samples received
+	long n_segments;           ///< Number of segments accumulated
+	double *psd_sum;           ///< Sum of periodograms (n_signals*(n_fft/2+1) values)
+
+	double complex *work;      ///< FFT work array (n_fft values)
+	double complex *twiddle;   ///< FFT twiddle factors (n_fft/2 values)
+	int *bitrev;               ///< FFT bit-reversal permutation (n_fft values)
+} Sim_PSD;
+
+int Sim_PSD_Allocate_In(Sim_PSD *psd, int *cols, int n_signals, int n_fft, int window_type, double Tstep);
+void Sim_PSD_Deallocate(Sim_PSD *psd);
+void Sim_PSD_Reset(Sim_PSD *psd);
+void Sim_PSD_Update(Sim_PSD *psd, const double *row);
+
+int Sim_PSD_Bins(Sim_PSD *psd);
+double Sim_PSD_Frequency(Sim_PSD *psd, int bin);
+double Sim_PSD_Value(Sim_PSD *psd, int signal, int bin);
+
+void Sim_FFT(double complex *x, int n, const double complex *twiddle, const int *bitrev);
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * @file sim_stats.c
+ * @brief Streaming reducers of Simulation output rows, evaluated every simulation step:
+ * running statistics (exact over the whole run, with constant memory) and an
+ * anti-aliasing decimation filter applied before output instead of plain sub-sampling.
+ */
+
+#include "sim_stats.h"
+#include "state_arena.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+/** Allocates the arrays of a Sim_Stats struct (as part of a Simulation State, see State_Calloc)
+  * and resets the statistics. */
+void Sim_Stats_Allocate_In(
+	Sim_Stats *stats,		///< Pointer to Sim_Stats
+	int n_cols					///< Number of columns in a row
+	)
+{
+	stats->n_cols = n_cols;
+	stats->mean = State_Calloc(n_cols, sizeof(double));
+	stats->m2 = State_Calloc(n_cols, sizeof(double));
+	stats->sum_sq = State_Calloc(n_cols, sizeof(double));
+	stats->min = State_Calloc(n_cols, sizeof(double));
+	stats->max = State_Calloc(n_cols, sizeof(double));
+
+	Sim_Stats_Reset(stats);
+}
+
+/** Frees memory of the arrays of a Sim_Stats struct (allocated outside a State_Arena). */
+void Sim_Stats_Deallocate(Sim_Stats *stats)
+{
+	free(stats->mean);
+	free(stats->m2);
+	free(stats->sum_sq);
+	free(stats->min);
+	free(stats->max);
+}
+
+/** Discard accumulated statistics. */
+void Sim_Stats_Reset(Sim_Stats *stats)
+{
+	stats->count = 0;
+	for(int c=0;c<stats->n_cols;c++) {
+		stats->mean[c] = stats->m2[c] = stats->sum_sq[c] = 0.0;
+		stats->min[c] = INFINITY;
+		stats->max[c] = -INFINITY;
+	}
+}
+
+/** Vectorizable update kernel of Sim_Stats_Update (Welford's algorithm). */
+static void Sim_Stats_Kernel(int n, double inv_count, const double * restrict row,
+	double * restrict mean, double * restrict m2, double * restrict sum_sq,
+	double * restrict min, double * restrict max)
+{
+	for(int c=0;c<n;c++) {
+		double x = row[c];
+		double delta = x - mean[c];
+		mean[c] += delta*inv_count;
+		m2[c] += delta*(x - mean[c]);
+		sum_sq[c] += x*x;
+		min[c] = x < min[c] ? x : min[c];
+		max[c] = x > max[c] ? x : max[c];
+	}
+}
+
+/** Accumulate a row (n_cols values) into the statistics. */
+void Sim_Stats_Update(Sim_Stats *stats, const double *row)
+{
+	stats->count++;
+	Sim_Stats_Kernel(stats->n_cols, 1.0/stats->count, row,
+		stats->mean, stats->m2, stats->sum_sq, stats->min, stats->max);
+}
+
+/** Mean of column col. */
+double Sim_Stats_Mean(Sim_Stats *stats, int col)
+{
+	return stats->mean[col];
+}
+
+/** Variance of column col (population variance: sum of squared deviations over count). */
+double Sim_Stats_Variance(Sim_Stats *stats, int col)
+{
+	return stats->count > 0 ? stats->m2[col]/stats->count : 0.0;
+}
+
+/** Standard deviation of column col (e.g. RMS jitter about the mean). */
+double Sim_Stats_Std(Sim_Stats *stats, int col)
+{
+	return sqrt(Sim_Stats_Variance(stats, col));
+}
+
+/** Root mean square of column col (about zero). */
+double Sim_Stats_RMS(Sim_Stats *stats, int col)
+{
+	return stats->count > 0 ? sqrt(stats->sum_sq[col]/stats->count) : 0.0;
+}
+
+/** Minimum of column col (+inf if no rows were accumulated). */
+double Sim_Stats_Min(Sim_Stats *stats, int col)
+{
+	return stats->min[col];
+}
+
+/** Maximum of column col (-inf if no rows were accumulated). */
+double Sim_Stats_Max(Sim_Stats *stats, int col)
+{
+	return stats->max[col];
+}
+
+/** Allocates the arrays of a Sim_Decimator (as part of a Simulation State, see State_Calloc) of the given order
+  * (1 to SIM_DECIMATOR_MAX_ORDER) and decimation factor for rows of n_cols values, and resets it. */
+void Sim_Decimator_Allocate_In(
+	Sim_Decimator *dec,		///< Pointer to Sim_Decimator
+	int n_cols,						///< Number of columns in a row
+	int order,						///< Filter order (number of boxcar stages)
+	int factor						///< Decimation factor
+	)
+{
+	if(order < 1) order = 1;
+	if(order > SIM_DECIMATOR_MAX_ORDER) order = SIM_DECIMATOR_MAX_ORDER;
+	if(factor < 1) factor = 1;
+
+	dec->n_cols = n_cols;
+	dec->order = order;
+	dec->factor = factor;
+	dec->pos = 0;
+	dec->count = 0;
+
+	int stages = order - 1;
+	dec->window = State_Calloc(stages > 0 ? (size_t)stages*factor*n_cols : 1, sizeof(double));
+	dec->sum = State_Calloc(stages > 0 ? (size_t)stages*n_cols : 1, sizeof(double));
+	dec->acc = State_Calloc(n_cols, sizeof(double));
+	dec->hold = State_Calloc(n_cols, sizeof(char));
+}
+
+/** Frees memory of the arrays of a Sim_Decimator struct (allocated outside a State_Arena). */
+void Sim_Decimator_Deallocate(Sim_Decimator *dec)
+{
+	free(dec->window);
+	free(dec->sum);
+	free(dec->acc);
+	free(dec->hold);
+}
+
+/** Pass column col through the decimation filter with sample-and-hold:
+  * the output is the input of the last row of each block, without averaging.
+  * Use for the time column and for wrapped phases, whose averages are meaningless across a wrap. */
+void Sim_Decimator_Set_Hold(
+	Sim_Decimator *dec,		///< Pointer to Sim_Decimator
+	int col								///< Column index
+	)
+{
+	if(col >= 0 && col < dec->n_cols) dec->hold[col] = 1;
+}
+
+/** Feed a row (n_cols values) to the decimation filter.
+  * Every factor rows, the filtered row is written into out (which may be in) and 1 is returned;
+  * 0 is returned otherwise. The filter starts from zero (as a CIC decimator) and has a group delay
+  * of order*(factor-1)/2 rows. */
+int Sim_Decimator_Step(
+	Sim_Decimator *dec,		///< Pointer to Sim_Decimator
+	const double *in,			///< Input row
+	double *out						///< Output row (written every factor rows)
+	)
+{
+	int n_cols = dec->n_cols, stages = dec->order - 1, factor = dec->factor;
+	int done = ++dec->count == factor;
+	double inv_factor = 1.0/factor;
+
+	for(int c=0;c<n_cols;c++) {
+		double x = in[c];
+
+		// Sample-and-hold columns
+		if(dec->hold[c]) {
+			if(done) out[c] = x;
+			continue;
+		}
+
+		// Sliding boxcar stages
+		for(int k=0;k<stages;k++) {
+			double *win = dec->window + ((size_t)k*factor + dec->pos)*n_cols;
+			double *sum = dec->sum + (size_t)k*n_cols;
+			sum[c] += x - win[c];
+			win[c] = x;
+			x = sum[c]*inv_factor;
+		}
+
+		// Block average
+		dec->acc[c] += x;
+		if(done) {
+			out[c] = dec->acc[c]*inv_factor;
+			dec->acc[c] = 0.0;
+		}
+	}
+	if(done) dec->count = 0;
+
+	// Once per turn of the sliding windows, sum them again (running sums do not drift)
+	if(stages > 0 && ++dec->pos == factor) {
+		dec->pos = 0;
+		for(int k=0;k<stages;k++) {
+			double *sum = dec->sum + (size_t)k*n_cols;
+			for(int c=0;c<n_cols;c++) sum[c] = 0.0;
+			for(int p=0;p<factor;p++) {
+				double *win = dec->window + ((size_t)k*factor + p)*n_cols;
+				for(int c=0;c<n_cols;c++) sum[c] += win[c];
+			}
+		}
+	}
+
+	return done;
+}
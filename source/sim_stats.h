@@ -0,0 +1,63 @@
+/**
+  * @file sim_stats.h
+  * @brief Header file for sim_stats.c
+  * Streaming reducers of Simulation output rows: running statistics and decimation filter.
+*/
+
+#ifndef SIM_STATS_H
+#define SIM_STATS_H
+
+#define SIM_DECIMATOR_MAX_ORDER 4  ///< Maximum order of a Sim_Decimator
+
+/**
+ * Data structure storing running statistics of the columns of Simulation output rows
+ * (see Sim_Output_Row), updated every step: mean and variance (Welford's algorithm),
+ * mean square, minimum and maximum.
+ */
+typedef struct str_Sim_Stats {
+	int n_cols;       ///< Number of columns
+	long count;       ///< Number of rows accumulated
+	double *mean;     ///< Running mean of each column
+	double *m2;       ///< Sum of squared deviations from the mean of each column
+	double *sum_sq;   ///< Sum of squares of each column
+	double *min, *max;
+} Sim_Stats;
+
+void Sim_Stats_Allocate_In(Sim_Stats *stats, int n_cols);
+void Sim_Stats_Deallocate(Sim_Stats *stats);
+void Sim_Stats_Reset(Sim_Stats *stats);
+void Sim_Stats_Update(Sim_Stats *stats, const double *row);
+
+double Sim_Stats_Mean(Sim_Stats *stats, int col);
+double Sim_Stats_Variance(Sim_Stats *stats, int col);
+double Sim_Stats_Std(Sim_Stats *stats, int col);
+double Sim_Stats_RMS(Sim_Stats *stats, int col);
+double Sim_Stats_Min(Sim_Stats *stats, int col);
+double Sim_Stats_Max(Sim_Stats *stats, int col);
+
+/**
+ * Data structure storing a decimation filter of Simulation output rows:
+ * equivalent to a CIC decimator of the given order (cascade of order boxcar averages
+ * of length factor, output every factor rows), with unity DC gain.
+ * The first order-1 boxcars are sliding windows; the last one is a block average.
+ * Columns that must not be averaged (time, wrapped phases) are sampled and held instead,
+ * see Sim_Decimator_Set_Hold.
+ */
+typedef struct str_Sim_Decimator {
+	int n_cols;        ///< Number of columns
+	int order;         ///< Number of boxcar stages (1: block average)
+	int factor;        ///< Decimation factor (boxcar length)
+	int pos;           ///< Position in the sliding windows
+	int count;         ///< Number of rows in the current block
+	double *window;    ///< Sliding windows ((order-1)*factor*n_cols values)
+	double *sum;       ///< Running sums of the sliding windows ((order-1)*n_cols values)
+	double *acc;       ///< Block accumulator (n_cols values)
+	char *hold;        ///< Per-column flag: sample-and-hold instead of filtering (n_cols values)
+} Sim_Decimator;
+
+void Sim_Decimator_Allocate_In(Sim_Decimator *dec, int n_cols, int order, int factor);
+void Sim_Decimator_Deallocate(Sim_Decimator *dec);
+void Sim_Decimator_Set_Hold(Sim_Decimator *dec, int col);
+int Sim_Decimator_Step(Sim_Decimator *dec, const double *in, double *out);
+
+#endif
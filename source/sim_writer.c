@@ -0,0 +1,145 @@
+/**
+ * @file sim_writer.c
+ * @brief Simulation output writer: output rows are copied into a lock-free single-producer
+ * single-consumer ring of pre-allocated blocks, and a background thread formats and writes
+ * full blocks to file, so that storage I/O overlaps the Simulation steps instead of stalling them.
+ * Rows are written in order, with the same format as the synchronous output (see Write_Sim_Row).
+ */
+
+#include "sim_writer.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Back off while waiting for the other side of the ring: spin, yield, then sleep. */
+static void Sim_Writer_Wait(int *spins)
+{
+	if(++(*spins) < SIM_WRITER_SPINS) return;
+	if(*spins < 2*SIM_WRITER_SPINS) { sched_yield(); return; }
+
+	struct timespec ts = {0, SIM_WRITER_SLEEP_NS};
+	nanosleep(&ts, NULL);
+}
+
+/** Writer thread: write published blocks to file until stopped and the ring is drained. */
+static void *Sim_Writer_Thread(void *arg)
+{
+	Sim_Writer *writer = (Sim_Writer *)arg;
+	size_t block_size = (size_t)SIM_WRITER_BLOCK_ROWS*writer->n_cols;
+	unsigned tail = writer->tail;
+	int spins = 0;
+
+	for(;;) {
+		if(tail == __atomic_load_n(&writer->head, __ATOMIC_ACQUIRE)) {
+			// Blocks are published before stop is set: check the ring again once stopped
+			if(__atomic_load_n(&writer->stop, __ATOMIC_ACQUIRE)) {
+				if(tail == __atomic_load_n(&writer->head, __ATOMIC_ACQUIRE)) break;
+			}
+			else {
+				Sim_Writer_Wait(&spins);
+				continue;
+			}
+		}
+		spins = 0;
+
+		int b = tail % writer->depth;
+		double *rows = writer->rows + b*block_size;
+		if(writer->format == SIM_OUTPUT_BINARY) {
+			Write_Sim_Rows_Binary(writer->fp, rows, writer->n_rows[b], writer->n_cols);
+		}
+		else {
+			for(int r=0;r<writer->n_rows[b];r++) Write_Sim_Row(writer->fp, rows + r*writer->n_cols, writer->n_linacs);
+		}
+
+		// Hand the block back to the producer
+		__atomic_store_n(&writer->tail, ++tail, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+/** Allocates a Sim_Writer for the output FILE of a Simulation and starts its writer thread.
+  * The ring holds depth blocks of SIM_WRITER_BLOCK_ROWS rows (formatted according to sim->output_format).
+  * Returns a pointer to the newly allocated struct, or NULL if the thread can not be started. */
+Sim_Writer *Sim_Writer_Allocate_New(
+	FILE *fp,				///< Output FILE (header, if any, already written)
+	Simulation *sim,		///< Pointer to Simulation (output format and machine layout)
+	int depth,			///< Number of blocks in the ring
+	int policy			///< Policy when the ring is full: SIM_OUTPUT_BLOCK (wait) or SIM_OUTPUT_DROP (drop and count rows)
+	)
+{
+	Sim_Writer *writer = calloc(1, sizeof(Sim_Writer));
+
+	writer->fp = fp;
+	writer->format = sim->output_format;
+	writer->policy = policy;
+	writer->n_linacs = sim->n_linacs;
+	writer->n_cols = Sim_Output_Columns(sim);
+	writer->depth = depth > 0 ? depth : 1;
+
+	writer->rows = calloc((size_t)writer->depth*SIM_WRITER_BLOCK_ROWS*writer->n_cols, sizeof(double));
+	writer->n_rows = calloc(writer->depth, sizeof(int));
+
+	if(pthread_create(&writer->thread, NULL, Sim_Writer_Thread, writer) != 0) {
+		free(writer->rows);
+		free(writer->n_rows);
+		free(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+/** Publish the block being filled to the writer thread. */
+static void Sim_Writer_Publish(Sim_Writer *writer)
+{
+	writer->n_rows[writer->head % writer->depth] = writer->fill;
+	writer->fill = 0;
+	__atomic_store_n(&writer->head, writer->head+1, __ATOMIC_RELEASE);
+}
+
+/** Append a Simulation output row (see Sim_Output_Row) to the output ring.
+  * If the ring is full, either wait for the writer thread (SIM_OUTPUT_BLOCK)
+  * or drop the row and count it (SIM_OUTPUT_DROP). */
+void Sim_Writer_Push(
+	Sim_Writer *writer,		///< Pointer to Sim_Writer
+	const double *row			///< Output row (Sim_Output_Columns values)
+	)
+{
+	// Starting a new block: it must have been written by the writer thread
+	if(writer->fill == 0) {
+		int spins = 0;
+		while(writer->head - __atomic_load_n(&writer->tail, __ATOMIC_ACQUIRE) >= (unsigned)writer->depth) {
+			if(writer->policy == SIM_OUTPUT_DROP) {
+				writer->dropped++;
+				return;
+			}
+			Sim_Writer_Wait(&spins);
+		}
+	}
+
+	size_t block_size = (size_t)SIM_WRITER_BLOCK_ROWS*writer->n_cols;
+	double *slot = writer->rows + (writer->head % writer->depth)*block_size + writer->fill*writer->n_cols;
+	memcpy(slot, row, writer->n_cols*sizeof(double));
+
+	if(++writer->fill == SIM_WRITER_BLOCK_ROWS) Sim_Writer_Publish(writer);
+}
+
+/** Flushes the output ring, stops the writer thread and frees memory of a Sim_Writer struct
+  * (the output FILE is not closed). Returns the number of rows dropped. */
+long Sim_Writer_Deallocate(Sim_Writer *writer)
+{
+	long dropped = writer->dropped;
+
+	if(writer->fill > 0) Sim_Writer_Publish(writer);
+	__atomic_store_n(&writer->stop, 1, __ATOMIC_RELEASE);
+	pthread_join(writer->thread, NULL);
+
+	free(writer->rows);
+	free(writer->n_rows);
+	free(writer);
+
+	return dropped;
+}
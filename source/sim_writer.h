@@ -0,0 +1,49 @@
+/**
+  * @file sim_writer.h
+  * @brief Header file for sim_writer.c
+  * Asynchronous output of Simulation results: a background thread writes output rows to file.
+*/
+
+#ifndef SIM_WRITER_H
+#define SIM_WRITER_H
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include "simulation_top.h"
+
+#define SIM_WRITER_CACHE_LINE 64     ///< Alignment of the ring indices (avoids false sharing)
+#define SIM_WRITER_BLOCK_ROWS 256    ///< Number of output rows per block of the ring
+#define SIM_WRITER_SPINS 4096        ///< Spin iterations before a waiting thread backs off
+#define SIM_WRITER_SLEEP_NS 50000    ///< Back-off sleep of a waiting thread in nanoseconds
+
+/**
+ * Data structure storing an asynchronous Simulation output writer:
+ * a single-producer single-consumer ring of depth pre-allocated blocks of output rows.
+ * The Simulation loop (producer) fills blocks with Sim_Writer_Push and the writer thread (consumer)
+ * formats and writes full blocks to file (see Sim_Writer_Allocate_New).
+ */
+typedef struct str_Sim_Writer {
+	FILE *fp;                  ///< Output FILE
+	int format;                ///< SIM_OUTPUT_TEXT or SIM_OUTPUT_BINARY
+	int policy;                ///< Policy when the ring is full: SIM_OUTPUT_BLOCK or SIM_OUTPUT_DROP
+	int n_linacs, n_cols;      ///< Output row layout (see Sim_Output_Columns)
+	int depth;                 ///< Number of blocks in the ring
+
+	double *rows;              ///< Ring blocks (depth*SIM_WRITER_BLOCK_ROWS*n_cols values)
+	int *n_rows;               ///< Number of rows in each block
+	int fill;                  ///< Number of rows in the block being filled (producer only)
+	long dropped;              ///< Number of rows dropped because the ring was full (producer only)
+
+	pthread_t thread;
+
+	unsigned head __attribute__((aligned(SIM_WRITER_CACHE_LINE)));  ///< Number of blocks published by the producer
+	unsigned tail __attribute__((aligned(SIM_WRITER_CACHE_LINE)));  ///< Number of blocks written by the consumer
+	int stop;                  ///< Set by the producer once the last block has been published
+} Sim_Writer;
+
+Sim_Writer *Sim_Writer_Allocate_New(FILE *fp, Simulation *sim, int depth, int policy);
+long Sim_Writer_Deallocate(Sim_Writer *writer);
+void Sim_Writer_Push(Sim_Writer *writer, const double *row);
+
+#endif
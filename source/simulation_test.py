@@ -5,7 +5,38 @@ Unit tests for step functions in Simulation Top Level.
 
 import accelerator as acc
 
+import json
 import numpy as np
+import os
+import shutil
+import tempfile
+
+## Configuration files of the Simulation used by the unit tests
+test_files = [
+    "source/configfiles/unit_tests/doublecompress_test.json",
+    "source/configfiles/unit_tests/simulation_test.json"
+]
+
+def Get_Test_Simulation(time_steps):
+    """ Return the unit test Simulation (test_files), set to run for time_steps. """
+
+    from get_configuration import Get_SWIG_Simulation
+
+    sim = Get_SWIG_Simulation(test_files, Verbose=False)
+    sim.C_Pointer.time_steps = time_steps
+
+    return sim
+
+class Test_Output_Dir:
+    """ Temporary directory for the output files of a unit test,
+    removed with its contents at the end of the with statement. """
+
+    def __enter__(self):
+        self.path = tempfile.mkdtemp(prefix="simulation_test_")
+        return self.path
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        shutil.rmtree(self.path)
 
 def run_Simulation_test(Tmax, test_files):
 
@@ -38,18 +69,605 @@ def unit_Simulation():
 
     Tmax = 0.5
 
-    test_files = [
-        "source/configfiles/unit_tests/doublecompress_test.json",
-        "source/configfiles/unit_tests/simulation_test.json"
-    ]
-
     run_Simulation_test(Tmax, test_files)
 
+def unit_Simulation_threads(n_threads=4, time_steps=2000):
+    """
+    Unit test for the Simulation thread pool (sim_pool.c/h):
+    run the same Simulation serially and with n_threads threads stepping Cryomodules.
+    PASS if both runs produce identical output files.
+    """
+
+    outputs = []
+    with Test_Output_Dir() as out_dir:
+        for threads in [1, n_threads]:
+            sim = Get_Test_Simulation(time_steps)
+            sim.C_Pointer.n_threads = threads
+
+            out_filename = os.path.join(out_dir, "out_threads%d.dat" % threads)
+            acc.Simulation_Run(sim.C_Pointer, sim.State, out_filename, 1)
+            with open(out_filename) as f:
+                outputs.append(f.read())
+
+    return outputs[0] == outputs[1]
+
+def unit_Simulation_reset(time_steps=2000):
+    """
+    Unit test for the Simulation State arena (state_arena.c/h):
+    run a Simulation, restore its initial State with Sim_State_Reset and run it again.
+    PASS if both runs produce identical output files.
+    """
+
+    sim = Get_Test_Simulation(time_steps)
+
+    outputs = []
+    with Test_Output_Dir() as out_dir:
+        for run in range(2):
+            out_filename = os.path.join(out_dir, "out_reset%d.dat" % run)
+            acc.Simulation_Run(sim.C_Pointer, sim.State, out_filename, 1)
+            with open(out_filename) as f:
+                outputs.append(f.read())
+            acc.Sim_State_Reset(sim.State)
+
+    return outputs[0] == outputs[1]
+
+def unit_Simulation_binary(time_steps=2000):
+    """
+    Unit test for the binary Simulation output format (Write_Sim_Header/Write_Sim_Step_Binary):
+    run the same Simulation with text and binary output, and read both back (plotting.plotdata).
+    PASS if both files contain the same columns and values.
+    """
+
+    from plotting import plotdata as pd
+
+    data = []
+    with Test_Output_Dir() as out_dir:
+        for output_format in [acc.SIM_OUTPUT_TEXT, acc.SIM_OUTPUT_BINARY]:
+            sim = Get_Test_Simulation(time_steps)
+            sim.C_Pointer.output_format = output_format
+
+            out_filename = os.path.join(out_dir, "out_format%d.dat" % output_format)
+            acc.Simulation_Run(sim.C_Pointer, sim.State, out_filename, 1)
+            n_cols = acc.Sim_Output_Columns(sim.C_Pointer)
+            data.append(pd.Load_Columns(out_filename, tuple(range(n_cols))))
+
+        names, binary = pd.Load_Binary_Data(out_filename)
+
+        # Compared before the (memory-mapped) files are removed
+        binary_pass = (data[0].shape == data[1].shape) & np.array_equal(data[0], data[1]) \
+            & (len(names) == binary.shape[1]) & (names[0] == 't')
+
+    return binary_pass
+
+def unit_Simulation_async(output_depth=4, time_steps=2000):
+    """
+    Unit test for the asynchronous Simulation output writer (sim_writer.c/h):
+    run the same Simulation with synchronous output and with a writer thread (blocking policy).
+    PASS if both runs produce identical output files and no rows are dropped.
+    """
+
+    outputs = []
+    dropped = 0
+    with Test_Output_Dir() as out_dir:
+        for depth in [0, output_depth]:
+            sim = Get_Test_Simulation(time_steps)
+            sim.C_Pointer.output_depth = depth
+            sim.C_Pointer.output_policy = acc.SIM_OUTPUT_BLOCK
+
+            out_filename = os.path.join(out_dir, "out_async%d.dat" % depth)
+            acc.Simulation_Run(sim.C_Pointer, sim.State, out_filename, 1)
+            dropped += sim.State.output_dropped
+            with open(out_filename) as f:
+                outputs.append(f.read())
+
+    return (outputs[0] == outputs[1]) & (dropped == 0)
+
+def unit_Simulation_drop(time_steps=4000, stall=2.0):
+    """
+    Unit test for the dropping policy of the asynchronous output writer (sim_writer.c/h, SIM_OUTPUT_DROP):
+    write the output (single block ring) to a FIFO whose reader stalls for the given number of seconds
+    before draining it, so that the writer thread blocks and the ring fills up.
+    PASS if rows are dropped, the rows written and dropped add up to those of a synchronous run,
+    and the rows written are rows of the synchronous run, in order.
+    """
+
+    import subprocess
+
+    with Test_Output_Dir() as out_dir:
+        sim = Get_Test_Simulation(time_steps)
+        sync_filename = os.path.join(out_dir, "out_sync.dat")
+        acc.Simulation_Run(sim.C_Pointer, sim.State, sync_filename, 1)
+        with open(sync_filename) as f:
+            sync_rows = f.read().splitlines()
+
+        # Reader opens the FIFO at once (unblocking the Simulation), but only reads after stalling
+        fifo = os.path.join(out_dir, "out_fifo")
+        drop_filename = os.path.join(out_dir, "out_drop.dat")
+        os.mkfifo(fifo)
+        reader = subprocess.Popen(["sh", "-c", 'exec 3<"$0"; sleep "$2"; cat <&3 > "$1"', fifo, drop_filename, str(stall)])
+
+        sim = Get_Test_Simulation(time_steps)
+        sim.C_Pointer.output_depth = 1
+        sim.C_Pointer.output_policy = acc.SIM_OUTPUT_DROP
+        acc.Simulation_Run(sim.C_Pointer, sim.State, fifo, 1)
+        dropped = sim.State.output_dropped
+        reader.wait()
+        with open(drop_filename) as f:
+            drop_rows = f.read().splitlines()
+
+    # Rows written are a subsequence of the synchronous rows
+    k = 0
+    for row in drop_rows:
+        while k < len(sync_rows) and sync_rows[k] != row:
+            k += 1
+        k += 1
+    order_pass = k <= len(sync_rows)
+
+    print '  {0} rows written, {1} dropped, out of {2}'.format(len(drop_rows), dropped, len(sync_rows))
+
+    return (dropped > 0) & (len(drop_rows) + dropped == len(sync_rows)) & order_pass
+
+def unit_Simulation_buffer(time_steps=2000, OUTPUTFREQ=3):
+    """
+    Unit test for Simulation runs recorded in memory (Simulation_Run_Buffer/Simulation_Run_Array):
+    run the same Simulation to a binary output file, to an engine-allocated NumPy array
+    and to a caller-provided NumPy array.
+    PASS if the three records are identical.
+    """
+
+    from plotting import plotdata as pd
+
+    sim = Get_Test_Simulation(time_steps)
+    sim.C_Pointer.output_format = acc.SIM_OUTPUT_BINARY
+
+    with Test_Output_Dir() as out_dir:
+        out_filename = os.path.join(out_dir, "out_buffer.dat")
+        acc.Simulation_Run(sim.C_Pointer, sim.State, out_filename, OUTPUTFREQ)
+        names, from_file = pd.Load_Binary_Data(out_filename)
+        # Copy of the (memory-mapped) file
+        from_file = np.array(from_file)
+
+    acc.Sim_State_Reset(sim.State)
+    from_engine = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, OUTPUTFREQ)
+
+    acc.Sim_State_Reset(sim.State)
+    from_caller = np.zeros((acc.Sim_Output_Rows(sim.C_Pointer, OUTPUTFREQ), acc.Sim_Output_Columns(sim.C_Pointer)))
+    n_rows = acc.Simulation_Run_Buffer(sim.C_Pointer, sim.State, from_caller, OUTPUTFREQ)
+
+    return (n_rows == from_file.shape[0]) & np.array_equal(from_file, from_engine) \
+        & np.array_equal(from_file, from_caller)
+
+def unit_Simulation_stats(time_steps=2000, stats_skip=100, factor=10):
+    """
+    Unit test for the streaming reducers of Simulation output (sim_stats.c/h):
+    compare the statistics accumulated every step and the block-average decimation filter
+    with the same quantities computed with NumPy from a record of every step
+    (time and phase columns are sampled at the end of each block, not averaged).
+    PASS if they agree to within rounding errors.
+    """
+
+    sim = Get_Test_Simulation(time_steps)
+
+    # Record of every step
+    full = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)
+
+    # Streaming statistics
+    acc.Sim_State_Reset(sim.State)
+    sim.C_Pointer.output_stats = 1
+    sim.C_Pointer.stats_skip = stats_skip
+    acc.Simulation_Run(sim.C_Pointer, sim.State, None, 1)
+    sim.C_Pointer.output_stats = 0
+
+    stats = sim.State.stats
+    n_cols = full.shape[1]
+    mean = np.array([acc.Sim_Stats_Mean(stats, c) for c in range(n_cols)])
+    std = np.array([acc.Sim_Stats_Std(stats, c) for c in range(n_cols)])
+    rms = np.array([acc.Sim_Stats_RMS(stats, c) for c in range(n_cols)])
+
+    steady = full[stats_skip:]
+    scale = np.abs(steady).max(axis=0) + np.spacing(1)
+    stats_pass = (stats.count == steady.shape[0]) \
+        & np.all(np.abs(mean - steady.mean(axis=0)) < 1e-12*scale) \
+        & np.all(np.abs(std - steady.std(axis=0)) < 1e-12*scale) \
+        & np.all(np.abs(rms - np.sqrt((steady**2).mean(axis=0))) < 1e-12*scale)
+
+    # Block-average decimation (filter order 1)
+    acc.Sim_State_Reset(sim.State)
+    sim.C_Pointer.output_decimation = 1
+    decimated = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, factor)
+    sim.C_Pointer.output_decimation = 0
+
+    n_rows = time_steps//factor
+    blocks = full[:n_rows*factor].reshape(n_rows, factor, n_cols).mean(axis=1)
+    held = [acc.Sim_Output_Column(sim.C_Pointer, "t")]
+    for l in range(sim.C_Pointer.n_linacs):
+        for name in ["error_vol_p", "cav_voltage_p", "fpga_drive_p"]:
+            held.append(acc.Sim_Output_Column(sim.C_Pointer, "{0}[{1}]".format(name, l)))
+    blocks[:, held] = full[factor-1:n_rows*factor:factor][:, held]
+    decimation_pass = (decimated.shape == blocks.shape) \
+        & np.all(np.abs(decimated - blocks) < 1e-12*(np.abs(blocks) + np.spacing(1)))
+
+    return stats_pass & decimation_pass
+
+def unit_Simulation_decimator_phase(n_rows=400, order=3, factor=10, rate=7.0):
+    """
+    Unit test for the sample-and-hold columns of the decimation filter (sim_stats.c/h):
+    feed a phase in degrees rotating through the +/-180 degree wrap and a constant amplitude.
+    PASS if the phase is passed through (last sample of each block, never an average across the wrap)
+    while the amplitude is filtered to its DC value once the filter has filled up.
+    """
+
+    k = np.arange(n_rows)
+    phase = np.mod(150.0 + rate*k + 180.0, 360.0) - 180.0
+
+    dec = acc.Sim_Decimator()
+    acc.Sim_Decimator_Allocate_In(dec, 2, order, factor)
+    acc.Sim_Decimator_Set_Hold(dec, 0)
+
+    row_in = acc.double_Array(2)
+    row_out = acc.double_Array(2)
+    out = []
+    for n in range(n_rows):
+        row_in[0] = phase[n]
+        row_in[1] = 1.0
+        if acc.Sim_Decimator_Step(dec, row_in, row_out):
+            out.append([row_out[0], row_out[1]])
+    acc.Sim_Decimator_Deallocate(dec)
+    out = np.array(out)
+
+    # The input phase does cross +/-180 degrees
+    wrap_pass = np.any(np.abs(np.diff(phase)) > 180.0)
+    hold_pass = (out.shape[0] == n_rows//factor) \
+        & np.array_equal(out[:, 0], phase[factor-1::factor])
+    filter_pass = np.all(np.abs(out[order:, 1] - 1.0) < 1e-12)
+
+    return wrap_pass & hold_pass & filter_pass
+
+def unit_Simulation_psd(time_steps=4096, n_fft=256):
+    """
+    Unit test for the online power spectral density estimation (sim_psd.c/h):
+    compare the PSDs estimated during a Simulation run with scipy.signal.welch
+    applied to a record of every step.
+    PASS if they agree to within rounding errors.
+    """
+
+    from scipy import signal
+
+    sim = Get_Test_Simulation(time_steps)
+    Tstep = sim.C_Pointer.Tstep
+
+    # Record of every step
+    full = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)
+
+    names = ["dQ_Q", "dE_E[0]", "error_vol_p[0]"]
+    cols = np.array([acc.Sim_Output_Column(sim.C_Pointer, name) for name in names], dtype=np.intc)
+    acc.Sim_State_Reset(sim.State)
+    acc.Sim_State_Set_PSD(sim.State, sim.C_Pointer, cols, n_fft, acc.SIM_PSD_HANN)
+    acc.Simulation_Run(sim.C_Pointer, sim.State, None, 1)
+
+    psd = sim.State.psd
+    n_bins = acc.Sim_PSD_Bins(psd)
+    freq = np.array([acc.Sim_PSD_Frequency(psd, k) for k in range(n_bins)])
+
+    psd_pass = True
+    for s, col in enumerate(cols):
+        f_ref, p_ref = signal.welch(full[:, col], fs=1.0/Tstep, window='hann', nperseg=n_fft)
+        p = np.array([acc.Sim_PSD_Value(psd, s, k) for k in range(n_bins)])
+        psd_pass = psd_pass & np.allclose(freq, f_ref) \
+            & np.all(np.abs(p - p_ref) < 1e-9*(np.abs(p_ref).max() + np.spacing(1)))
+
+    acc.Sim_State_Set_PSD(sim.State, sim.C_Pointer, np.zeros(0, dtype=np.intc), 0, 0)
+
+    return psd_pass
+
+def run_Simulation_checkpoint(sim, split, OUTPUTFREQ=1):
+    """ Run a Simulation from its initial State up to step split, save its State, load it into a newly
+    allocated State and run the rest. Returns the record and whether the State was saved and loaded. """
+
+    time_steps = sim.C_Pointer.time_steps
+
+    with Test_Output_Dir() as out_dir:
+        checkpoint = os.path.join(out_dir, "out_checkpoint.bin")
+
+        # First part, then save
+        acc.Sim_State_Reset(sim.State)
+        sim.C_Pointer.time_steps = split
+        first = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, OUTPUTFREQ)
+        save_pass = acc.Sim_State_Save(checkpoint, sim.State) == 0
+
+        # Rest from the checkpoint, in a new State
+        sim.C_Pointer.time_steps = time_steps
+        load_pass = acc.Sim_State_Load(checkpoint, sim.Get_State_Pointer()) == 0
+        second = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, OUTPUTFREQ)
+
+    return np.vstack((first, second)), save_pass & load_pass
+
+def unit_Simulation_checkpoint(time_steps=2000, order=3, factor=7, window=300):
+    """
+    Unit test for Simulation State checkpoints (Sim_State_Save/Sim_State_Load):
+    run a Simulation uninterrupted; run it again up to half-way, save its State,
+    load it into a newly allocated State and run the rest. Repeat with a decimation filter of the output
+    (resuming in the middle of a block) and with early termination (resuming in the middle of the window it stops at).
+    PASS if the resumed runs continue the uninterrupted ones bit-for-bit.
+    """
+
+    sim = Get_Test_Simulation(time_steps)
+    full = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)
+
+    resumed, io_pass = run_Simulation_checkpoint(sim, time_steps/2)
+    plain_pass = io_pass & (sim.State.step == time_steps) & np.array_equal(full, resumed)
+
+    # Early termination, with an error tolerance some window meets
+    cols = [acc.Sim_Output_Column(sim.C_Pointer, "{0}[{1}]".format(name, l))
+        for l in range(sim.C_Pointer.n_linacs) for name in ["error_vol_a", "error_vol_p"]]
+    n_win = time_steps//window
+    ranges = np.ptp(full[:n_win*window, cols].reshape(n_win, window, len(cols)), axis=1).max(axis=1)
+    sim.C_Pointer.conv_window = window
+    sim.C_Pointer.conv_error_tol = 2.0*ranges.min()
+
+    acc.Sim_State_Reset(sim.State)
+    early = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)
+    stop = sim.State.step
+
+    resumed, io_pass = run_Simulation_checkpoint(sim, stop - window/2)
+    convergence_pass = io_pass & (sim.State.stop_reason == acc.SIM_STOP_CONVERGED) & (sim.State.step == stop) \
+        & (stop < time_steps) & np.array_equal(early, resumed)
+    sim.C_Pointer.conv_window = 0
+
+    # Decimation filter of the output, part of the State allocated for it
+    sim.C_Pointer.output_decimation = order
+    sim.C_Pointer.output_freq = factor
+    sim.Get_State_Pointer()
+    decimated = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, factor)
+
+    split = (time_steps/2//factor)*factor + factor/2
+    resumed, io_pass = run_Simulation_checkpoint(sim, split, factor)
+    decimation_pass = io_pass & (decimated.shape[0] == time_steps//factor) & np.array_equal(decimated, resumed)
+
+    return plain_pass & convergence_pass & decimation_pass
+
+def unit_Simulation_warm_start(steps=2000, time_steps=1000, window=100):
+    """
+    Unit test for the warm-start State cache (readjson_accelerator Simulation.Warm_Start):
+    settle a Simulation (cache miss) with early termination configured, settle the same configuration
+    again (cache hit), then once more after truncating the cached State (failed load).
+    PASS if the warm-up runs all its steps, the cached State is found, no temporary files are left
+    and all Simulations produce identical records.
+    """
+
+    records = []
+    with Test_Output_Dir() as cache_dir:
+        for run in range(3):
+            sim = Get_Test_Simulation(time_steps)
+            if run == 0:
+                # Tolerances every step meets: the warm-up must not stop early
+                sim.C_Pointer.conv_window = window
+                sim.C_Pointer.conv_error_tol = 1e3
+                sim.C_Pointer.conv_voltage_tol = 1e3
+            sim.Warm_Start(steps, cache_dir)
+            sim.C_Pointer.conv_window = 0
+            records.append(acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1))
+
+            base = os.path.join(cache_dir, sim.config_hash)
+            if run == 0:
+                with open(base + ".json") as f:
+                    info = json.load(f)
+                steps_pass = (info["steps"] == steps) & (info["step"] == steps)
+            if run == 1:
+                cached = os.path.isfile(base + ".state")
+                # Keep the header and part of the State: Sim_State_Load fails half-way
+                with open(base + ".state", "rb") as f:
+                    data = f.read()
+                with open(base + ".state", "wb") as f:
+                    f.write(data[:len(data)//2])
+
+        clean = sorted(os.listdir(cache_dir)) == sorted([sim.config_hash + ".json", sim.config_hash + ".state"])
+
+    return steps_pass & cached & clean & (records[0].shape[0] == time_steps) \
+        & np.array_equal(records[0], records[1]) & np.array_equal(records[0], records[2])
+
+def unit_Simulation_steady_state(time_steps=1000):
+    """
+    Unit test for the analytic steady state (Sim_State_Set_Steady_State):
+    run a Simulation from its cold initial State and from its steady state.
+    PASS if the steady state is reached, and the Linac amplitude errors start (and stay)
+    at their settled values instead of filling from an empty cavity.
+    """
+
+    sim = Get_Test_Simulation(time_steps)
+    cols = [acc.Sim_Output_Column(sim.C_Pointer, "error_vol_a[{0}]".format(l)) for l in range(sim.C_Pointer.n_linacs)]
+
+    cold = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)[:, cols]
+
+    acc.Sim_State_Reset(sim.State)
+    ret = acc.Sim_State_Set_Steady_State(sim.C_Pointer, sim.State)
+    steady = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)[:, cols]
+
+    # Deviation from the settled amplitude errors (end of the steady run)
+    settled = steady[-(time_steps//4):].mean(axis=0)
+    cold_dev = np.abs(cold - settled).max()
+    steady_dev = np.abs(steady - settled).max()
+
+    return (ret == 0) & (steady_dev < 0.01*cold_dev)
+
+def unit_Simulation_convergence(time_steps=2000, window=300):
+    """
+    Unit test for the early termination of Simulation_Run (Simulation.conv_window):
+    with tolerances every window meets, a run stops with SIM_STOP_CONVERGED after the first window of steps,
+    recording the beginning of the complete run; with tolerances no (noisy) window meets, it runs to the end.
+    PASS if both runs stop as expected.
+    """
+
+    sim = Get_Test_Simulation(time_steps)
+
+    full = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)
+    full_pass = (sim.State.stop_reason == acc.SIM_STOP_END) & (sim.State.step == time_steps)
+
+    # Every window settled
+    acc.Sim_State_Reset(sim.State)
+    sim.C_Pointer.conv_window = window
+    sim.C_Pointer.conv_error_tol = 1e3
+    sim.C_Pointer.conv_voltage_tol = 1e3
+    early = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)
+    early_pass = (sim.State.stop_reason == acc.SIM_STOP_CONVERGED) & (sim.State.step == window)
+    early_pass = early_pass & np.array_equal(early, full[:window])
+
+    # No window settled (LLRF noise moves the errors every step)
+    acc.Sim_State_Reset(sim.State)
+    sim.C_Pointer.conv_error_tol = 1e-300
+    sim.C_Pointer.conv_voltage_tol = 1e-300
+    late = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)
+    late_pass = (sim.State.stop_reason == acc.SIM_STOP_END) & np.array_equal(late, full)
+
+    return full_pass & early_pass & late_pass
+
+def unit_Simulation_settling(time_steps=20000, window=500):
+    """
+    Unit test for the early termination of Simulation_Run (Simulation.conv_window) from a cold start:
+    with an error tolerance above the noise floor of the settled operating point (twice the largest range
+    over the windows of the second half of a complete run), the run stops at the end of the first window
+    whose range is within it, once the cavities have filled.
+    PASS if the run stops at that window, well before time_steps, and records the beginning of the complete run.
+    """
+
+    sim = Get_Test_Simulation(time_steps)
+    cols = [acc.Sim_Output_Column(sim.C_Pointer, "{0}[{1}]".format(name, l))
+        for l in range(sim.C_Pointer.n_linacs) for name in ["error_vol_a", "error_vol_p"]]
+
+    full = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)
+
+    # Largest range of the errors over each window
+    n_win = time_steps//window
+    ranges = np.ptp(full[:n_win*window, cols].reshape(n_win, window, len(cols)), axis=1).max(axis=1)
+    tol = 2.0*ranges[n_win//2:].max()
+    stop = (np.nonzero(ranges <= tol)[0][0] + 1)*window
+
+    acc.Sim_State_Reset(sim.State)
+    sim.C_Pointer.conv_window = window
+    sim.C_Pointer.conv_error_tol = tol
+    sim.C_Pointer.conv_voltage_tol = 0.0
+    early = acc.Simulation_Run_Array(sim.C_Pointer, sim.State, 1)
+
+    return (ranges[0] > tol) & (sim.State.stop_reason == acc.SIM_STOP_CONVERGED) \
+        & (sim.State.step == stop) & (stop <= time_steps//4) & np.array_equal(early, full[:stop])
+
 def perform_tests():
     """
-    Perform all unit tests for simulation_top.c/h and return PASS boolean (qualitative test).
+    Perform all unit tests for simulation_top.c/h and return PASS/FAIL boolean.
     """
 
+    print "\n****\nTesting Simulation thread pool..."
+    threads_pass = unit_Simulation_threads()
+    if (threads_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation State reset..."
+    reset_pass = unit_Simulation_reset()
+    if (reset_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation binary output..."
+    binary_pass = unit_Simulation_binary()
+    if (binary_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation asynchronous output..."
+    async_pass = unit_Simulation_async()
+    if (async_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation asynchronous output (dropping policy)..."
+    drop_pass = unit_Simulation_drop()
+    if (drop_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation in-memory output..."
+    buffer_pass = unit_Simulation_buffer()
+    if (buffer_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation streaming statistics and decimation..."
+    stats_pass = unit_Simulation_stats()
+    if (stats_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation decimation of wrapped phases..."
+    phase_pass = unit_Simulation_decimator_phase()
+    if (phase_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation power spectral density estimation..."
+    psd_pass = unit_Simulation_psd()
+    if (psd_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation State checkpoints..."
+    checkpoint_pass = unit_Simulation_checkpoint()
+    if (checkpoint_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation warm-start State cache..."
+    warm_start_pass = unit_Simulation_warm_start()
+    if (warm_start_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation analytic steady state..."
+    steady_state_pass = unit_Simulation_steady_state()
+    if (steady_state_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation early termination..."
+    convergence_pass = unit_Simulation_convergence()
+    if (convergence_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
+    print "\n****\nTesting Simulation early termination from a cold start..."
+    settling_pass = unit_Simulation_settling()
+    if (settling_pass):
+        result = 'PASS'
+    else:
+        result = 'FAIL'
+    print ">>> " + result
+
     # This is not a PASS/FAIL test
     print "\n****\nTesting Simulation Top Level..."
     unit_Simulation()
@@ -58,7 +676,7 @@ def perform_tests():
     import matplotlib.pylab as plt
     plt.figure()
 
-    return True
+    return threads_pass & reset_pass & binary_pass & async_pass & drop_pass & buffer_pass & stats_pass & phase_pass & psd_pass & checkpoint_pass & warm_start_pass & steady_state_pass & convergence_pass & settling_pass
 
 if __name__ == "__main__":
     plt.close('all')
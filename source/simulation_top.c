@@ -6,6 +6,11 @@
  */
 
 #include "simulation_top.h"
+#include "sim_pool.h"
+#include "sim_writer.h"
+
+#include <stdint.h>
+#include <string.h>
 
 /** Takes a pointer to a Simulation which has been previously allocated and fills it in with the values passed as arguments.
 	* It assumes that the Linac Sections have been previously allocated and an array is being provided (same is the case with the Gun). */
@@ -23,6 +28,18 @@ void Sim_Allocate_In(
 	sim->gun = gun;
 	sim->linac_net = linac_net;
 	sim->n_linacs = n_linacs;
+	sim->seed = 0;
+	sim->n_threads = 1;
+	sim->output_format = SIM_OUTPUT_TEXT;
+	sim->output_depth = 0;
+	sim->output_policy = SIM_OUTPUT_BLOCK;
+	sim->output_decimation = 0;
+	sim->output_freq = 1;
+	sim->output_stats = 0;
+	sim->stats_skip = 0;
+	sim->conv_window = 0;
+	sim->conv_error_tol = 0.0;
+	sim->conv_voltage_tol = 0.0;
 }
 
 /** Allocates memory for a Simulation struct and fills it in with the values passed as arguments. Returns a pointer to the newly allocated struct. */
@@ -55,32 +72,336 @@ void Sim_Deallocate(Simulation *sim)
 	sim->n_linacs = 0;
 }
 
-/** Takes a previously configured Simulation and allocates its State struct accordingly. */
-void Sim_State_Allocate(Simulation_State *sim_state, Simulation *sim, Noise_Srcs* noise_srcs)
+/** Allocates (see State_Calloc) and resets the decimation filter of the output of a Simulation
+  * (order output_decimation) for the decimation factor OUTPUTFREQ. */
+static void Sim_Decimator_Build(Sim_Decimator *decimator, Simulation *sim, int OUTPUTFREQ)
+{
+	Sim_Decimator_Allocate_In(decimator, Sim_Output_Columns(sim), sim->output_decimation, OUTPUTFREQ);
+	// Time and wrapped phases (degrees) are sampled, not averaged
+	Sim_Decimator_Set_Hold(decimator, 0);
+	for(int l=0;l<sim->n_linacs;l++) {
+		int loc = SIM_OUTPUT_GLOBALS + SIM_OUTPUT_LOCALS*l;
+		Sim_Decimator_Set_Hold(decimator, loc + 1);		// error_vol_p
+		Sim_Decimator_Set_Hold(decimator, loc + 8);		// cav_voltage_p
+		Sim_Decimator_Set_Hold(decimator, loc + 10);	// fpga_drive_p
+	}
+}
+
+/** Allocates the States of a Simulation (recursively, through State_Calloc) and initializes them. */
+static void Sim_State_Build(Simulation_State *sim_state, Simulation *sim, Noise_Srcs* noise_srcs)
 {
 	// Allocate memory for the array of Linac states
-	sim_state->linac_state_net = calloc(sim->n_linacs, sizeof(Linac_State *));
+	sim_state->linac_state_net = State_Calloc(sim->n_linacs, sizeof(Linac_State *));
 
 	// Then allocate memory for the States themselves
  	for(int i=0;i<sim->n_linacs;i++) {
- 		sim_state->linac_state_net[i] = (Linac_State*)calloc(1,sizeof(Linac_State));
+ 		sim_state->linac_state_net[i] = (Linac_State*)State_Calloc(1,sizeof(Linac_State));
  		Linac_State_Allocate(sim_state->linac_state_net[i], sim->linac_net[i]);
  	}
 	// Allocate memory for the array of Linac amplitude and phase errors
-	sim_state->amp_error_net = (double*)calloc(sim->n_linacs,sizeof(double));
-	sim_state->phase_error_net = (double*)calloc(sim->n_linacs,sizeof(double));
+	sim_state->amp_error_net = (double*)State_Calloc(sim->n_linacs,sizeof(double));
+	sim_state->phase_error_net = (double*)State_Calloc(sim->n_linacs,sizeof(double));
 
 	// Allocate memory for Longitudinal beam dynamics noise sources
 	sim_state->noise_srcs = noise_srcs;
 
+	// Key random number streams: stream 0 for the correlated noise sources,
+	// then one per RF Station in machine order
+	Noise_RNG_Init(&noise_srcs->rng, sim->seed, 0);
+	uint32_t stream = 1;
+	for(int l=0;l<sim->n_linacs;l++) {
+		Linac *linac = sim->linac_net[l];
+		for(int c=0;c<linac->n_cryos;c++) {
+			Cryomodule *cryo = linac->cryo_net[c];
+			Cryomodule_State *cryo_state = sim_state->linac_state_net[l]->cryo_state_net[c];
+			for(int s=0;s<cryo->n_rf_stations;s++) {
+				Noise_RNG_Init(&cryo_state->rf_state_net[s]->rng, sim->seed, stream++);
+			}
+		}
+	}
+
 	// Allocate Doublecompress State
-	sim_state->dc_state =(Doublecompress_State*)calloc(1,sizeof(Doublecompress_State));
+	sim_state->dc_state =(Doublecompress_State*)State_Calloc(1,sizeof(Doublecompress_State));
 	Doublecompress_State_Allocate(sim_state->dc_state, sim->n_linacs);
+
+	// Streaming statistics of the output columns
+	sim_state->stats = State_Calloc(1, sizeof(Sim_Stats));
+	Sim_Stats_Allocate_In(sim_state->stats, Sim_Output_Columns(sim));
+
+	// Decimation filter of the output (if configured)
+	sim_state->decimator = NULL;
+	if(sim->output_decimation > 0) {
+		sim_state->decimator = State_Calloc(1, sizeof(Sim_Decimator));
+		Sim_Decimator_Build(sim_state->decimator, sim, sim->output_freq);
+	}
+
+	// Convergence monitor (see Sim_Step_Settled)
+	sim_state->conv = State_Calloc(1, sizeof(Sim_Conv_State));
+	sim_state->conv->count = 0;
+	sim_state->conv->lo = State_Calloc(4*sim->n_linacs, sizeof(double));
+	sim_state->conv->hi = State_Calloc(4*sim->n_linacs, sizeof(double));
+}
+
+/** Takes a previously configured Simulation and allocates its State struct accordingly.
+  * All States (Linacs, Cryomodules, RF Stations, Cavities, filters, buffers...) are placed in a single,
+  * cache-aligned State_Arena, in the order they are stepped: a sizing pass allocates them once
+  * on the heap to measure the arena, and they are then allocated again inside the arena.
+  * So are the statistics, the convergence monitor and, if Simulation.output_decimation is set,
+  * the decimation filter of the output for a decimation factor of Simulation.output_freq.
+  * The initial States are kept as the pristine image used by Sim_State_Reset. */
+void Sim_State_Allocate(Simulation_State *sim_state, Simulation *sim, Noise_Srcs* noise_srcs)
+{
+	State_Arena *arena = calloc(1, sizeof(State_Arena));
+
+	// Sizing pass
+	State_Arena_Begin(arena);
+	Sim_State_Build(sim_state, sim, noise_srcs);
+	State_Arena_End(arena);
+
+	// Allocation pass, preceded by one into a shadow block to map the pointers in the arena (see Sim_State_Save)
+	State_Arena *shadow = State_Arena_Shadow_New(arena);
+	State_Arena_Begin(shadow);
+	Sim_State_Build(sim_state, sim, noise_srcs);
+	State_Arena_End(shadow);
+
+	State_Arena_Begin(arena);
+	Sim_State_Build(sim_state, sim, noise_srcs);
+	State_Arena_End(arena);
+	State_Arena_Map_Pointers(arena, shadow);
+	State_Arena_Deallocate(shadow);
+	free(shadow);
+
+	sim_state->arena = arena;
+	sim_state->psd = NULL;
+	sim_state->step = 0;
+	Sim_State_Snapshot(sim_state);
+}
+
+/** Record the current Simulation State (including the correlated noise sources)
+  * as the one Sim_State_Reset restores, e.g. after configuring initial conditions. */
+void Sim_State_Snapshot(Simulation_State *sim_state)
+{
+	State_Arena_Snapshot(sim_state->arena);
+	sim_state->noise_srcs_pristine = *sim_state->noise_srcs;
+	sim_state->step_pristine = sim_state->step;
+}
+
+/** Restore the Simulation State recorded by Sim_State_Allocate (or the last Sim_State_Snapshot)
+  * without reallocating: one copy of the State arena and of the correlated noise sources. */
+void Sim_State_Reset(Simulation_State *sim_state)
+{
+	State_Arena_Reset(sim_state->arena);
+	*sim_state->noise_srcs = sim_state->noise_srcs_pristine;
+	sim_state->step = sim_state->step_pristine;
+	if(sim_state->psd != NULL) Sim_PSD_Reset(sim_state->psd);
+}
+
+/** Set a Simulation State to its steady state (operating point) with the current correlated noise sources held:
+  * every Linac at the steady state of its RF Stations and Mechanical modes (see Linac_Set_Steady_State),
+  * iterated with Doublecompress until the timing jitter fed back to the Linacs settles
+  * (at most SIM_STEADY_ITER times), so that Simulation_Run starts without a warm-up transient.
+  * Call Sim_State_Snapshot afterwards for Sim_State_Reset to return to it.
+  * Returns 0 on success, or -1 if the steady state could not be reached within the configured limits. */
+int Sim_State_Set_Steady_State(
+	Simulation *sim,							///< Pointer to Simulation
+	Simulation_State *sim_state		///< Pointer to Simulation State
+	)
+{
+	double beam_charge = sim->gun->Q*(1.0+sim_state->noise_srcs->dQ_Q);
+	double delta_tz = *sim_state->dc_state->dt;
+	int iter, l, ret = -1;
+
+	for(iter=0;iter<SIM_STEADY_ITER;iter++) {
+		int linac_ret = 0;
+
+		for(l=0;l<sim->n_linacs;l++) linac_ret |= Linac_Set_Steady_State(sim->linac_net[l], sim_state->linac_state_net[l],
+			delta_tz, beam_charge, &sim_state->amp_error_net[l], &sim_state->phase_error_net[l]);
+
+		Doublecompress(sim->gun, sim->linac_net, sim->n_linacs,
+			sim_state->noise_srcs, sim_state->phase_error_net, sim_state->amp_error_net, sim_state->dc_state);
+
+		// Timing jitter seen by the Linacs on the next step
+		if(*sim_state->dc_state->dt == delta_tz || fabs(*sim_state->dc_state->dt - delta_tz) <= SIM_STEADY_TOL*fabs(delta_tz)) {
+			ret = linac_ret;
+			break;
+		}
+		delta_tz = *sim_state->dc_state->dt;
+	}
+
+	return ret;
+}
+
+/** Write the PSD accumulator of a Simulation State (if any) to a checkpoint FILE (see Sim_State_Save). */
+static int Sim_State_Save_PSD(FILE *fp, Sim_PSD *psd)
+{
+	int32_t header[3] = {0, 0, 0};
+	int64_t counts[2];
+
+	if(psd == NULL) return fwrite(header, sizeof(header), 1, fp) == 1 ? 0 : -1;
+
+	header[0] = psd->n_signals;
+	header[1] = psd->n_fft;
+	header[2] = psd->pos;
+	counts[0] = psd->n_samples;
+	counts[1] = psd->n_segments;
+	if(fwrite(header, sizeof(header), 1, fp) != 1 || fwrite(counts, sizeof(counts), 1, fp) != 1) return -1;
+	if(fwrite(psd->cols, sizeof(int), psd->n_signals, fp) != (size_t)psd->n_signals) return -1;
+	if(fwrite(psd->history, sizeof(double), (size_t)psd->n_signals*psd->n_fft, fp) != (size_t)psd->n_signals*psd->n_fft) return -1;
+	if(fwrite(psd->psd_sum, sizeof(double), (size_t)psd->n_signals*(psd->n_fft/2+1), fp) != (size_t)psd->n_signals*(psd->n_fft/2+1)) return -1;
+
+	return 0;
+}
+
+/** Read the PSD accumulator of a checkpoint FILE (see Sim_State_Save_PSD) into the one of a Simulation State,
+  * which must estimate the same signals with the same segment length. An accumulator in the file is skipped
+  * if the State has none (spectra are not estimated); a State accumulator missing from the file is reset. */
+static int Sim_State_Load_PSD(FILE *fp, Sim_PSD *psd)
+{
+	int32_t header[3];
+	int64_t counts[2];
+
+	if(fread(header, sizeof(header), 1, fp) != 1) return -1;
+	if(header[0] == 0) {
+		if(psd != NULL) Sim_PSD_Reset(psd);
+		return 0;
+	}
+	if(fread(counts, sizeof(counts), 1, fp) != 1) return -1;
+
+	int n_signals = header[0], n_fft = header[1];
+	if(psd == NULL) {
+		long skip = n_signals*(long)sizeof(int) + ((long)n_signals*n_fft + (long)n_signals*(n_fft/2+1))*(long)sizeof(double);
+		return fseek(fp, skip, SEEK_CUR) == 0 ? 0 : -1;
+	}
+	if(n_signals != psd->n_signals || n_fft != psd->n_fft) return -1;
+
+	int cols[n_signals];
+	if(fread(cols, sizeof(int), n_signals, fp) != (size_t)n_signals) return -1;
+	if(memcmp(cols, psd->cols, n_signals*sizeof(int)) != 0) return -1;
+	if(fread(psd->history, sizeof(double), (size_t)n_signals*n_fft, fp) != (size_t)n_signals*n_fft) return -1;
+	if(fread(psd->psd_sum, sizeof(double), (size_t)n_signals*(n_fft/2+1), fp) != (size_t)n_signals*(n_fft/2+1)) return -1;
+	psd->pos = header[2];
+	psd->n_samples = counts[0];
+	psd->n_segments = counts[1];
+
+	return 0;
+}
+
+/** Save the full Simulation State to a binary checkpoint file: States of every Linac, Cryomodule,
+  * RF Station and Cavity (filters, noise buffers, random number counters...), correlated noise sources,
+  * statistics, spectra, decimation filter of the output, convergence window and the number of steps completed. Layout (native byte order):
+  * SIM_STATE_MAGIC, uint32 SIM_STATE_VERSION, uint32 sizeof(Noise_Srcs), uint64 State layout fingerprint
+  * (see State_Arena_Layout), int64 step, Noise_Srcs, State arena (see State_Arena_Write) and PSD accumulator.
+  * Returns 0 on success, -1 on error. */
+int Sim_State_Save(
+	char * fname,									///< Checkpoint file name (string)
+	Simulation_State *sim_state		///< Pointer to Simulation State
+	)
+{
+	FILE *fp = fopen(fname, "wb");
+	if(fp == NULL) return -1;
+
+	uint32_t version[2] = {SIM_STATE_VERSION, sizeof(Noise_Srcs)};
+	uint64_t layout = State_Arena_Layout(sim_state->arena);
+	int64_t step = sim_state->step;
+
+	int err = fwrite(SIM_STATE_MAGIC, 1, 8, fp) != 8
+		|| fwrite(version, sizeof(version), 1, fp) != 1
+		|| fwrite(&layout, sizeof(layout), 1, fp) != 1
+		|| fwrite(&step, sizeof(step), 1, fp) != 1
+		|| fwrite(sim_state->noise_srcs, sizeof(Noise_Srcs), 1, fp) != 1
+		|| State_Arena_Write(sim_state->arena, fp) != 0
+		|| Sim_State_Save_PSD(fp, sim_state->psd) != 0;
+
+	if(fclose(fp) != 0) err = 1;
+	return err ? -1 : 0;
+}
+
+/** Restore a Simulation State saved by Sim_State_Save into one allocated by Sim_State_Allocate
+  * for the same Simulation (same machine layout, checked against the file). The following
+  * Simulation_Run continues from the saved step, bit-identical to an uninterrupted run
+  * (output decimation and convergence window included, see Sim_State_Allocate).
+  * Returns 0 on success, -1 if the file can not be read or does not match the Simulation State
+  * (which may then be partially overwritten: see Sim_State_Reset). */
+int Sim_State_Load(
+	char * fname,									///< Checkpoint file name (string)
+	Simulation_State *sim_state		///< Pointer to Simulation State
+	)
+{
+	FILE *fp = fopen(fname, "rb");
+	if(fp == NULL) return -1;
+
+	char magic[8];
+	uint32_t version[2];
+	uint64_t layout;
+	int64_t step;
+	Noise_Srcs noise_srcs;
+
+	int err = fread(magic, 1, 8, fp) != 8 || memcmp(magic, SIM_STATE_MAGIC, 8) != 0
+		|| fread(version, sizeof(version), 1, fp) != 1
+		|| version[0] != SIM_STATE_VERSION || version[1] != sizeof(Noise_Srcs)
+		|| fread(&layout, sizeof(layout), 1, fp) != 1 || layout != State_Arena_Layout(sim_state->arena)
+		|| fread(&step, sizeof(step), 1, fp) != 1
+		|| fread(&noise_srcs, sizeof(Noise_Srcs), 1, fp) != 1
+		|| State_Arena_Read(sim_state->arena, fp) != 0
+		|| Sim_State_Load_PSD(fp, sim_state->psd) != 0;
+
+	fclose(fp);
+	if(err) return -1;
+
+	*sim_state->noise_srcs = noise_srcs;
+	sim_state->step = (int)step;
+
+	return 0;
+}
+
+/** Enable (or reconfigure) the estimation of power spectral densities of output columns
+  * (see Sim_Output_Row and Sim_PSD) during Simulation_Run, with segments of n_fft steps
+  * (a power of 2) and the given window. With no columns, estimation is disabled.
+  * Returns 0 on success, or -1 if the columns or the segment length are not valid. */
+int Sim_State_Set_PSD(
+	Simulation_State *sim_state,	///< Pointer to Simulation State
+	Simulation *sim,							///< Pointer to Simulation
+	int *psd_cols,								///< Output columns of the signals
+	int n_psd_cols,								///< Number of signals
+	int n_fft,										///< Segment length (power of 2)
+	int window_type								///< SIM_PSD_RECT or SIM_PSD_HANN
+	)
+{
+	if(sim_state->psd != NULL) {
+		Sim_PSD_Deallocate(sim_state->psd);
+		free(sim_state->psd);
+		sim_state->psd = NULL;
+	}
+	if(n_psd_cols <= 0) return 0;
+
+	for(int s=0;s<n_psd_cols;s++) {
+		if(psd_cols[s] < 0 || psd_cols[s] >= Sim_Output_Columns(sim)) return -1;
+	}
+
+	Sim_PSD *psd = calloc(1, sizeof(Sim_PSD));
+	if(Sim_PSD_Allocate_In(psd, psd_cols, n_psd_cols, n_fft, window_type, sim->Tstep) != 0) {
+		free(psd);
+		return -1;
+	}
+	sim_state->psd = psd;
+
+	return 0;
 }
 
 /** Frees memory of Simulation State struct. */
 void Sim_State_Deallocate(Simulation_State *sim_state, Simulation *sim)
 {
+	Sim_State_Set_PSD(sim_state, sim, NULL, 0, 0, 0);
+
+	// States allocated in an arena are released with it
+	if(sim_state->arena != NULL) {
+		State_Arena_Deallocate(sim_state->arena);
+		free(sim_state->arena);
+		sim_state->arena = NULL;
+		free(sim_state->noise_srcs);
+		return;
+	}
+
  	for(int i=0;i<sim->n_linacs;i++) {
  		Linac_State_Deallocate(sim_state->linac_state_net[i], sim->linac_net[i]);
 	}
@@ -90,6 +411,15 @@ void Sim_State_Deallocate(Simulation_State *sim_state, Simulation *sim)
 	free(sim_state->noise_srcs);
 	Doublecompress_State_Deallocate(sim_state->dc_state);
 	free(sim_state->dc_state);
+	Sim_Stats_Deallocate(sim_state->stats);
+	free(sim_state->stats);
+	if(sim_state->decimator != NULL) {
+		Sim_Decimator_Deallocate(sim_state->decimator);
+		free(sim_state->decimator);
+	}
+	free(sim_state->conv->lo);
+	free(sim_state->conv->hi);
+	free(sim_state->conv);
 }
 
 /** Updates all correlated noise sources in the system,
@@ -97,12 +427,12 @@ void Sim_State_Deallocate(Simulation_State *sim_state, Simulation *sim)
 	and if ON, to generate different types of noise (see noise.c). */
 void Apply_Correlated_Noise(int t_now, double Tstep, Noise_Srcs * noise_srcs)
 {
-	Noise_Step(t_now, Tstep, noise_srcs->type[0], noise_srcs->settings+N_NOISE_SETTINGS*0, &noise_srcs->dQ_Q);
-	Noise_Step(t_now, Tstep, noise_srcs->type[1], noise_srcs->settings+N_NOISE_SETTINGS*1, &noise_srcs->dtg);
-	Noise_Step(t_now, Tstep, noise_srcs->type[2], noise_srcs->settings+N_NOISE_SETTINGS*2, &noise_srcs->dE_ing);
-	Noise_Step(t_now, Tstep, noise_srcs->type[3], noise_srcs->settings+N_NOISE_SETTINGS*3, &noise_srcs->dsig_z);
-	Noise_Step(t_now, Tstep, noise_srcs->type[4], noise_srcs->settings+N_NOISE_SETTINGS*4, &noise_srcs->dsig_E);
-	Noise_Step(t_now, Tstep, noise_srcs->type[5], noise_srcs->settings+N_NOISE_SETTINGS*5, &noise_srcs->dchirp);
+	Noise_Step(t_now, Tstep, noise_srcs->type[0], noise_srcs->settings+N_NOISE_SETTINGS*0, &noise_srcs->rng, 0, &noise_srcs->dQ_Q);
+	Noise_Step(t_now, Tstep, noise_srcs->type[1], noise_srcs->settings+N_NOISE_SETTINGS*1, &noise_srcs->rng, 1, &noise_srcs->dtg);
+	Noise_Step(t_now, Tstep, noise_srcs->type[2], noise_srcs->settings+N_NOISE_SETTINGS*2, &noise_srcs->rng, 2, &noise_srcs->dE_ing);
+	Noise_Step(t_now, Tstep, noise_srcs->type[3], noise_srcs->settings+N_NOISE_SETTINGS*3, &noise_srcs->rng, 3, &noise_srcs->dsig_z);
+	Noise_Step(t_now, Tstep, noise_srcs->type[4], noise_srcs->settings+N_NOISE_SETTINGS*4, &noise_srcs->rng, 4, &noise_srcs->dsig_E);
+	Noise_Step(t_now, Tstep, noise_srcs->type[5], noise_srcs->settings+N_NOISE_SETTINGS*5, &noise_srcs->rng, 5, &noise_srcs->dchirp);
 }
 
 #define CPRINT(c) {if(cimag(c)<0) fprintf(fp,"%10.16e%10.16ej ",creal(c),cimag(c)); else fprintf(fp,"%10.16e+%10.16ej ",creal(c),cimag(c)); } ///< fprintf for a double complex signal
@@ -115,32 +445,30 @@ void Write_Sim_Step(
 	Simulation_State *sim_state 	///< Pointer to Simulation State
 	)
 {
- 	fprintf(fp, "%10.16e   ",time);					// Current simulation time [s]
- 	fprintf(fp, "%10.16e %10.16e %10.16e %10.16e %10.16e %10.16e  ",
-		sim_state->noise_srcs->dQ_Q,				// Beam charge jitter [relative to nominal beam charge]
-		sim_state->noise_srcs->dtg,					// Timing error of gun wrt RF (<0 is an early bunch) [s]
-		sim_state->noise_srcs->dE_ing,			// Energy deviation at end of injector [eV]
-		sim_state->noise_srcs->dsig_z,			// Deviation of bunch length from nominal length [m]
-		sim_state->noise_srcs->dsig_E,			// Deviation of energy spread from nominal energy spread [fraction of nominal energy]
-		sim_state->noise_srcs->dchirp);			// <Ez> correlation [m]
+	double row[Sim_Output_Columns(sim)];
 
-	for(int l=0;l<sim->n_linacs;l++) {
-		fprintf(fp,"%10.16e %10.16e %10.16e %10.16e %10.16e %10.16e %10.16e %10.16e %10.16e %10.16e %10.16e  ",
-			sim_state->amp_error_net[l],
-			sim_state->phase_error_net[l],
-			sim_state->dc_state->dE_E[l],
-			sim_state->dc_state->dt[l],
-			sim_state->dc_state->sz[l],
-			sim_state->dc_state->dE_Ei[l],
-			sim_state->dc_state->dE_Ei2[l],
-
-			cabs(sim_state->linac_state_net[l]->linac_V),
-			carg(sim_state->linac_state_net[l]->linac_V)*180.0/M_PI,
+	Sim_Output_Row(row, time, sim, sim_state);
+	Write_Sim_Row(fp, row, sim->n_linacs);
+}
 
-			cabs(sim_state->linac_state_net[l]->linac_Kg),
-			carg(sim_state->linac_state_net[l]->linac_Kg)*180.0/M_PI
-		);
+/** Print a Simulation output row (see Sim_Output_Row) to a text FILE:
+  * one line, global columns first (time, then correlated noise sources), then the columns of each Linac. */
+void Write_Sim_Row(
+	FILE * fp,					///< Pointer to output FILE
+	const double *row,	///< Simulation output row
+	int n_linacs				///< Number of Linacs
+	)
+{
+ 	fprintf(fp, "%10.16e   ",row[0]);					// Current simulation time [s]
+	for(int c=1;c<SIM_OUTPUT_GLOBALS;c++) {
+		fprintf(fp, c < SIM_OUTPUT_GLOBALS-1 ? "%10.16e " : "%10.16e  ", row[c]);
+	}
 
+	for(int l=0;l<n_linacs;l++) {
+		const double *loc = row + SIM_OUTPUT_GLOBALS + SIM_OUTPUT_LOCALS*l;
+		for(int c=0;c<SIM_OUTPUT_LOCALS;c++) {
+			fprintf(fp, c < SIM_OUTPUT_LOCALS-1 ? "%10.16e " : "%10.16e  ", loc[c]);
+		}
 	}
 	// End simulation step entry with a new line
 	fprintf(fp, "\n");
@@ -148,15 +476,286 @@ void Write_Sim_Step(
 
 #undef CPRINT
 
-/** Run the entire simulation: Step entire model for the total simulation time specified in the Simulation struct,
-	* and write results of time-series simulation into output FILE every OUTPUTFREQ simulation steps
-	* This is the Top Level function for the entire Simulation Engine.
- */
-void Simulation_Run(
+/** Names of the global output columns, as in plotting/columns.json */
+static const char *Sim_Output_Globals[SIM_OUTPUT_GLOBALS] = {
+	"t", "dQ_Q", "dtg", "dE_ing", "dsig_z", "dsig_E", "dchirp"
+};
+
+/** Names of the per-Linac output columns, as in plotting/columns.json */
+static const char *Sim_Output_Locals[SIM_OUTPUT_LOCALS] = {
+	"error_vol_a", "error_vol_p", "dE_E", "dtz", "sz", "dE_Ei", "dE_Ei2",
+	"cav_voltage_a", "cav_voltage_p", "fpga_drive_a", "fpga_drive_p"
+};
+
+/** Number of columns in a Simulation output row. */
+int Sim_Output_Columns(Simulation *sim)
+{
+	return SIM_OUTPUT_GLOBALS + SIM_OUTPUT_LOCALS*sim->n_linacs;
+}
+
+/** Fill in a Simulation output row (Sim_Output_Columns values) with the current Simulation State:
+  * same quantities, in the same order, as the columns printed by Write_Sim_Step. */
+void Sim_Output_Row(
+	double *row,									///< Output row
+	double time,									///< Current simulation time in seconds
+	Simulation *sim,							///< Pointer to Simulation (need to know about machine layout)
+	Simulation_State *sim_state 	///< Pointer to Simulation State
+	)
+{
+	row[0] = time;
+	row[1] = sim_state->noise_srcs->dQ_Q;
+	row[2] = sim_state->noise_srcs->dtg;
+	row[3] = sim_state->noise_srcs->dE_ing;
+	row[4] = sim_state->noise_srcs->dsig_z;
+	row[5] = sim_state->noise_srcs->dsig_E;
+	row[6] = sim_state->noise_srcs->dchirp;
+
+	for(int l=0;l<sim->n_linacs;l++) {
+		double *loc = row + SIM_OUTPUT_GLOBALS + SIM_OUTPUT_LOCALS*l;
+		loc[0] = sim_state->amp_error_net[l];
+		loc[1] = sim_state->phase_error_net[l];
+		loc[2] = sim_state->dc_state->dE_E[l];
+		loc[3] = sim_state->dc_state->dt[l];
+		loc[4] = sim_state->dc_state->sz[l];
+		loc[5] = sim_state->dc_state->dE_Ei[l];
+		loc[6] = sim_state->dc_state->dE_Ei2[l];
+		loc[7] = cabs(sim_state->linac_state_net[l]->linac_V);
+		loc[8] = carg(sim_state->linac_state_net[l]->linac_V)*180.0/M_PI;
+		loc[9] = cabs(sim_state->linac_state_net[l]->linac_Kg);
+		loc[10] = carg(sim_state->linac_state_net[l]->linac_Kg)*180.0/M_PI;
+	}
+}
+
+/** Print the name of output column col (see Sim_Output_Row) into buf (of size n). */
+static void Sim_Output_Name(char *buf, size_t n, int col)
+{
+	if(col < SIM_OUTPUT_GLOBALS) snprintf(buf, n, "%s", Sim_Output_Globals[col]);
+	else {
+		col -= SIM_OUTPUT_GLOBALS;
+		snprintf(buf, n, "%s[%d]", Sim_Output_Locals[col%SIM_OUTPUT_LOCALS], col/SIM_OUTPUT_LOCALS);
+	}
+}
+
+/** Index of the output column with the given name (as in the binary output header, see Write_Sim_Header),
+  * or -1 if there is no such column. */
+int Sim_Output_Column(Simulation *sim, char *name)
+{
+	char buf[64];
+
+	for(int c=0;c<Sim_Output_Columns(sim);c++) {
+		Sim_Output_Name(buf, sizeof(buf), c);
+		if(strcmp(buf, name) == 0) return c;
+	}
+	return -1;
+}
+
+/** Write the power spectral densities estimated during Simulation_Run (see Sim_State_Set_PSD) to a text file:
+  * a header line with the column names, then one line per frequency bin with the frequency [Hz]
+  * and the density of each signal [units^2/Hz]. Returns 0 on success,
+  * -1 if estimation is disabled or the file can not be opened. */
+int Write_Sim_PSD(
+	char * fname,									///< Output file name (string)
+	Simulation *sim,							///< Pointer to Simulation (need to know about machine layout)
+	Simulation_State *sim_state 	///< Pointer to Simulation State
+	)
+{
+	Sim_PSD *psd = sim_state->psd;
+	if(psd == NULL) return -1;
+
+	FILE *fp = fopen(fname, "w");
+	if(fp == NULL) return -1;
+
+	char name[64];
+
+	fprintf(fp, "# frequency");
+	for(int s=0;s<psd->n_signals;s++) {
+		Sim_Output_Name(name, sizeof(name), psd->cols[s]);
+		fprintf(fp, " %s", name);
+	}
+	fprintf(fp, "\n# segments %ld of %d samples\n", psd->n_segments, psd->n_fft);
+
+	for(int k=0;k<Sim_PSD_Bins(psd);k++) {
+		fprintf(fp, "%10.16e", Sim_PSD_Frequency(psd, k));
+		for(int s=0;s<psd->n_signals;s++) fprintf(fp, " %10.16e", Sim_PSD_Value(psd, s, k));
+		fprintf(fp, "\n");
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+/** Write the streaming statistics of the Simulation output columns (see Sim_Stats) to a text file:
+  * a header line, then one line per column with its name, number of samples, mean,
+  * standard deviation, RMS, minimum and maximum. Returns 0 on success, -1 if the file can not be opened. */
+int Write_Sim_Stats(
+	char * fname,									///< Output file name (string)
+	Simulation *sim,							///< Pointer to Simulation (need to know about machine layout)
+	Simulation_State *sim_state 	///< Pointer to Simulation State
+	)
+{
+	FILE *fp = fopen(fname, "w");
+	if(fp == NULL) return -1;
+
+	Sim_Stats *stats = sim_state->stats;
+	char name[64];
+
+	fprintf(fp, "# column count mean std rms min max\n");
+	for(int c=0;c<Sim_Output_Columns(sim);c++) {
+		Sim_Output_Name(name, sizeof(name), c);
+		fprintf(fp, "%s %ld %10.16e %10.16e %10.16e %10.16e %10.16e\n", name, stats->count,
+			Sim_Stats_Mean(stats, c), Sim_Stats_Std(stats, c), Sim_Stats_RMS(stats, c),
+			Sim_Stats_Min(stats, c), Sim_Stats_Max(stats, c));
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+/** Store a 32-bit unsigned integer in little-endian byte order. */
+static void Sim_Output_Put_U32(unsigned char *buf, uint32_t val)
+{
+	for(int i=0;i<4;i++) buf[i] = (unsigned char)(val >> 8*i);
+}
+
+/** Write the header of a binary output file:
+  * the magic string SIM_OUTPUT_MAGIC (8 bytes), then little-endian uint32 values
+  * (header size in bytes, number of columns, of global columns, of columns per Linac, of Linacs, reserved),
+  * then the column names (one per line, per-Linac names suffixed by [Linac index]), zero-padded
+  * to a multiple of SIM_OUTPUT_ALIGN bytes. Rows of little-endian float64 values follow the header
+  * (see Write_Sim_Step_Binary); the number of rows is implied by the file size. */
+void Write_Sim_Header(
+	FILE * fp,				///< Pointer to output FILE
+	Simulation *sim		///< Pointer to Simulation (need to know about machine layout)
+	)
+{
+	int n_cols = Sim_Output_Columns(sim);
+	size_t size = 32, used;
+
+	// Measure column names
+	for(int c=0;c<SIM_OUTPUT_GLOBALS;c++) size += strlen(Sim_Output_Globals[c]) + 1;
+	for(int l=0;l<sim->n_linacs;l++) {
+		for(int c=0;c<SIM_OUTPUT_LOCALS;c++) size += snprintf(NULL, 0, "%s[%d]\n", Sim_Output_Locals[c], l);
+	}
+	size = (size + SIM_OUTPUT_ALIGN - 1)/SIM_OUTPUT_ALIGN*SIM_OUTPUT_ALIGN;
+
+	unsigned char *header = calloc(size+1, 1);  // room for the terminating null of sprintf
+	memcpy(header, SIM_OUTPUT_MAGIC, 8);
+	Sim_Output_Put_U32(header+8, (uint32_t)size);
+	Sim_Output_Put_U32(header+12, (uint32_t)n_cols);
+	Sim_Output_Put_U32(header+16, SIM_OUTPUT_GLOBALS);
+	Sim_Output_Put_U32(header+20, SIM_OUTPUT_LOCALS);
+	Sim_Output_Put_U32(header+24, (uint32_t)sim->n_linacs);
+
+	used = 32;
+	for(int c=0;c<SIM_OUTPUT_GLOBALS;c++) {
+		used += sprintf((char *)header+used, "%s\n", Sim_Output_Globals[c]);
+	}
+	for(int l=0;l<sim->n_linacs;l++) {
+		for(int c=0;c<SIM_OUTPUT_LOCALS;c++) {
+			used += sprintf((char *)header+used, "%s[%d]\n", Sim_Output_Locals[c], l);
+		}
+	}
+
+	fwrite(header, 1, size, fp);
+	free(header);
+}
+
+/** Take a snapshot of the current Simulation State and write it to a binary output FILE
+  * (see Write_Sim_Header): one row of Sim_Output_Columns little-endian float64 values. */
+void Write_Sim_Step_Binary(
+	FILE * fp,										///< Pointer to output FILE
+	double time,									///< Current simulation time in seconds
+	Simulation *sim,							///< Pointer to Simulation (need to know about machine layout)
+	Simulation_State *sim_state 	///< Pointer to Simulation State
+	)
+{
+	int n_cols = Sim_Output_Columns(sim);
+	double row[n_cols];
+
+	Sim_Output_Row(row, time, sim, sim_state);
+	Write_Sim_Rows_Binary(fp, row, 1, n_cols);
+}
+
+/** Write Simulation output rows (see Sim_Output_Row) to a binary output FILE as little-endian float64.
+  * (On big-endian hosts the rows are byte-swapped in place.) */
+void Write_Sim_Rows_Binary(
+	FILE * fp,				///< Pointer to output FILE
+	double *rows,			///< Simulation output rows (n_rows*n_cols values)
+	int n_rows,				///< Number of rows
+	int n_cols				///< Number of columns (see Sim_Output_Columns)
+	)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	for(int c=0;c<n_rows*n_cols;c++) {
+		uint64_t bits;
+		memcpy(&bits, &rows[c], 8);
+		bits = __builtin_bswap64(bits);
+		memcpy(&rows[c], &bits, 8);
+	}
+#endif
+
+	fwrite(rows, sizeof(double), (size_t)n_rows*n_cols, fp);
+}
+
+/** Number of output rows of a Simulation run from step 0 with decimation factor OUTPUTFREQ
+  * (an upper bound when resuming, or if the run may stop early, see Simulation.conv_window)
+  * (rows are recorded on the first step and every OUTPUTFREQ steps when sub-sampling,
+  * at the end of every OUTPUTFREQ steps with a decimation filter). */
+int Sim_Output_Rows(Simulation *sim, int OUTPUTFREQ)
+{
+	if(sim->output_decimation > 0) return sim->time_steps/OUTPUTFREQ;
+	return (sim->time_steps + OUTPUTFREQ - 1)/OUTPUTFREQ;
+}
+
+/** Helper routine for the early termination of Simulation_Run: tracks the range (min and max) of every Linac's
+  * amplitude and phase errors and of the real and imaginary parts of its accelerating voltage (vector sum of its cavities)
+  * over consecutive windows of conv_window steps (kept in the Simulation State, see Sim_Conv_State).
+  * At the end of each window, returns 1 if it was settled, i.e. the errors stayed within a range of conv_error_tol
+  * and the voltage within conv_voltage_tol relative to its magnitude (criteria with a zero tolerance are not checked);
+  * returns 0 otherwise. */
+static int Sim_Step_Settled(Simulation *sim, Simulation_State *sim_state)
+{
+	Sim_Conv_State *conv = sim_state->conv;
+	double *lo = conv->lo, *hi = conv->hi;
+	int l, k, settled = 1;
+
+	for(l=0;l<sim->n_linacs;l++) {
+		double complex V = sim_state->linac_state_net[l]->linac_V;
+		double x[4] = {sim_state->amp_error_net[l], sim_state->phase_error_net[l], creal(V), cimag(V)};
+
+		for(k=0;k<4;k++) {
+			if(conv->count == 0 || x[k] < lo[4*l+k]) lo[4*l+k] = x[k];
+			if(conv->count == 0 || x[k] > hi[4*l+k]) hi[4*l+k] = x[k];
+		}
+	}
+	if(++conv->count < sim->conv_window) return 0;
+	conv->count = 0;
+
+	for(l=0;l<sim->n_linacs;l++) {
+		double *lo_l = lo + 4*l, *hi_l = hi + 4*l;
+		double V = cabs(sim_state->linac_state_net[l]->linac_V);
+
+		if(sim->conv_error_tol > 0.0 &&
+			(hi_l[0] - lo_l[0] > sim->conv_error_tol || hi_l[1] - lo_l[1] > sim->conv_error_tol)) settled = 0;
+		if(sim->conv_voltage_tol > 0.0 &&
+			(hi_l[2] - lo_l[2] > sim->conv_voltage_tol*V || hi_l[3] - lo_l[3] > sim->conv_voltage_tol*V)) settled = 0;
+	}
+	return settled;
+}
+
+/** Step the entire model for the total simulation time specified in the Simulation struct
+  * (from the steps already completed by the Simulation State up to Simulation.time_steps),
+  * recording results every OUTPUTFREQ simulation steps into the output FILE (if not NULL)
+  * and into the rows buffer (if not NULL, at most n_rows rows). Returns the number of rows recorded.
+  * The run stops early at the end of the first window of conv_window steps that is settled (see Sim_Step_Settled),
+  * with Simulation_State.stop_reason and step telling why and where it stopped. */
+static int Sim_Run(
 	Simulation *sim,							///< Pointer to Simulation
 	Simulation_State *sim_state,	///< Pointer to Simulation State
-	char * fname,									///< Output file name (string)
-	int OUTPUTFREQ								///< Decimation factor of output data (print to file very OUTPUTFREQ simulation steps)
+	FILE * fp,										///< Output FILE (or NULL)
+	double *rows,									///< Output rows of Sim_Output_Columns values (or NULL)
+	int n_rows,										///< Maximum number of rows in the rows buffer
+	int OUTPUTFREQ								///< Decimation factor of output data
 	)
 {
 	// Total Linac accelerating voltage in Volts
@@ -165,26 +764,57 @@ void Simulation_Run(
 	double time=0.0;
 	// Temporary signals
 	double delta_tz=0.0, beam_charge=0.0;
+	// Output rows recorded
+	int n_out = 0, n_cols = Sim_Output_Columns(sim);
+	// Output row of the current step
+	double row[n_cols];
+	int record;
+
+	// Anti-aliasing decimation filter (plain sub-sampling if not configured): the one of the Simulation State
+	// if it was built for this order and factor, a local one (starting over every run) otherwise
+	Sim_Decimator *decimator = NULL, *local_decimator = NULL;
+	if(sim->output_decimation > 0) {
+		int order = sim->output_decimation < SIM_DECIMATOR_MAX_ORDER ? sim->output_decimation : SIM_DECIMATOR_MAX_ORDER;
+		decimator = sim_state->decimator;
+		if(decimator == NULL || decimator->order != order || decimator->factor != OUTPUTFREQ) {
+			decimator = local_decimator = calloc(1, sizeof(Sim_Decimator));
+			Sim_Decimator_Build(decimator, sim, OUTPUTFREQ);
+		}
+	}
 
-	// Open the file to store simulation results in
-	FILE * fp = NULL;
-	if(fname != NULL) fp = fopen(fname,"wb");
+	if(fp != NULL && sim->output_format == SIM_OUTPUT_BINARY) Write_Sim_Header(fp, sim);
+
+	// Writer thread for the output FILE (synchronous output if not configured or not available)
+	Sim_Writer *writer = NULL;
+	if(fp != NULL && sim->output_depth > 0) writer = Sim_Writer_Allocate_New(fp, sim, sim->output_depth, sim->output_policy);
+
+	// Worker threads for the Cryomodules (kept for the whole run)
+	Sim_Pool *pool = NULL;
+	if(sim->n_threads > 1) pool = Sim_Pool_Allocate_New(sim->linac_net, sim_state->linac_state_net, sim->n_linacs, sim->n_threads);
+
+	// Convergence monitor (window carried over from the Simulation State)
+	int converge = sim->conv_window > 0 && (sim->conv_error_tol > 0.0 || sim->conv_voltage_tol > 0.0);
+	sim_state->stop_reason = SIM_STOP_END;
 
 	// Iterate over time steps
-	for(int t=0;t<sim->time_steps;t++){
+	int t;
+	for(t=sim_state->step;t<sim->time_steps;t++){
 
 		// Calculate current simulation time
 		time = (t+1)*sim->Tstep;
 
 		Apply_Correlated_Noise(t, sim->Tstep,sim_state->noise_srcs);
 
-		// Iterate over Linacs
-		for(int l=0;l<sim->n_linacs;l++){
-			// Timing jitter
-			delta_tz = *sim_state->dc_state->dt;
-			// Add charge jitter to nominal beam charge to obtain instantaneous value
-			beam_charge = sim->gun->Q*(1.0+sim_state->noise_srcs->dQ_Q);
+		// Timing jitter
+		delta_tz = *sim_state->dc_state->dt;
+		// Add charge jitter to nominal beam charge to obtain instantaneous value
+		beam_charge = sim->gun->Q*(1.0+sim_state->noise_srcs->dQ_Q);
+
+		// Step all Linacs in parallel (same inputs for every Linac)
+		if(pool != NULL) Sim_Pool_Step(pool, delta_tz, beam_charge, sim_state->amp_error_net, sim_state->phase_error_net);
 
+		// Iterate over Linacs
+		else for(int l=0;l<sim->n_linacs;l++){
 			// Run Linac simulation step
 			linac_V = Linac_Step(sim->linac_net[l], sim_state->linac_state_net[l],
 			// Input errors
@@ -203,17 +833,88 @@ void Simulation_Run(
 		// Doublecompress State
 		sim_state->dc_state);
 
-	if(t%OUTPUTFREQ == 0){
-		if(fp!=NULL) Write_Sim_Step(fp, time, sim, sim_state);
+	// Streaming statistics and decimation see every step
+	record = decimator == NULL && t%OUTPUTFREQ == 0;
+	if(record || decimator != NULL || sim->output_stats || sim_state->psd != NULL) Sim_Output_Row(row, time, sim, sim_state);
+	if(sim->output_stats && t >= sim->stats_skip) Sim_Stats_Update(sim_state->stats, row);
+	if(sim_state->psd != NULL && t >= sim->stats_skip) Sim_PSD_Update(sim_state->psd, row);
+	if(decimator != NULL) record = Sim_Decimator_Step(decimator, row, row);
+
+	if(record){
+		if(rows != NULL && n_out < n_rows) memcpy(rows + (size_t)n_out*n_cols, row, n_cols*sizeof(double));
+		n_out++;
+
+		if(writer != NULL) Sim_Writer_Push(writer, row);
+		else if(fp!=NULL) {
+			if(sim->output_format == SIM_OUTPUT_BINARY) Write_Sim_Rows_Binary(fp, row, 1, n_cols);
+			else Write_Sim_Row(fp, row, sim->n_linacs);
+		}
     }
 
 	// Apply Beam-based feedback
 	// BBF_Step(sim->bbf, sim_state->dc_state, sim->linac_net, sim->n_linacs);
 
+	// Early termination (step t completed)
+	if(converge && Sim_Step_Settled(sim, sim_state)) {
+		sim_state->stop_reason = SIM_STOP_CONVERGED;
+		t++;
+		break;
+	}
+
 	} // End iteration over time-steps
+	sim_state->step = t;
 
 
+	if(pool != NULL) Sim_Pool_Deallocate(pool);
+
+	// Drain the output ring
+	sim_state->output_dropped = 0;
+	if(writer != NULL) sim_state->output_dropped = Sim_Writer_Deallocate(writer);
+
+	if(local_decimator != NULL) {
+		Sim_Decimator_Deallocate(local_decimator);
+		free(local_decimator);
+	}
+
+	return rows != NULL && n_out > n_rows ? n_rows : n_out;
+}
+
+/** Run the entire simulation: Step entire model for the total simulation time specified in the Simulation struct,
+	* and write results of time-series simulation into output FILE every OUTPUTFREQ simulation steps
+	* This is the Top Level function for the entire Simulation Engine.
+	* The run continues from the steps already completed by the Simulation State (see Sim_State_Load),
+	* use Sim_State_Reset to start over. It stops early if convergence criteria are configured and met
+	* (see Simulation.conv_window; Simulation_State.stop_reason and step report why and where it stopped).
+ */
+void Simulation_Run(
+	Simulation *sim,							///< Pointer to Simulation
+	Simulation_State *sim_state,	///< Pointer to Simulation State
+	char * fname,									///< Output file name (string)
+	int OUTPUTFREQ								///< Decimation factor of output data (print to file very OUTPUTFREQ simulation steps)
+	)
+{
+	// Open the file to store simulation results in
+	FILE * fp = NULL;
+	if(fname != NULL) fp = fopen(fname,"wb");
+
+	Sim_Run(sim, sim_state, fp, NULL, 0, OUTPUTFREQ);
+
 	// Close the file to store simulation results in
 	if(fp!=NULL) fclose(fp);
 }
 
+/** Run the entire simulation (see Simulation_Run), recording results every OUTPUTFREQ simulation steps
+  * into a caller-provided buffer instead of a file: row-major, n_rows rows of Sim_Output_Columns values
+  * (same columns as the output file, see Sim_Output_Row). Rows beyond n_rows are not recorded
+  * (see Sim_Output_Rows for the size of a complete record). Returns the number of rows recorded. */
+int Simulation_Run_Buffer(
+	Simulation *sim,							///< Pointer to Simulation
+	Simulation_State *sim_state,	///< Pointer to Simulation State
+	double *rows,									///< Output buffer (n_rows*Sim_Output_Columns values)
+	int n_rows,										///< Number of rows in the output buffer
+	int OUTPUTFREQ								///< Decimation factor of output data
+	)
+{
+	return Sim_Run(sim, sim_state, NULL, rows, n_rows, OUTPUTFREQ);
+}
+
@@ -14,8 +14,29 @@
 #include "linac.h"
 #include "doublecompress.h"
 #include "noise.h"
+#include "sim_psd.h"
+#include "sim_stats.h"
 // #include "beam_based_feedback.h"
 
+#define SIM_OUTPUT_TEXT 0     ///< Simulation output rows printed as text (see Write_Sim_Step)
+#define SIM_OUTPUT_BINARY 1   ///< Simulation output rows written as little-endian float64 (see Write_Sim_Header)
+
+#define SIM_OUTPUT_GLOBALS 7  ///< Number of global output columns (see plotting/columns.json)
+#define SIM_OUTPUT_LOCALS 11  ///< Number of output columns per Linac (see plotting/columns.json)
+#define SIM_OUTPUT_MAGIC "LLRFSIM1"  ///< First 8 bytes of a binary output file
+#define SIM_OUTPUT_ALIGN 64   ///< Binary output header size is a multiple of this (in bytes)
+
+#define SIM_OUTPUT_BLOCK 0    ///< Asynchronous output: wait for the writer thread when the output ring is full
+#define SIM_OUTPUT_DROP 1     ///< Asynchronous output: drop (and count) output rows when the output ring is full
+
+#define SIM_STOP_END 0        ///< Simulation_Run stopped after sim.time_steps steps
+#define SIM_STOP_CONVERGED 1  ///< Simulation_Run stopped early: convergence criteria met (see Simulation.conv_window)
+
+#define SIM_STEADY_ITER 20  ///< Maximum number of timing jitter iterations of Sim_State_Set_Steady_State
+#define SIM_STEADY_TOL 1e-9  ///< Relative tolerance of the timing jitter at steady state
+
+#define SIM_STATE_MAGIC "LLRFSTAT"  ///< First 8 bytes of a Simulation State checkpoint file (see Sim_State_Save)
+#define SIM_STATE_VERSION 2   ///< Version of the Simulation State checkpoint format
 
 
 /**
@@ -27,6 +48,18 @@ typedef struct str_Simulation {
 	// Simulation parameters
 	double Tstep;	///< Simulation time-step size
 	int time_steps;	///< Total number of Simulation steps
+	uint32_t seed;	///< Random number seed (see Sim_State_Allocate)
+	int n_threads;	///< Number of threads stepping Cryomodules in Simulation_Run (see sim_pool.h)
+	int output_format;	///< Format of the Simulation_Run output file (SIM_OUTPUT_TEXT or SIM_OUTPUT_BINARY)
+	int output_depth;	///< Number of blocks in the output ring of the writer thread (0: synchronous output, see sim_writer.h)
+	int output_policy;	///< Policy when the output ring is full (SIM_OUTPUT_BLOCK or SIM_OUTPUT_DROP)
+	int output_decimation;	///< Order of the decimation filter applied before output (0: plain sub-sampling, see Sim_Decimator)
+	int output_freq;	///< Decimation factor (OUTPUTFREQ) the decimation filter of the Simulation State is built for (see Sim_State_Allocate)
+	int output_stats;	///< Accumulate statistics of the output columns every step into the Simulation State (see Sim_Stats)
+	int stats_skip;	///< Number of initial Simulation steps left out of the statistics and spectra (transients)
+	int conv_window;	///< Early termination: length of the windows of steps checked by Simulation_Run, which stops after the first settled one (0: disabled)
+	double conv_error_tol;	///< Early termination: largest range of Linac amplitude and phase errors over a settled window (0: not checked)
+	double conv_voltage_tol;	///< Early termination: largest relative range of Linac accelerating voltages over a settled window (0: not checked)
 
 	// Electron Gun
 	Gun *gun;
@@ -41,6 +74,15 @@ typedef struct str_Simulation {
 
 } Simulation;
 
+/**
+ * Convergence monitor of Simulation_Run (see Simulation.conv_window): range of the errors and voltages
+ * over the current window of steps, kept in the Simulation State so that a resumed run continues the window.
+ */
+typedef struct str_Sim_Conv_State {
+	int count;	///< Number of steps into the current window
+	double *lo, *hi;	///< Range of every Linac's amplitude and phase errors and of the real and imaginary parts of its accelerating voltage (4*n_linacs values)
+} Sim_Conv_State;
+
 typedef struct str_Simulation_State {
 
 	Linac_State **linac_state_net;	///< Array of Linac States
@@ -52,6 +94,19 @@ typedef struct str_Simulation_State {
 	// (amplitude normalized by Linac increase in Energy in eV)
 	double *amp_error_net, *phase_error_net;
 
+	Sim_Stats *stats;	///< Streaming statistics of the output columns (see Simulation.output_stats)
+	Sim_PSD *psd;	///< Power spectral density accumulator of selected output columns (NULL: disabled, see Sim_State_Set_PSD)
+	Sim_Decimator *decimator;	///< Decimation filter of the output (NULL: not configured when the State was allocated, see Simulation.output_freq)
+	Sim_Conv_State *conv;	///< Convergence monitor of Simulation_Run (see Simulation.conv_window)
+
+	long output_dropped;	///< Number of output rows dropped by the last Simulation_Run (see SIM_OUTPUT_DROP)
+	int stop_reason;	///< Why the last Simulation_Run stopped (SIM_STOP_END or SIM_STOP_CONVERGED, see Simulation.conv_window)
+	int step;	///< Number of Simulation steps completed: Simulation_Run continues from this step (see Sim_State_Load)
+	int step_pristine;	///< Step restored by Sim_State_Reset
+
+	State_Arena *arena;	///< Storage of all the States above (see Sim_State_Allocate)
+	Noise_Srcs noise_srcs_pristine;	///< Correlated noise sources restored by Sim_State_Reset
+
 } Simulation_State;
 
 void Sim_Allocate_In(Simulation *sim, double Tstep, int time_steps,
@@ -61,13 +116,30 @@ void Sim_Deallocate(Simulation *sim);
 
 void Sim_State_Allocate(Simulation_State *sim_state, Simulation *sim, Noise_Srcs* noise_srcs);
 void Sim_State_Deallocate(Simulation_State *sim_state, Simulation *sim);
+void Sim_State_Snapshot(Simulation_State *sim_state);
+void Sim_State_Reset(Simulation_State *sim_state);
+int Sim_State_Set_Steady_State(Simulation *sim, Simulation_State *sim_state);
+int Sim_State_Save(char * fname, Simulation_State *sim_state);
+int Sim_State_Load(char * fname, Simulation_State *sim_state);
+int Sim_State_Set_PSD(Simulation_State *sim_state, Simulation *sim, int *psd_cols, int n_psd_cols, int n_fft, int window_type);
 
 void Apply_Correlated_Noise(int t_now, double Tstep, Noise_Srcs * noise_srcs);
+int Sim_Output_Columns(Simulation *sim);
+int Sim_Output_Column(Simulation *sim, char *name);
+void Sim_Output_Row(double *row, double time, Simulation *sim, Simulation_State *sim_state);
 void Write_Sim_Step( FILE * fp, double time, Simulation *sim, Simulation_State *sim_state);
+void Write_Sim_Row(FILE * fp, const double *row, int n_linacs);
+void Write_Sim_Header(FILE * fp, Simulation *sim);
+void Write_Sim_Step_Binary(FILE * fp, double time, Simulation *sim, Simulation_State *sim_state);
+void Write_Sim_Rows_Binary(FILE * fp, double *rows, int n_rows, int n_cols);
+int Write_Sim_Stats(char * fname, Simulation *sim, Simulation_State *sim_state);
+int Write_Sim_PSD(char * fname, Simulation *sim, Simulation_State *sim_state);
 
 /**
  * Performs sim.time_steps simulation time-steps (top-level of the entire Simulation Engine)
  */
 void Simulation_Run(Simulation *sim, Simulation_State *sim_state,char * fname, int OUTPUTFREQ);
+int Simulation_Run_Buffer(Simulation *sim, Simulation_State *sim_state, double *rows, int n_rows, int OUTPUTFREQ);
+int Sim_Output_Rows(Simulation *sim, int OUTPUTFREQ);
 
 #endif
@@ -0,0 +1,182 @@
+/**
+ * @file state_arena.c
+ * @brief State arena: contiguous, cache-aligned storage for simulation States,
+ * laid out in the order States are allocated (traversal order of the machine),
+ * with reset from a pristine copy.
+ */
+
+#include "state_arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/** Arena State_Calloc currently allocates from (NULL: heap), per thread:
+  * States can be allocated concurrently on different threads, each in its own arena */
+static __thread State_Arena *current_arena = NULL;
+
+/** Round size up to the arena alignment. */
+static size_t State_Arena_Round(size_t size)
+{
+	return (size + STATE_ARENA_ALIGN - 1) & ~(size_t)(STATE_ARENA_ALIGN - 1);
+}
+
+/** Make arena the target of State_Calloc on the calling thread (until State_Arena_End on the same thread).
+  * If the arena has no block yet, this starts the sizing pass: allocations are made on the heap
+  * and their total size recorded. Otherwise allocations are carved out of the arena block. */
+void State_Arena_Begin(State_Arena *arena)
+{
+	arena->used = 0;
+	current_arena = arena;
+}
+
+/** Stop allocating from arena. At the end of a sizing pass, the heap allocations made
+  * during the pass are freed and the arena block is allocated (zeroed) with the recorded size. */
+void State_Arena_End(State_Arena *arena)
+{
+	current_arena = NULL;
+
+	if(arena->base == NULL) {
+		for(int i=0;i<arena->n_heap;i++) free(arena->heap[i]);
+		free(arena->heap);
+		arena->heap = NULL;
+		arena->n_heap = arena->alloc_heap = 0;
+
+		arena->size = arena->used > 0 ? arena->used : STATE_ARENA_ALIGN;
+		if(posix_memalign((void **)&arena->base, STATE_ARENA_ALIGN, arena->size) != 0) arena->base = NULL;
+		else memset(arena->base, 0, arena->size);
+	}
+}
+
+/** Frees memory of a State_Arena (block and pristine copy). States allocated in it become invalid. */
+void State_Arena_Deallocate(State_Arena *arena)
+{
+	free(arena->base);
+	free(arena->pristine);
+	free(arena->ptr_map);
+	arena->base = arena->pristine = NULL;
+	arena->ptr_map = NULL;
+	arena->size = arena->used = 0;
+}
+
+/** Keep a copy of the arena block as its pristine image (see State_Arena_Reset). */
+void State_Arena_Snapshot(State_Arena *arena)
+{
+	if(arena->pristine == NULL) arena->pristine = malloc(arena->size);
+	memcpy(arena->pristine, arena->base, arena->used);
+}
+
+/** Restore the arena block from its pristine image. */
+void State_Arena_Reset(State_Arena *arena)
+{
+	if(arena->pristine != NULL) memcpy(arena->base, arena->pristine, arena->used);
+}
+
+/** Allocates a shadow of arena: a new arena with a block of the same size, ready for an allocation pass
+  * (see State_Arena_Begin). Building the same States in both arenas reveals which words hold pointers. */
+State_Arena *State_Arena_Shadow_New(State_Arena *arena)
+{
+	State_Arena *shadow = calloc(1, sizeof(State_Arena));
+
+	shadow->size = arena->size;
+	if(posix_memalign((void **)&shadow->base, STATE_ARENA_ALIGN, shadow->size) != 0) shadow->base = NULL;
+	else memset(shadow->base, 0, shadow->size);
+
+	return shadow;
+}
+
+/** Find the words of the arena block holding pointers into the block, given a shadow arena (see State_Arena_Shadow_New)
+  * where the same States have been built: data is identical in both blocks, pointers differ by the offset of the blocks. */
+void State_Arena_Map_Pointers(State_Arena *arena, State_Arena *shadow)
+{
+	size_t n_words = arena->used/sizeof(uintptr_t);
+	uintptr_t offset = (uintptr_t)shadow->base - (uintptr_t)arena->base;
+	uintptr_t lo = (uintptr_t)arena->base, hi = lo + arena->used;
+
+	free(arena->ptr_map);
+	arena->ptr_map = calloc(n_words/8 + 1, 1);
+
+	for(size_t w=0;w<n_words;w++) {
+		uintptr_t a, s;
+		memcpy(&a, arena->base + w*sizeof(uintptr_t), sizeof(uintptr_t));
+		memcpy(&s, shadow->base + w*sizeof(uintptr_t), sizeof(uintptr_t));
+		if(a >= lo && a <= hi && s - a == offset) arena->ptr_map[w/8] |= 1 << (w%8);
+	}
+}
+
+/** Fingerprint of the layout of the arena (size and pointer map, FNV-1a hash):
+  * arenas of identical layout can exchange their contents (see State_Arena_Write and State_Arena_Read). */
+uint64_t State_Arena_Layout(State_Arena *arena)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	size_t n_words = arena->used/sizeof(uintptr_t);
+
+	for(int i=0;i<8;i++) hash = (hash ^ ((uint64_t)arena->used >> 8*i & 0xff))*1099511628211ULL;
+	if(arena->ptr_map != NULL) {
+		for(size_t i=0;i<n_words/8+1;i++) hash = (hash ^ arena->ptr_map[i])*1099511628211ULL;
+	}
+	return hash;
+}
+
+/** Write the contents of the arena block to a FILE, position-independent: words holding pointers
+  * (see State_Arena_Map_Pointers) are written as zeros. Returns 0 on success, -1 on write error. */
+int State_Arena_Write(State_Arena *arena, FILE *fp)
+{
+	size_t n_words = arena->used/sizeof(uintptr_t);
+	uint64_t used = arena->used;
+	uintptr_t word, zero = 0;
+
+	if(fwrite(&used, sizeof(used), 1, fp) != 1) return -1;
+	for(size_t w=0;w<n_words;w++) {
+		int is_ptr = arena->ptr_map != NULL && (arena->ptr_map[w/8] >> (w%8) & 1);
+		memcpy(&word, arena->base + w*sizeof(uintptr_t), sizeof(uintptr_t));
+		if(fwrite(is_ptr ? &zero : &word, sizeof(uintptr_t), 1, fp) != 1) return -1;
+	}
+	return 0;
+}
+
+/** Read the contents of the arena block from a FILE written by State_Arena_Write (from an arena of the same layout):
+  * all words are restored except those holding pointers, which keep pointing into this arena.
+  * Returns 0 on success, -1 if the sizes do not match or on read error. */
+int State_Arena_Read(State_Arena *arena, FILE *fp)
+{
+	size_t n_words = arena->used/sizeof(uintptr_t);
+	uint64_t used;
+	uintptr_t word;
+
+	if(fread(&used, sizeof(used), 1, fp) != 1 || used != arena->used) return -1;
+	for(size_t w=0;w<n_words;w++) {
+		if(fread(&word, sizeof(uintptr_t), 1, fp) != 1) return -1;
+		if(arena->ptr_map != NULL && (arena->ptr_map[w/8] >> (w%8) & 1)) continue;
+		memcpy(arena->base + w*sizeof(uintptr_t), &word, sizeof(uintptr_t));
+	}
+	return 0;
+}
+
+/** Allocate zeroed memory for n elements of the given size for a State:
+  * from the current State_Arena if any (see State_Arena_Begin), otherwise from the heap (calloc).
+  * Returns NULL if the arena is exhausted (allocations must match those of the sizing pass). */
+void *State_Calloc(size_t n, size_t size)
+{
+	State_Arena *arena = current_arena;
+	size_t bytes = State_Arena_Round(n*size > 0 ? n*size : 1);
+	void *ptr;
+
+	if(arena == NULL) return calloc(n > 0 ? n : 1, size);
+
+	// Sizing pass: heap allocation, recorded to be freed at the end of the pass
+	if(arena->base == NULL) {
+		ptr = calloc(n > 0 ? n : 1, size);
+		if(arena->n_heap == arena->alloc_heap) {
+			arena->alloc_heap = arena->alloc_heap > 0 ? 2*arena->alloc_heap : 64;
+			arena->heap = realloc(arena->heap, arena->alloc_heap*sizeof(void *));
+		}
+		arena->heap[arena->n_heap++] = ptr;
+		arena->used += bytes;
+		return ptr;
+	}
+
+	if(arena->used + bytes > arena->size) return NULL;
+	ptr = arena->base + arena->used;
+	arena->used += bytes;
+	return ptr;
+}
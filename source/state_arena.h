@@ -0,0 +1,49 @@
+/**
+  * @file state_arena.h
+  * @brief Header file for state_arena.c
+  * Contiguous storage for simulation States: State allocation routines draw their memory
+  * from the calling thread's current State_Arena (if any) through State_Calloc.
+*/
+
+#ifndef STATE_ARENA_H
+#define STATE_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define STATE_ARENA_ALIGN 64  ///< Alignment of the arena and of every allocation in it (cache line)
+
+/**
+ * Data structure storing a State arena. It is filled in two passes (see State_Arena_Begin):
+ * a sizing pass, where State_Calloc allocates from the heap and records the sizes,
+ * and a second pass carving the same allocations, in the same (traversal) order,
+ * out of a single block. A pristine copy of the block can be kept to reset the States.
+ * A map of the words of the block holding pointers (into the block) makes its contents
+ * position-independent, so they can be saved and restored in another arena of the same layout.
+ */
+typedef struct str_State_Arena {
+	char *base;           ///< Arena block (NULL during the sizing pass)
+	size_t size;          ///< Size of the arena block in bytes
+	size_t used;          ///< Bytes allocated so far (bytes needed, during the sizing pass)
+	char *pristine;       ///< Copy of the arena block taken by State_Arena_Snapshot
+	void **heap;          ///< Heap allocations made during the sizing pass
+	int n_heap, alloc_heap;
+	unsigned char *ptr_map;  ///< Bit map of the words of the block holding pointers (see State_Arena_Map_Pointers)
+} State_Arena;
+
+void State_Arena_Begin(State_Arena *arena);
+void State_Arena_End(State_Arena *arena);
+void State_Arena_Deallocate(State_Arena *arena);
+void State_Arena_Snapshot(State_Arena *arena);
+void State_Arena_Reset(State_Arena *arena);
+
+State_Arena *State_Arena_Shadow_New(State_Arena *arena);
+void State_Arena_Map_Pointers(State_Arena *arena, State_Arena *shadow);
+uint64_t State_Arena_Layout(State_Arena *arena);
+int State_Arena_Write(State_Arena *arena, FILE *fp);
+int State_Arena_Read(State_Arena *arena, FILE *fp);
+
+void *State_Calloc(size_t n, size_t size);
+
+#endif